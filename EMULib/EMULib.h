@@ -64,8 +64,9 @@ extern "C" {
 #endif
 
 /** WriteAudio() *********************************************/
-/** Write up to a given number of samples to audio buffer.  **/
-/** Returns the number of samples written.                  **/
+/** Write up to a given number of stereo samples, with left **/
+/** and right interleaved in Data, to audio buffer. Returns **/
+/** the number of samples written.                          **/
 /*************************************************************/
 unsigned int WriteAudio(int16_t *Data,unsigned int Length);
 
@@ -0,0 +1,527 @@
+/** EMULib Emulation Library *********************************/
+/**                                                         **/
+/**                        FastOPLL.c                       **/
+/**                                                         **/
+/** This file contains a table-driven OPLL (YM2413) sound   **/
+/** synthesizer. Operators are evaluated once per output    **/
+/** sample with log-sin and exponent tables, while envelope **/
+/** and LFO counters advance once per OPLL sample (1/72 of  **/
+/** the CPU clock), following the same rules as NukeYKT.    **/
+/** See FastOPLL.h for declarations.                        **/
+/**                                                         **/
+/** Instrument ROM and envelope rules follow Nuked-OPLL by  **/
+/** nukeykt (GPL2, see NukeYKT/LICENSE).                    **/
+/*************************************************************/
+#include "FastOPLL.h"
+#include <string.h>
+
+#define EG_ATTACK  0
+#define EG_DECAY   1
+#define EG_SUSTAIN 2
+#define EG_RELEASE 3
+
+#define OPLL_TICKS 72          /* CPU cycles per OPLL sample */
+
+/** Instruments 1..15, then BD, HH+SD, TOM+TC, in the same  **/
+/** format as custom instrument registers 0..7.             **/
+static const uint8_t ROM[18][8] =
+{
+  { 0x71,0x61,0x1E,0x17,0xD0,0x78,0x00,0x17 },
+  { 0x13,0x41,0x1A,0x0D,0xD8,0xF7,0x23,0x13 },
+  { 0x13,0x01,0x99,0x00,0xF2,0xC4,0x11,0x23 },
+  { 0x31,0x61,0x0E,0x07,0xA8,0x64,0x70,0x27 },
+  { 0x32,0x21,0x1E,0x06,0xE0,0x76,0x00,0x28 },
+  { 0x31,0x22,0x16,0x05,0xE0,0x71,0x00,0x18 },
+  { 0x21,0x61,0x1D,0x07,0x82,0x81,0x10,0x07 },
+  { 0x23,0x21,0x2D,0x14,0xA2,0x72,0x00,0x07 },
+  { 0x61,0x61,0x1B,0x06,0x64,0x65,0x10,0x17 },
+  { 0x41,0x61,0x0B,0x18,0x85,0xF7,0x71,0x07 },
+  { 0x13,0x01,0x83,0x11,0xFA,0xE4,0x10,0x04 },
+  { 0x17,0xC1,0x24,0x07,0xF8,0xF8,0x22,0x12 },
+  { 0x61,0x50,0x0C,0x05,0xC2,0xF5,0x20,0x42 },
+  { 0x01,0x01,0x55,0x03,0xC9,0x95,0x03,0x02 },
+  { 0x61,0x41,0x89,0x03,0xF1,0xE4,0x40,0x13 },
+  { 0x01,0x01,0x18,0x0F,0xDF,0xF8,0x6A,0x6D },
+  { 0x01,0x01,0x00,0x00,0xC8,0xD8,0xA7,0x48 },
+  { 0x05,0x01,0x00,0x00,0xF8,0xAA,0x59,0x55 }
+};
+
+static const uint8_t Multi[16] =
+{ 1,2,4,6,8,10,12,14,16,18,20,20,24,24,30,30 };
+
+static const uint8_t KSLTab[16] =
+{ 0,32,40,45,48,51,53,55,56,58,59,60,61,62,63,64 };
+
+static const uint8_t StepHi[4][4] =
+{ { 0,0,0,0 },{ 1,0,0,0 },{ 1,0,1,0 },{ 1,1,1,0 } };
+
+/** Quarter-wave -log2(sin)*256 and 1024*2^((255-x)/256),   **/
+/** same as the logsin and exp ROMs of the real chip.       **/
+static const uint16_t QSin[256] =
+{
+  0x859,0x6c3,0x607,0x58b,0x52e,0x4e4,0x4a6,0x471,0x443,0x41a,0x3f5,0x3d3,
+  0x3b5,0x398,0x37e,0x365,0x34e,0x339,0x324,0x311,0x2ff,0x2ed,0x2dc,0x2cd,
+  0x2bd,0x2af,0x2a0,0x293,0x286,0x279,0x26d,0x261,0x256,0x24b,0x240,0x236,
+  0x22c,0x222,0x218,0x20f,0x206,0x1fd,0x1f5,0x1ec,0x1e4,0x1dc,0x1d4,0x1cd,
+  0x1c5,0x1be,0x1b7,0x1b0,0x1a9,0x1a2,0x19b,0x195,0x18f,0x188,0x182,0x17c,
+  0x177,0x171,0x16b,0x166,0x160,0x15b,0x155,0x150,0x14b,0x146,0x141,0x13c,
+  0x137,0x133,0x12e,0x129,0x125,0x121,0x11c,0x118,0x114,0x10f,0x10b,0x107,
+  0x103,0x0ff,0x0fb,0x0f8,0x0f4,0x0f0,0x0ec,0x0e9,0x0e5,0x0e2,0x0de,0x0db,
+  0x0d7,0x0d4,0x0d1,0x0cd,0x0ca,0x0c7,0x0c4,0x0c1,0x0be,0x0bb,0x0b8,0x0b5,
+  0x0b2,0x0af,0x0ac,0x0a9,0x0a7,0x0a4,0x0a1,0x09f,0x09c,0x099,0x097,0x094,
+  0x092,0x08f,0x08d,0x08a,0x088,0x086,0x083,0x081,0x07f,0x07d,0x07a,0x078,
+  0x076,0x074,0x072,0x070,0x06e,0x06c,0x06a,0x068,0x066,0x064,0x062,0x060,
+  0x05e,0x05c,0x05b,0x059,0x057,0x055,0x053,0x052,0x050,0x04e,0x04d,0x04b,
+  0x04a,0x048,0x046,0x045,0x043,0x042,0x040,0x03f,0x03e,0x03c,0x03b,0x039,
+  0x038,0x037,0x035,0x034,0x033,0x031,0x030,0x02f,0x02e,0x02d,0x02b,0x02a,
+  0x029,0x028,0x027,0x026,0x025,0x024,0x023,0x022,0x021,0x020,0x01f,0x01e,
+  0x01d,0x01c,0x01b,0x01a,0x019,0x018,0x017,0x017,0x016,0x015,0x014,0x014,
+  0x013,0x012,0x011,0x011,0x010,0x00f,0x00f,0x00e,0x00d,0x00d,0x00c,0x00c,
+  0x00b,0x00a,0x00a,0x009,0x009,0x008,0x008,0x007,0x007,0x007,0x006,0x006,
+  0x005,0x005,0x005,0x004,0x004,0x004,0x003,0x003,0x003,0x002,0x002,0x002,
+  0x002,0x001,0x001,0x001,0x001,0x001,0x001,0x001,0x000,0x000,0x000,0x000,
+  0x000,0x000,0x000,0x000
+};
+
+static const uint16_t Exp[256] =
+{
+  0x7fa,0x7f5,0x7ef,0x7ea,0x7e4,0x7df,0x7da,0x7d4,0x7cf,0x7c9,0x7c4,0x7bf,
+  0x7b9,0x7b4,0x7ae,0x7a9,0x7a4,0x79f,0x799,0x794,0x78f,0x78a,0x784,0x77f,
+  0x77a,0x775,0x770,0x76a,0x765,0x760,0x75b,0x756,0x751,0x74c,0x747,0x742,
+  0x73d,0x738,0x733,0x72e,0x729,0x724,0x71f,0x71a,0x715,0x710,0x70b,0x706,
+  0x702,0x6fd,0x6f8,0x6f3,0x6ee,0x6e9,0x6e5,0x6e0,0x6db,0x6d6,0x6d2,0x6cd,
+  0x6c8,0x6c4,0x6bf,0x6ba,0x6b5,0x6b1,0x6ac,0x6a8,0x6a3,0x69e,0x69a,0x695,
+  0x691,0x68c,0x688,0x683,0x67f,0x67a,0x676,0x671,0x66d,0x668,0x664,0x65f,
+  0x65b,0x657,0x652,0x64e,0x649,0x645,0x641,0x63c,0x638,0x634,0x630,0x62b,
+  0x627,0x623,0x61e,0x61a,0x616,0x612,0x60e,0x609,0x605,0x601,0x5fd,0x5f9,
+  0x5f5,0x5f0,0x5ec,0x5e8,0x5e4,0x5e0,0x5dc,0x5d8,0x5d4,0x5d0,0x5cc,0x5c8,
+  0x5c4,0x5c0,0x5bc,0x5b8,0x5b4,0x5b0,0x5ac,0x5a8,0x5a4,0x5a0,0x59c,0x599,
+  0x595,0x591,0x58d,0x589,0x585,0x581,0x57e,0x57a,0x576,0x572,0x56f,0x56b,
+  0x567,0x563,0x560,0x55c,0x558,0x554,0x551,0x54d,0x549,0x546,0x542,0x53e,
+  0x53b,0x537,0x534,0x530,0x52c,0x529,0x525,0x522,0x51e,0x51b,0x517,0x514,
+  0x510,0x50c,0x509,0x506,0x502,0x4ff,0x4fb,0x4f8,0x4f4,0x4f1,0x4ed,0x4ea,
+  0x4e7,0x4e3,0x4e0,0x4dc,0x4d9,0x4d6,0x4d2,0x4cf,0x4cc,0x4c8,0x4c5,0x4c2,
+  0x4be,0x4bb,0x4b8,0x4b5,0x4b1,0x4ae,0x4ab,0x4a8,0x4a4,0x4a1,0x49e,0x49b,
+  0x498,0x494,0x491,0x48e,0x48b,0x488,0x485,0x482,0x47e,0x47b,0x478,0x475,
+  0x472,0x46f,0x46c,0x469,0x466,0x463,0x460,0x45d,0x45a,0x457,0x454,0x451,
+  0x44e,0x44b,0x448,0x445,0x442,0x43f,0x43c,0x439,0x436,0x433,0x430,0x42d,
+  0x42a,0x428,0x425,0x422,0x41f,0x41c,0x419,0x416,0x414,0x411,0x40e,0x40b,
+  0x408,0x406,0x403,0x400
+};
+
+static uint16_t LogSin[1024];  /* Full wave, 0x8000=negative */
+
+/** InitTables() *********************************************/
+/** Unfold QSin[] into the full wave in LogSin[].           **/
+/*************************************************************/
+static void InitTables(void)
+{
+  int J;
+
+  if(LogSin[0]) return;
+  /* Quarter wave is mirrored, second half-wave is negative */
+  for(J=0;J<1024;J++)
+    LogSin[J] = QSin[J&0x100? (J&0xFF)^0xFF:J&0xFF]|(J&0x200? 0x8000:0);
+}
+
+/** SetInc() *************************************************/
+/** Compute phase steps of a slot of channel Ch, including  **/
+/** current vibrato.                                        **/
+/*************************************************************/
+static void SetInc(FastOPLL *D,OPLLSlot *S,int Ch)
+{
+  unsigned int F;
+
+  F = (D->R[0x10+Ch]|((D->R[0x20+Ch]&1)<<8))<<1;
+  if(S->VIB)
+    switch(D->Vib)
+    {
+      case 1: case 3: F+=F>>8;break;
+      case 2:         F+=F>>7;break;
+      case 5: case 7: F-=F>>8;break;
+      case 6:         F-=F>>7;break;
+    }
+  F = (F<<((D->R[0x20+Ch]>>1)&7))>>1;
+  S->Inc  = (F*S->Mul)>>1;
+  S->PInc = (uint32_t)(((uint64_t)S->Inc*D->Step)>>3);
+}
+
+/** SetChannel() *********************************************/
+/** Refresh both slots of channel Ch from OPLL registers.   **/
+/*************************************************************/
+static void SetChannel(FastOPLL *D,int Ch)
+{
+  const uint8_t *P;
+  OPLLSlot *S;
+  int FNum,Block,Drum,J,I;
+
+  FNum  = D->R[0x10+Ch]|((D->R[0x20+Ch]&1)<<8);
+  Block = (D->R[0x20+Ch]>>1)&7;
+  Drum  = (Ch>=6)&&(D->R[0x0E]&0x20);
+  P     = Drum? ROM[Ch+9]:(D->R[0x30+Ch]>>4)? ROM[(D->R[0x30+Ch]>>4)-1]:D->R;
+
+  for(J=0;J<2;J++)
+  {
+    S = &D->S[Ch*2+J];
+    S->AM   = P[J]>>7;
+    S->VIB  = (P[J]>>6)&1;
+    S->ET   = (P[J]>>5)&1;
+    S->Mul  = Multi[P[J]&0x0F];
+    S->KSR  = ((Block<<1)|(FNum>>8))>>(P[J]&0x10? 0:2);
+    S->AR   = P[4+J]>>4;
+    S->DR   = P[4+J]&0x0F;
+    S->SL   = P[6+J]>>4;
+    S->RR   = P[6+J]&0x0F;
+    S->Rect = (P[3]>>(J? 4:3))&1;
+    S->FB   = J? 0:P[3]&7;
+    S->Car  = J? 1:Drum&&(Ch>6)? 2:0;
+    S->Son  = (D->R[0x20+Ch]>>5)&1;
+    S->Key  = (D->R[0x20+Ch]>>4)&1;
+
+    /* Key scaling, then total level or channel volume */
+    I = KSLTab[FNum>>5]-((8-Block)<<3);
+    I = (I<0)||!(P[2+J]>>6)? 0:(I<<1)>>(3-(P[2+J]>>6));
+    I+= J? (D->R[0x30+Ch]&0x0F)<<3
+       : Drum&&(Ch>6)? (D->R[0x30+Ch]>>4)<<3
+       : (P[2]&0x3F)<<1;
+    S->KSLTL = I>127? 127:I;
+
+    SetInc(D,S,Ch);
+  }
+
+  /* Rhythm keys: BD=6/both, HH=7/mod, SD=7/car, TOM=8/mod, TC=8/car */
+  if(Drum)
+  {
+    J = D->R[0x0E];
+    if(Ch==6) { D->S[12].Key|=(J>>4)&1;D->S[13].Key|=(J>>4)&1; }
+    if(Ch==7) { D->S[14].Key|=J&1;D->S[15].Key|=(J>>3)&1; }
+    if(Ch==8) { D->S[16].Key|=(J>>2)&1;D->S[17].Key|=(J>>1)&1; }
+  }
+}
+
+/** Ffs() ****************************************************/
+/** Return position of the lowest set bit of V plus 1, or 0 **/
+/** when V=0. This is what the bit-serial EG timer locks.   **/
+/*************************************************************/
+static int Ffs(uint32_t V)
+{
+  int J;
+  if(!V) return(0);
+  for(J=1;!(V&1);J++) V>>=1;
+  return(J);
+}
+
+/** Envelope() ***********************************************/
+/** Advance envelope of slot S by one OPLL sample. C is the **/
+/** OPLL sample counter that paces slow rates.              **/
+/*************************************************************/
+static void Envelope(OPLLSlot *S,uint32_t C)
+{
+  int L,Off,R,H,Lo,Hi,IncLo,Z,Step;
+
+  L   = S->Level;
+  Off = (L>>2)==0x1F;
+
+  /* Key off releases, key on restarts a released slot */
+  if(!S->Key) S->State=EG_RELEASE;
+  else if((S->State==EG_RELEASE)&&Off)
+  {
+    S->State = EG_ATTACK;
+    /* Modulators restart their phase along with the carrier */
+    if(S->Car) S->Phase=0;
+    if((S->Car==1)&&!S[-1].Car) S[-1].Phase=0;
+    R = (S->AR<<2)+S->KSR;
+    if(S->AR&&(R>=60)) S->Level=0;
+    return;
+  }
+
+  /* Silent slots settle at maximal attenuation */
+  if((S->State!=EG_ATTACK)&&Off) { S->Level=0x7F;return; }
+
+  /* State changes do not depend on the rate */
+  if((S->State==EG_ATTACK)&&!L) { S->State=EG_DECAY;return; }
+  if((S->State==EG_DECAY)&&((L>>3)==S->SL)) { S->State=EG_SUSTAIN;return; }
+
+  switch(S->State)
+  {
+    case EG_ATTACK:  R=S->AR;break;
+    case EG_DECAY:   R=S->DR;break;
+    case EG_SUSTAIN: R=S->ET? 0:S->RR;break;
+    default:         R=S->Son? 5:S->RR;break;
+  }
+  if(!S->Key&&!S->Car) R=0;
+  if(S->Key&&(S->State==EG_RELEASE)) R=12;
+  if(!S->Key&&!S->Son&&(S->Car==1)&&!S->ET) R=7;
+  if(!R) return;
+
+  R = (R<<2)+S->KSR;
+  if(R&0x40) R=0x3C|(S->KSR&3);
+  H  = R>>2;
+  Lo = R&3;
+  Hi = StepHi[Lo][(C>>2)&3];
+
+  /* Slow rates step when the timer's lowest set bit fits */
+  IncLo = 0;
+  if(H<12)
+  {
+    Z = Ffs(C>>2);
+    Z = (Z>13? 0:Z)+H;
+    IncLo = (Z==12)||((Z==13)&&(Lo&2))||((Z==14)&&(Lo&1));
+  }
+
+  if(S->State==EG_ATTACK)
+  {
+    if(H==15) return;
+    Z = H<12? IncLo:H-11+Hi;
+    if(Z>0) S->Level=L+(~L>>(5-Z));
+    return;
+  }
+
+  Step = ((H==15)||((H==14)&&Hi))<<1;
+  Step|= ((H==14)&&!Hi)||((H==13)&&Hi)
+       ||((H==13)&&!Hi&&(C&1))
+       ||((H==12)&&Hi&&(C&1))
+       ||((H==12)&&!Hi&&((C&3)==3))
+       ||(IncLo&&((C&3)==3));
+
+  L+=Step;
+  S->Level = L>0x7F? 0x7F:L;
+}
+
+/** Tick() ***************************************************/
+/** Advance envelopes, LFOs, and noise by one OPLL sample.  **/
+/*************************************************************/
+static void Tick(FastOPLL *D)
+{
+  OPLLSlot *S;
+  uint32_t C;
+  int J;
+
+  C = D->Count++;
+
+  /* Tremolo: triangle between 0 and 105, one step per 64 samples */
+  D->AMOut = (D->AM>>3)&0x0F;
+  if(D->AMDir&&!(D->AM&0x7F)) D->AMDir=0;
+  else if(!D->AMDir&&((D->AM&0x69)==0x69)) D->AMDir=1;
+  if((C&0x3F)==0x3F) D->AM=(D->AM+(D->AMDir? 0x1FF:1))&0x1FF;
+
+  /* Vibrato: 8 steps, one per 1024 samples */
+  if((C&0x3FF)==0x3FF)
+  {
+    D->Vib=(D->Vib+1)&7;
+    for(J=0;J<18;J++) if(D->S[J].VIB) SetInc(D,&D->S[J],J>>1);
+  }
+
+  /* Noise is clocked at every one of 18 OPLL cycles. With */
+  /* taps at bits 0 and 14, 9 steps can be done at once,    */
+  /* except when leaving the initial zero state.            */
+  if(!D->Noise)
+    for(J=0;J<18;J++)
+      D->Noise=((((D->Noise^(D->Noise>>14))&1)|!D->Noise)<<22)|(D->Noise>>1);
+  else
+  {
+    D->Noise = (D->Noise>>9)|(((D->Noise^(D->Noise>>14))&0x1FF)<<14);
+    D->Noise = (D->Noise>>9)|(((D->Noise^(D->Noise>>14))&0x1FF)<<14);
+  }
+
+  /* Envelopes, skipping slots that are off for good */
+  for(J=0,S=D->S;J<18;J++,S++)
+    if(S->Key||(S->Level<0x7F)||(S->State!=EG_RELEASE))
+      Envelope(S,C);
+}
+
+/** Op() *****************************************************/
+/** Compute output of slot S at 10-bit phase P.             **/
+/*************************************************************/
+static int Op(FastOPLL *D,OPLLSlot *S,int P)
+{
+  int L,V,O;
+
+  if(S->Level==0x7F) return(0);
+  L = S->Level+S->KSLTL+(S->AM? D->AMOut:0);
+  V = LogSin[P&0x3FF];
+  L = (V&0x0FFF)+((L>127? 127:L)<<4);
+  L = L>4095? 4095:L;
+  O = Exp[L&0xFF]>>(L>>8);
+  return(!(V&0x8000)? O:S->Rect? -1:~O);
+}
+
+/** Render() *************************************************/
+/** Render samples up to position N in the frame buffer.    **/
+/*************************************************************/
+static void Render(FastOPLL *D,int N)
+{
+  OPLLSlot *M,*C;
+  int J,Drum,Out,Mod,F,HH,TC,Bit;
+  uint32_t Noise;
+
+  /* Samples rendered past the last frame start this one */
+  if(D->Done)
+  {
+    memmove(D->Buf,D->Buf+D->Done,(D->Pos-D->Done)*sizeof(D->Buf[0]));
+    D->Pos-= D->Done;
+    D->Done = 0;
+  }
+
+  N = N<OPLL_BUFFER? N:OPLL_BUFFER;
+  Drum = D->R[0x0E]&0x20;
+
+  for(;D->Pos<N;D->Pos++)
+  {
+    /* Advance OPLL time, rhythm uses noise from before that */
+    Noise   = D->Noise;
+    D->Acc += D->Step;
+    for(J=D->Acc>>16;J;J--) Tick(D);
+    D->Acc&=0xFFFF;
+
+    /* Melodic channels */
+    for(J=0,Out=0;J<(Drum? 6:9);J++)
+    {
+      M = &D->S[J*2];
+      C = M+1;
+      /* Phases run on while the carrier is silent */
+      if(C->Level==0x7F)
+      {
+        M->Phase+= M->PInc;
+        C->Phase+= C->PInc;
+        continue;
+      }
+      F = M->FB? (M->Out[0]+M->Out[1])>>(8-M->FB):0;
+      Mod = Op(D,M,(M->Phase>>22)+F);
+      M->Out[1] = M->Out[0];
+      M->Out[0] = Mod;
+      Out+= Op(D,C,(C->Phase>>22)+(Mod<<1))>>3;
+      M->Phase+= M->PInc;
+      C->Phase+= C->PInc;
+    }
+
+    /* Rhythm: BD is a regular channel, the rest use phase */
+    /* bits of HH and TC mixed with noise                  */
+    if(Drum)
+    {
+      M = &D->S[12];
+      C = M+1;
+      F = M->FB? (M->Out[0]+M->Out[1])>>(8-M->FB):0;
+      Mod = Op(D,M,(M->Phase>>22)+F);
+      M->Out[1] = M->Out[0];
+      M->Out[0] = Mod;
+      Mod = Op(D,C,(C->Phase>>22)+(Mod<<1))>>3;
+      M->Phase+= M->PInc;
+      C->Phase+= C->PInc;
+
+      HH  = D->S[14].Phase>>22;
+      TC  = (D->S[17].Phase-D->S[17].PInc)>>22;
+      Bit = (((HH>>2)^(HH>>7))|((HH>>3)^(TC>>5))|((TC>>3)^(TC>>5)))&1;
+      F   = (Bit<<9)|((Bit^(Noise>>13))&1? 0xD0:0x34);
+      Mod+= Op(D,&D->S[14],F)>>3;
+      F   = ((HH>>8)&1)<<9|((((HH>>8)^(Noise>>16))&1)<<8);
+      Mod+= Op(D,&D->S[15],F)>>3;
+      Mod+= Op(D,&D->S[16],D->S[16].Phase>>22)>>3;
+      HH  = (D->S[14].Phase-D->S[14].PInc)>>22;
+      Bit = (((HH>>2)^(HH>>7))|((HH>>3)^(TC>>5))|((TC>>3)^(TC>>5)))&1;
+      Mod+= Op(D,&D->S[17],(Bit<<9)|0x100)>>3;
+      for(J=14;J<18;J++) D->S[J].Phase+=D->S[J].PInc;
+
+      Out+= Mod*2;
+    }
+
+    D->Buf[D->Pos] = Out;
+  }
+}
+
+/** ResetOPLL() **********************************************/
+/** Reset the sound chip. No samples are rendered until the **/
+/** first FlushOPLL() call tells how long a frame is.       **/
+/*************************************************************/
+void ResetOPLL(FastOPLL *D)
+{
+  int J;
+
+  InitTables();
+  memset(D,0,sizeof(FastOPLL));
+  for(J=0;J<18;J++)
+  {
+    D->S[J].Level = 0x7F;
+    D->S[J].State = EG_RELEASE;
+  }
+  for(J=0;J<9;J++) SetChannel(D,J);
+}
+
+/** WrCtrlOPLL() *********************************************/
+/** Write a value V to the OPLL Control Port.               **/
+/*************************************************************/
+void WrCtrlOPLL(FastOPLL *D,uint8_t V)
+{
+  D->Latch=V&0x3F;
+}
+
+/** WrDataOPLL() *********************************************/
+/** Write a value V to the OPLL Data Port. It takes effect  **/
+/** at the next sample SyncOPLL() renders.                  **/
+/*************************************************************/
+void WrDataOPLL(FastOPLL *D,uint8_t V)
+{
+  int R,J;
+
+  R = D->Latch;
+  if(R<0x10)
+  {
+    if((R>7)&&(R!=0x0E)) return;
+    D->R[R]=V;
+    /* Custom instrument changed, or rhythm mode switched */
+    for(J=R==0x0E? 6:0;J<9;J++)
+      if((R==0x0E)||!(D->R[0x30+J]>>4)) SetChannel(D,J);
+    return;
+  }
+
+  /* Channels 9..15 alias channels 0..6 */
+  J = R&0x0F;
+  if(J>8) J-=9;
+  D->R[(R&0x30)+J]=V;
+  SetChannel(D,J);
+}
+
+/** SyncOPLL() ***********************************************/
+/** Advance emulated time by Ticks out of a Period-long     **/
+/** frame and render samples up to that point.              **/
+/*************************************************************/
+void SyncOPLL(FastOPLL *D,int Ticks,int Period)
+{
+  D->Ticks += Ticks;
+  D->Period = Period;
+  if(D->Frame&&D->Step)
+    Render(D,(int)((int64_t)D->Ticks*D->Frame/Period));
+}
+
+/** FlushOPLL() **********************************************/
+/** Render the rest of the frame, up to Samples samples in  **/
+/** total, and start a new frame. Returns frame samples in  **/
+/** the same units as NukeYKT output.                       **/
+/*************************************************************/
+const int16_t *FlushOPLL(FastOPLL *D,int Samples)
+{
+  uint32_t Step;
+  int J;
+
+  /* OPLL samples per output sample follow the frame length */
+  if(Samples>0)
+  {
+    Step = (uint32_t)((((uint64_t)(D->Period? D->Period:D->Ticks))<<16)/OPLL_TICKS/Samples);
+    if(Step&&(Step!=D->Step))
+    {
+      D->Step=Step;
+      for(J=0;J<18;J++) SetInc(D,&D->S[J],J>>1);
+    }
+  }
+
+  D->Frame = Samples;
+  if(D->Step) Render(D,Samples);
+  else memset(D->Buf,0,sizeof(D->Buf));
+
+  /* SyncOPLL() may have gone past a frame shorter than the */
+  /* last one, keep these samples for the next frame        */
+  D->Done  = Samples>0? Samples:D->Pos;
+  D->Pos   = D->Pos>D->Done? D->Pos:D->Done;
+  D->Ticks = 0;
+  return(D->Buf);
+}
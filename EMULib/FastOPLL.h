@@ -0,0 +1,111 @@
+/** EMULib Emulation Library *********************************/
+/**                                                         **/
+/**                        FastOPLL.h                       **/
+/**                                                         **/
+/** This file contains definitions and declarations for a   **/
+/** table-driven OPLL (YM2413) synthesizer. Unlike YM2413.c **/
+/** it renders actual FM operators, and unlike NukeYKT it   **/
+/** evaluates each operator once per output sample instead  **/
+/** of clocking the chip 18 times per OPLL sample. See      **/
+/** FastOPLL.c for the code.                                **/
+/**                                                         **/
+/** Instrument ROM and envelope rules follow Nuked-OPLL by  **/
+/** nukeykt (GPL2, see NukeYKT/LICENSE).                    **/
+/*************************************************************/
+#ifndef FASTOPLL_H
+#define FASTOPLL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OPLL_BUFFER 1024       /* Max samples in a frame     */
+
+/** OPLLSlot *************************************************/
+/** State of one operator. Each channel has two of these,   **/
+/** the modulator followed by the carrier.                  **/
+/*************************************************************/
+typedef struct
+{
+  uint32_t Phase;      /* Phase, 10 bits + 22 bits fraction  */
+  uint32_t PInc;       /* Phase step per output sample       */
+  uint32_t Inc;        /* Phase step per OPLL sample         */
+  int16_t Out[2];      /* Last two outputs, for feedback     */
+  uint8_t Level;       /* Envelope, 0..127 in .375dB steps   */
+  uint8_t State;       /* EG_ATTACK, EG_DECAY, etc.          */
+  uint8_t Key;         /* 1: Key on (melody or rhythm)       */
+  uint8_t KSLTL;       /* Key scaled and total attenuation   */
+  uint8_t KSR;         /* Key scaled rate addition, 0..15    */
+  uint8_t AR,DR,SL,RR; /* Attack/Decay/Sustain/Release       */
+  uint8_t AM,VIB,ET;   /* Tremolo, vibrato, sustained tone   */
+  uint8_t Mul;         /* Frequency multiplier, x2           */
+  uint8_t Car;         /* 1: Carrier, 2: HH/TOM, 0: Modul.   */
+  uint8_t Son;         /* 1: Channel sustain is on           */
+  uint8_t Rect;        /* 1: Half-wave rectified (DC/DM)     */
+  uint8_t FB;          /* Feedback, 0..7 (modulators only)   */
+} OPLLSlot;
+
+/** FastOPLL *************************************************/
+/** This data structure stores OPLL state and the samples   **/
+/** rendered for the current frame.                         **/
+/*************************************************************/
+#pragma pack(4)
+typedef struct
+{
+  OPLLSlot S[18];              /* Operators, 2 per channel   */
+  uint8_t R[64];               /* OPLL register contents     */
+  uint8_t Latch;               /* Register# to write         */
+  uint8_t Vib;                 /* Vibrato step, 0..7         */
+  uint8_t AMDir;               /* Tremolo going down         */
+  uint8_t AMOut;               /* Tremolo, 0..13             */
+  uint16_t AM;                 /* Tremolo counter            */
+  uint32_t Noise;              /* Rhythm noise generator     */
+  uint32_t Count;              /* OPLL samples so far        */
+  uint32_t Acc;                /* OPLL sample fraction, Q16  */
+  uint32_t Step;               /* OPLL samples per sample    */
+  int Ticks;                   /* CPU time in this frame     */
+  int Period;                  /* CPU time of a frame        */
+  int Frame;                   /* Samples in a frame         */
+  int Pos;                     /* Samples rendered so far    */
+  int Done;                    /* Samples FlushOPLL() passed */
+  int16_t Buf[OPLL_BUFFER];    /* Samples of this frame      */
+} FastOPLL;
+#pragma pack()
+
+/** ResetOPLL() **********************************************/
+/** Reset the sound chip. No samples are rendered until the **/
+/** first FlushOPLL() call tells how long a frame is.       **/
+/*************************************************************/
+void ResetOPLL(FastOPLL *D);
+
+/** WrCtrlOPLL() *********************************************/
+/** Write a value V to the OPLL Control Port.               **/
+/*************************************************************/
+void WrCtrlOPLL(FastOPLL *D,uint8_t V);
+
+/** WrDataOPLL() *********************************************/
+/** Write a value V to the OPLL Data Port. It takes effect  **/
+/** at the next sample SyncOPLL() renders.                  **/
+/*************************************************************/
+void WrDataOPLL(FastOPLL *D,uint8_t V);
+
+/** SyncOPLL() ***********************************************/
+/** Advance emulated time by Ticks out of a Period-long     **/
+/** frame and render samples up to that point. Both are in  **/
+/** Z80 cycles at 3.58MHz, 72 cycles per OPLL sample.       **/
+/*************************************************************/
+void SyncOPLL(FastOPLL *D,int Ticks,int Period);
+
+/** FlushOPLL() **********************************************/
+/** Render the rest of the frame, up to Samples samples in  **/
+/** total, and start a new frame. Returns frame samples in  **/
+/** the same units as NukeYKT output.                       **/
+/*************************************************************/
+const int16_t *FlushOPLL(FastOPLL *D,int Samples);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* FASTOPLL_H */
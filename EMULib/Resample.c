@@ -0,0 +1,200 @@
+/** EMULib Emulation Library *********************************/
+/**                                                         **/
+/**                        Resample.c                       **/
+/**                                                         **/
+/** This file contains a fixed-point polyphase resampler.   **/
+/** Kaiser-windowed sinc kernels are computed once, for     **/
+/** RSMP_PHASES fractional positions, and each output is a  **/
+/** RSMP_TAPS long dot product of 16bit integers, which is  **/
+/** done with SSE2 or NEON when available. See Resample.h   **/
+/** for declarations.                                       **/
+/**                                                         **/
+/*************************************************************/
+#include "Resample.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#define PI   3.14159265358979323846
+#define BETA 6.0               /* Kaiser window, ~63dB stop  */
+
+/** Sin()/Sqrt()/I0() ****************************************/
+/** Plain arithmetic versions of the few math functions     **/
+/** needed to compute kernels, so that there is no libm     **/
+/** dependency. They are only used by InitResampler().      **/
+/*************************************************************/
+static double Sin(double X)
+{
+  double Y,T;
+  int J;
+
+  /* Reduce X to -PI..PI */
+  X-= 2.0*PI*(long)(X/(2.0*PI));
+  X = X>PI? X-2.0*PI:X<-PI? X+2.0*PI:X;
+
+  /* Taylor series, good to 1E-6 in this range */
+  for(J=1,Y=T=X;J<16;J+=2) { T*=-X*X/((J+1)*(J+2));Y+=T; }
+  return(Y);
+}
+
+static double Sqrt(double X)
+{
+  double Y;
+  int J;
+
+  if(X<=0.0) return(0.0);
+  for(J=0,Y=X>1.0? X:1.0;J<32;J++) Y=(Y+X/Y)/2.0;
+  return(Y);
+}
+
+static double I0(double X)
+{
+  double Y,T;
+  int J;
+
+  /* Modified Bessel function of the first kind, order 0 */
+  for(J=1,Y=T=1.0;(J<64)&&(T>1E-12*Y);J++) { T*=X*X/(4.0*J*J);Y+=T; }
+  return(Y);
+}
+
+/** Dot() ****************************************************/
+/** Multiply RSMP_TAPS input samples by a kernel and add.   **/
+/*************************************************************/
+static inline int Dot(const int16_t *H,const int16_t *C)
+{
+#if defined(__SSE2__)
+  __m128i A;
+  int J;
+
+  A = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)H),_mm_loadu_si128((const __m128i *)C));
+  for(J=8;J<RSMP_TAPS;J+=8)
+    A = _mm_add_epi32(A,_mm_madd_epi16(_mm_loadu_si128((const __m128i *)(H+J)),_mm_loadu_si128((const __m128i *)(C+J))));
+  A = _mm_add_epi32(A,_mm_shuffle_epi32(A,0x4E));
+  A = _mm_add_epi32(A,_mm_shuffle_epi32(A,0xB1));
+  return(_mm_cvtsi128_si32(A));
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  int32x4_t A;
+  int32x2_t B;
+  int J;
+
+  A = vmull_s16(vld1_s16(H),vld1_s16(C));
+  for(J=4;J<RSMP_TAPS;J+=4) A=vmlal_s16(A,vld1_s16(H+J),vld1_s16(C+J));
+  B = vadd_s32(vget_low_s32(A),vget_high_s32(A));
+  return(vget_lane_s32(vpadd_s32(B,B),0));
+#else
+  int J,A;
+
+  for(J=A=0;J<RSMP_TAPS;J++) A+=H[J]*C[J];
+  return(A);
+#endif
+}
+
+/** InitResampler() ******************************************/
+/** Compute kernels for resampling from InRate to OutRate.  **/
+/** Only the ratio of the two rates matters: it sets the    **/
+/** low-pass cutoff and the nominal input step.             **/
+/*************************************************************/
+void InitResampler(Resampler *R,unsigned int InRate,unsigned int OutRate)
+{
+  double Fc,T,X,W,H[RSMP_TAPS],S;
+  int P,J,M,V,Sum;
+
+  /* Cut off below the lower Nyquist rate, leaving room for */
+  /* the Kaiser transition band of (A-8)/14.36/RSMP_TAPS    */
+  Fc = (InRate<OutRate? InRate:OutRate)/2.0/InRate;
+  Fc-= (BETA/0.1102+8.7-8.0)/14.36/RSMP_TAPS/2.0;
+
+  for(P=0;P<RSMP_PHASES;P++)
+  {
+    /* Tap J is at T input samples from the output position */
+    for(J=0,S=0.0;J<RSMP_TAPS;J++)
+    {
+      T = J-(RSMP_TAPS/2-1)-(double)P/RSMP_PHASES;
+      X = T/(RSMP_TAPS/2);
+      W = X*X<1.0? I0(BETA*Sqrt(1.0-X*X))/I0(BETA):0.0;
+      H[J] = W*(T!=0.0? Sin(2.0*PI*Fc*T)/(PI*T):2.0*Fc);
+      S+= H[J];
+    }
+
+    /* Each kernel sums up to exactly 1<<RSMP_BITS, with the */
+    /* rounding error going to the largest tap, so that DC   */
+    /* passes unchanged                                      */
+    for(J=M=Sum=0;J<RSMP_TAPS;J++)
+    {
+      V = (int)(H[J]/S*(1<<RSMP_BITS)+(H[J]<0.0? -0.5:0.5));
+      R->Kernel[P][J] = V;
+      Sum+= V;
+      if(V>R->Kernel[P][M]) M=J;
+    }
+    R->Kernel[P][M]+= (1<<RSMP_BITS)-Sum;
+  }
+
+  R->Step = ((uint64_t)InRate<<16)/OutRate;
+  ResetResampler(R);
+}
+
+/** ResetResampler() *****************************************/
+/** Forget queued input, keeping the kernels.               **/
+/*************************************************************/
+void ResetResampler(Resampler *R)
+{
+  memset(R->Hist,0,RSMP_TAPS*sizeof(R->Hist[0]));
+  R->Len = RSMP_TAPS;
+  R->Pos = 0;
+  R->Acc = 0;
+}
+
+/** Resample() ***********************************************/
+/** Queue InN samples from In, then add OutN samples, times **/
+/** Gain, to Out. The input step is nominal ratio, slowly   **/
+/** corrected to keep RSMP_QUEUE samples queued, so that    **/
+/** the stream never drifts, yet InN varying from call to   **/
+/** call does not make pitch wobble. The output is delayed  **/
+/** by RSMP_TAPS/2+RSMP_QUEUE input samples.                **/
+/*************************************************************/
+void Resample(Resampler *R,int *Out,unsigned int OutN,const int16_t *In,unsigned int InN,int Gain)
+{
+  int P,Step,B,E,N;
+  unsigned int K;
+  int64_t A;
+
+  if(!OutN) return;
+
+  /* Queue new input, dropping what does not fit */
+  N = sizeof(R->Hist)/sizeof(R->Hist[0])-R->Len;
+  N = (int)InN<N? (int)InN:N;
+  memcpy(R->Hist+R->Len,In,N*sizeof(R->Hist[0]));
+  R->Len+= N;
+
+  /* Room left for output positions. When far behind, i.e. */
+  /* after sound was paused, skip ahead instead of racing  */
+  B = ((R->Len-RSMP_TAPS)<<16)-R->Pos;
+  if(B>(RSMP_BUFFER<<16)) { R->Pos+=B-(RSMP_QUEUE<<16);B=RSMP_QUEUE<<16;R->Acc=0; }
+
+  /* Proportional-integral correction of the nominal step, */
+  /* so that RSMP_QUEUE samples stay after this call       */
+  E = B-(RSMP_QUEUE<<16)-(int)OutN*R->Step;
+  R->Acc+= E>>6;
+  Step = R->Step+(R->Acc+(E>>3))/(int)OutN;
+
+  /* Never step past the end of input */
+  N    = B>0? B/(int)OutN:0;
+  Step = Step<0? 0:Step>N? N:Step;
+
+  for(K=0,P=R->Pos;K<OutN;K++,P+=Step)
+  {
+    /* Integer part of P picks inputs, fraction picks kernel */
+    A = Dot(R->Hist+(P>>16),R->Kernel[(P&0xFFFF)*RSMP_PHASES>>16]);
+    Out[K]+= (int)((A*Gain+(1<<(RSMP_BITS-1)))>>RSMP_BITS);
+  }
+
+  /* Drop consumed input */
+  N = P>>16;
+  memmove(R->Hist,R->Hist+N,(R->Len-N)*sizeof(R->Hist[0]));
+  R->Len-= N;
+  R->Pos  = P&0xFFFF;
+}
@@ -0,0 +1,65 @@
+/** EMULib Emulation Library *********************************/
+/**                                                         **/
+/**                        Resample.h                       **/
+/**                                                         **/
+/** This file contains definitions and declarations for a   **/
+/** fixed-point polyphase resampler, used to mix in sound   **/
+/** chips that produce samples at their own native rate.    **/
+/** See Resample.c for the code.                            **/
+/**                                                         **/
+/*************************************************************/
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RSMP_TAPS   32         /* Input samples per output   */
+#define RSMP_PHASES 256        /* Kernels per input sample   */
+#define RSMP_BITS   14         /* Kernel fixed point bits    */
+#define RSMP_BUFFER 1024       /* Max input samples per call */
+#define RSMP_QUEUE  8          /* Input samples kept queued  */
+
+/** Resampler ************************************************/
+/** This data structure stores the windowed sinc kernels    **/
+/** and the input samples queued between calls.             **/
+/*************************************************************/
+typedef struct
+{
+  int16_t Kernel[RSMP_PHASES][RSMP_TAPS]; /* Kernel per phase */
+  int16_t Hist[RSMP_TAPS+2*RSMP_BUFFER];  /* Input samples    */
+  int Len;                     /* Samples in Hist[]          */
+  int Pos;                     /* Input position, Q16        */
+  int Step;                    /* InRate/OutRate, Q16        */
+  int Acc;                     /* Accumulated step error     */
+} Resampler;
+
+/** InitResampler() ******************************************/
+/** Compute kernels for resampling from InRate to OutRate.  **/
+/** Only the ratio of the two rates matters: it sets the    **/
+/** low-pass cutoff and the nominal input step.             **/
+/*************************************************************/
+void InitResampler(Resampler *R,unsigned int InRate,unsigned int OutRate);
+
+/** ResetResampler() *****************************************/
+/** Forget queued input, keeping the kernels.               **/
+/*************************************************************/
+void ResetResampler(Resampler *R);
+
+/** Resample() ***********************************************/
+/** Queue InN samples from In, then add OutN samples, times **/
+/** Gain, to Out. The input step is nominal ratio, slowly   **/
+/** corrected to keep RSMP_QUEUE samples queued, so that    **/
+/** the stream never drifts, yet InN varying from call to   **/
+/** call does not make pitch wobble. The output is delayed  **/
+/** by RSMP_TAPS/2+RSMP_QUEUE input samples.                **/
+/*************************************************************/
+void Resample(Resampler *R,int *Out,unsigned int OutN,const int16_t *In,unsigned int InN,int Gain);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* RESAMPLE_H */
@@ -11,6 +11,7 @@
 /**     changes to this file.                               **/
 /*************************************************************/
 #include "Sound.h"
+#include "Resample.h"
 #include "MSX.h"
 
 #include "../NukeYKT/WrapNukeYKT.h"
@@ -38,28 +39,31 @@ static struct
   int Pos;                        /* Wave current position in Data    */  
 
   int Count;                      /* Phase counter                    */
+  int Amp;                        /* Output level, before panning     */
+  int Pan;                        /* Panning (-256..256, 0=center)    */
+  int MAmp,SAmp;                  /* Levels sent to Delta[0]/Delta[1] */
 } WaveCH[SND_CHANNELS] =
 {
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 },
-  { SND_MELODIC,0,0,0,0,0,0,0 }
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 },
+  { SND_MELODIC,0,0,0,0,0,0,0,0,0,0,0 }
 };
 
 /** RenderAudio() Variables *******************************************/
@@ -70,7 +74,77 @@ static int NoiseXor   = 14;       /* NoiseGen bit used for XORing     */
 int MasterSwitch      = 0xFFFF;   /* Switches to turn channels on/off */
 int MasterVolume      = 192;      /* Master volume                    */
 
+/** Band-Limited Steps ****************************************/
+/** Channels do not write samples. Instead, each change of  **/
+/** their output level is spread over BLEP_TAPS entries of  **/
+/** Delta[] with a band-limited step kernel, and Delta[] is **/
+/** integrated into the output once for all channels. The   **/
+/** output is delayed by BLEP_TAPS/2 samples.               **/
+/**                                                         **/
+/** Stereo output is kept as mid (L+R)/2 in Delta[0] and    **/
+/** side (R-L)/2 in Delta[1]. Centered channels only change **/
+/** the mid level, so side is not touched unless panned.    **/
+/*************************************************************/
+#define BLEP_TAPS   16            /* Delta[] entries per step         */
+#define BLEP_PHASES 32            /* Step kernels per sample          */
+#define BLEP_MAX    AUDIO_BUFFER_SIZE /* Max samples per RenderAudio() */
+
+/* Channel level X as sent to mid and side with panning P: */
+/* the far side is attenuated, the near side stays as is   */
+#define MID(X,P)    ((X)-(((X)*((P)<0? -(P):(P)))>>9))
+#define SIDE(X,P)   (((X)*(P))>>9)
+
+/* BlepTab[P] spreads a 1<<15 step starting P/BLEP_PHASES of a */
+/* sample late. Blackman-windowed sinc, cut off at 0.42 of the */
+/* sampling rate, each kernel summing up to exactly 1<<15.     */
+static const int16_t BlepTab[BLEP_PHASES][BLEP_TAPS] =
+{
+  { 1,-41,165,-349,372,279,-2639,18596,18596,-2639,279,372,-349,165,-41,1 },
+  { 2,-40,158,-317,287,440,-2875,17870,19293,-2367,108,457,-380,172,-41,1 },
+  { 2,-40,149,-284,205,592,-3077,17120,19963,-2060,-73,544,-410,177,-41,1 },
+  { 2,-39,141,-251,124,732,-3244,16348,20599,-1717,-261,631,-439,182,-40,0 },
+  { 2,-38,131,-218,47,860,-3378,15558,21201,-1337,-457,717,-466,185,-39,0 },
+  { 2,-36,122,-186,-26,976,-3480,14753,21761,-922,-658,802,-490,188,-37,-1 },
+  { 2,-35,112,-153,-97,1081,-3550,13937,22284,-471,-865,885,-513,188,-35,-2 },
+  { 2,-33,102,-122,-163,1172,-3591,13111,22761,15,-1074,966,-532,188,-32,-2 },
+  { 2,-31,92,-91,-224,1252,-3603,12280,23193,536,-1286,1043,-549,186,-29,-3 },
+  { 2,-29,82,-61,-281,1318,-3589,11446,23582,1090,-1499,1116,-562,182,-25,-4 },
+  { 2,-27,72,-33,-334,1372,-3548,10613,23922,1676,-1710,1185,-572,176,-21,-5 },
+  { 1,-25,62,-6,-381,1414,-3484,9784,24212,2294,-1919,1247,-577,169,-16,-7 },
+  { 1,-23,52,20,-423,1444,-3398,8961,24450,2941,-2124,1304,-579,160,-10,-8 },
+  { 1,-21,43,44,-460,1463,-3291,8148,24636,3616,-2323,1353,-577,149,-4,-9 },
+  { 1,-19,34,66,-492,1470,-3166,7347,24770,4318,-2514,1395,-569,136,2,-11 },
+  { 1,-17,25,86,-519,1466,-3023,6561,24853,5044,-2696,1428,-558,121,9,-13 },
+  { 1,-15,17,105,-541,1452,-2866,5793,24876,5793,-2866,1452,-541,105,17,-14 },
+  { 1,-13,9,121,-558,1428,-2696,5044,24852,6561,-3023,1466,-519,86,25,-16 },
+  { 1,-11,2,136,-569,1395,-2514,4318,24769,7347,-3166,1470,-492,66,34,-18 },
+  { 0,-10,-4,149,-577,1353,-2323,3616,24637,8148,-3291,1463,-460,44,43,-20 },
+  { 0,-8,-10,160,-579,1304,-2124,2941,24450,8961,-3398,1444,-423,20,52,-22 },
+  { 0,-7,-16,169,-577,1247,-1919,2294,24212,9784,-3484,1414,-381,-6,62,-24 },
+  { 0,-6,-21,176,-572,1185,-1710,1676,23923,10613,-3548,1372,-334,-33,72,-25 },
+  { 0,-4,-25,182,-562,1116,-1499,1090,23582,11446,-3589,1318,-281,-61,82,-27 },
+  { 0,-3,-29,186,-549,1043,-1286,536,23193,12280,-3603,1252,-224,-91,92,-29 },
+  { 0,-2,-32,188,-532,966,-1074,15,22761,13111,-3591,1172,-163,-122,102,-31 },
+  { 0,-2,-35,188,-513,885,-865,-471,22284,13937,-3550,1081,-97,-153,112,-33 },
+  { 0,-1,-37,188,-490,802,-658,-922,21761,14753,-3480,976,-26,-186,122,-34 },
+  { 0,0,-39,185,-466,717,-457,-1337,21201,15558,-3378,860,47,-218,131,-36 },
+  { 0,0,-40,182,-439,631,-261,-1717,20599,16348,-3244,732,124,-251,141,-37 },
+  { 0,1,-41,177,-410,544,-73,-2060,19963,17120,-3077,592,205,-284,149,-38 },
+  { 0,1,-41,172,-380,457,108,-2367,19294,17870,-2875,440,287,-317,158,-39 }};
+
+static int Delta[2][BLEP_MAX+BLEP_TAPS]; /* Mid/side level changes  */
+static int Level[2]   = { 0,0 };  /* Integrated Delta[]               */
+static int Sided      = 0;        /* 1: Delta[1] may be non-zero      */
+
+static int Mid[AUDIO_BUFFER_SIZE];  /* Mid  (L+R)/2 of a frame        */
+static int Side[AUDIO_BUFFER_SIZE]; /* Side (R-L)/2 of a frame        */
+static int FMBuf[AUDIO_BUFFER_SIZE];/* Panned NukeYKT samples         */
+static int16_t Out[2*AUDIO_BUFFER_SIZE]; /* Interleaved L/R output    */
+
+static Resampler OPLLRsmp;        /* NukeYKT rate to SndRate          */
+
 extern YM2413_NukeYKT OPLL_NukeYKT;
+extern FastOPLL OPLL_Fast;
 extern YM2413 OPLL;
 
 /** Sound() **************************************************/
@@ -124,6 +198,18 @@ void SetChannels(int Volume,int Switch)
   MasterSwitch = Switch&((1<<SND_CHANNELS)-1);
 }
 
+/** SetPanning() *********************************************/
+/** Set stereo panning of a given channel, from -256 (left) **/
+/** to 256 (right). Zero centers the channel.               **/
+/*************************************************************/
+void SetPanning(int Channel,int Pan)
+{
+  /* Channel has to be valid */
+  if((Channel<0)||(Channel>=SND_CHANNELS)) return;
+
+  WaveCH[Channel].Pan = Pan<-256? -256:Pan>256? 256:Pan;
+}
+
 /** SetNoise() ***********************************************/
 /** Initialize random noise generator to the given Seed and **/
 /** then take random output from OUTBit and XOR it with     **/
@@ -175,190 +261,212 @@ unsigned int InitSound(unsigned int Rate)
     WaveCH[I].Count  = 0;
     WaveCH[I].Volume = 0;
     WaveCH[I].Freq   = 0;
+    WaveCH[I].Amp    = 0;
+    WaveCH[I].MAmp   = 0;
+    WaveCH[I].SAmp   = 0;
   }
 
+  /* No pending level changes */
+  memset(Delta,0,sizeof(Delta));
+  Level[0] = Level[1] = 0;
+  Sided    = 0;
+
   /* Rate=0 means silence */
   if(!Rate) { SndRate=0;return(0); }
 
+  /* NukeYKT produces samples at its own rate */
+  InitResampler(&OPLLRsmp,NUKEYKT_RATE,Rate);
+
   /* Done */
   SetChannels(MasterVolume,MasterSwitch);
   return(SndRate=Rate);
 }
 
-/** RenderAudio() ********************************************/
-/** Render given number of melodic sound samples into an    **/
-/** integer buffer for mixing.                              **/
+/** Spread() *************************************************/
+/** Change level in D by V at time T, given in 1/32s of a   **/
+/** sample from the start of the current RenderAudio() run. **/
 /*************************************************************/
-static void RenderAudio(int *Wave,unsigned int Samples)
+static void Spread(int *D,unsigned int T,int V)
 {
-  int J,K,I,L1,L2,V,A1;
-#ifdef WAVE_INTERPOLATION
-  /* Keep GCC happy about variable initialization */
-  int A2 = 0;
-  int L  = 0;
-  int N  = 0;
-#endif
+  const int16_t *K;
+  int J,I,S;
 
-  /* Waveform generator */
-  for(J=0;J<SND_CHANNELS;J++)
-    if(WaveCH[J].Freq&&(V=WaveCH[J].Volume)&&(MasterSwitch&(1<<J)))
-      switch(WaveCH[J].Type)
-      {
-        case SND_WAVE: /* Custom Waveform */
-          /* Waveform data must have correct length! */
-          if(WaveCH[J].Length<=0) break;
-          /* Start counting */
-          K  = WaveCH[J].Rate>0?
-               (SndRate<<15)/WaveCH[J].Freq/WaveCH[J].Rate
-             : (SndRate<<15)/WaveCH[J].Freq/WaveCH[J].Length;
-          /* Do not allow high frequencies (GBC Frogger) */
-          if(K<0x8000) break;
-          L1 = WaveCH[J].Pos%WaveCH[J].Length;
-          L2 = WaveCH[J].Count;
-          A1 = WaveCH[J].Data[L1]*V;
-#if !defined(WAVE_INTERPOLATION)
-          /* Add waveform to the buffer */
-          for(I=0;I<Samples;I++)
-          {
-            /* If next step... */
-            if(L2>=K)
-            {
-              L1 = (L1+L2/K)%WaveCH[J].Length;
-              A1 = WaveCH[J].Data[L1]*V;
-              L2 = L2%K;
-            }
-            /* Output waveform */
-            Wave[I]+=A1;
-            /* Next waveform step */
-            L2+=0x8000;
-          }
-#else /* WAVE_INTERPOLATION */
-          /* If expecting interpolation... */
-          if(L2<K)
-          {
-            /* Compute interpolation parameters */
-            A2 = WaveCH[J].Data[(L1+1)%WaveCH[J].Length]*V;
-            L  = (L2>>15)+1;
-            N  = ((K-(L2&0x7FFF))>>15)+1;
-          }
-          /* Add waveform to the buffer */
-          for(I=0;I<Samples;I++)
-            if(L2<K)
-            {
-              /* Interpolate linearly */
-              Wave[I]+=A1+L*(A2-A1)/N;
-              /* Next waveform step */
-              L2+=0x8000;
-              /* Next interpolation step */
-              L++;
-            }
-            else
-            {
-              L1 = (L1+L2/K)%WaveCH[J].Length;
-              L2 = (L2%K)+0x8000;
-              A1 = WaveCH[J].Data[L1]*V;
-              Wave[I]+=A1;
-              /* If expecting interpolation... */
-              if(L2<K)
-              {
-                /* Compute interpolation parameters */
-                A2 = WaveCH[J].Data[(L1+1)%WaveCH[J].Length]*V;
-                L  = 1;
-                N  = ((K-L2)>>15)+1;
-              }
-            }
-#endif /* WAVE_INTERPOLATION */
-          /* End counting */
-          WaveCH[J].Pos   = L1;
-          WaveCH[J].Count = L2;
-          break;
-
-        case SND_NOISE: /* White Noise */
-          /* For high frequencies, recompute volume */
-          if(WaveCH[J].Freq<SndRate)
-            K=((unsigned int)WaveCH[J].Freq<<16)/SndRate;
-          else
-          {
-            V = V*SndRate/WaveCH[J].Freq;
-            K = 0x10000;
-          }
-          L1=WaveCH[J].Count;
-          for(I=0;I<Samples;I++)
-          {
-            /* Use NoiseOut bit for output */
-            Wave[I]+=((NoiseGen>>NoiseOut)&1? 127:-128)*V;
-            L1+=K;
-            if(L1&0xFFFF0000)
-            {
-              /* XOR NoiseOut and NoiseXOR bits and feed them back */
-              NoiseGen=
-                (((NoiseGen>>NoiseOut)^(NoiseGen>>NoiseXor))&1)
-              | ((NoiseGen<<1)&((2<<NoiseOut)-1));
-              L1&=0xFFFF;
-            }
-          }
-          WaveCH[J].Count=L1;
-          break;
-
-        case SND_MELODIC:  /* Melodic Sound   */
-        case SND_TRIANGLE: /* Triangular Wave */
-        default:           /* Default Sound   */
-          /* Do not allow frequencies that are too high */
-          if(WaveCH[J].Freq>=SndRate/2) break;
-          K=0x10000*WaveCH[J].Freq/SndRate;
-          L1=WaveCH[J].Count;
-#if !defined(SLOW_MELODIC_AUDIO)
-          for(I=0;I<Samples;I++,L1+=K)
-            Wave[I]+=((L1-K)^(L1+K))&0x8000? 0:(L1&0x8000? 127:-128)*V;
-#else /* SLOW_MELODIC_AUDIO */
-          for(I=0;I<Samples;I++,L1+=K)
-          {
-            L2 = L1+K;
-            A1 = L1&0x8000? 127:-128;
-            if((L1^L2)&0x8000)
-              A1=A1*(0x8000-(L1&0x7FFF)-(L2&0x7FFF))/K;
-            Wave[I]+=A1*V;
-          }
-#endif /* SLOW_MELODIC_AUDIO */
-          WaveCH[J].Count=L1&0xFFFF;
-          break;
-      }
+  if(!V) return;
+
+  K = BlepTab[T&(BLEP_PHASES-1)];
+  D+= T/BLEP_PHASES;
+
+  /* Rounding errors go to the middle tap, so that the steps */
+  /* add up to exactly V and the output does not drift       */
+  for(J=S=0;J<BLEP_TAPS;++J) { I=(V*K[J])>>15;D[J]+=I;S+=I; }
+  D[BLEP_TAPS/2]+=V-S;
 }
 
-/** PlayAudio() **********************************************/
-/** Normalize and play given number of samples from the mix **/
-/** buffer. Returns the number of samples actually played.  **/
+/** Step() ***************************************************/
+/** Change channel level from A to B at time T, panned P.   **/
 /*************************************************************/
-static unsigned int PlayAudio(int *Wave,unsigned int Samples)
+static void Step(unsigned int T,int A,int B,int P)
 {
-  int16_t Buf[256];
-  unsigned int I,K;
-  int D;
-  /* Check if the buffer contains enough free space */
-  unsigned int J = AUDIO_BUFFER_SIZE;
-  if(J<Samples) Samples=J;
+  if(!P) Spread(Delta[0],T,B-A);
+  else
+  {
+    Spread(Delta[0],T,MID(B,P)-MID(A,P));
+    Spread(Delta[1],T,SIDE(B,P)-SIDE(A,P));
+  }
+}
 
-  /* Spin until all samples played or WriteAudio() fails */
-  for(K=I=J=0;(K<Samples)&&(I==J);K+=I)
+/** RenderAudio() ********************************************/
+/** Render given number of melodic sound samples (up to     **/
+/** BLEP_MAX) into integer mid and side buffers for mixing. **/
+/** Returns 1 if anything was added to the side buffer.     **/
+/*************************************************************/
+static int RenderAudio(int *M,int *S,unsigned int Samples)
+{
+  unsigned int J,I,K,P,N,E;
+  int L,V,A,B,Pan,Panned;
+
+  /* Send level changes of all channels to Delta[] */
+  for(J=Panned=0;J<SND_CHANNELS;J++)
   {
-    /* Compute number of samples to convert */
-    J = sizeof(Buf)/sizeof(int16_t);
-    J = Samples-K>J? J:Samples-K;
+    V   = WaveCH[J].Freq&&(MasterSwitch&(1<<J))? WaveCH[J].Volume:0;
+    A   = WaveCH[J].Amp;
+    Pan = WaveCH[J].Pan;
 
-    /* Convert samples */
-    for(I=0;I<J;++I)
+    /* Move to the new panning, if it has changed */
+    Spread(Delta[0],0,MID(A,Pan)-WaveCH[J].MAmp);
+    Spread(Delta[1],0,SIDE(A,Pan)-WaveCH[J].SAmp);
+
+    switch(WaveCH[J].Type)
     {
-      D      = ((*Wave++)*MasterVolume)>>8;
-      D      = D>32767? 32767:D<-32768? -32768:D;
-      Buf[I] = D;
+      case SND_WAVE: /* Custom Waveform */
+        /* Waveform data must have correct length! */
+        if(!V||(WaveCH[J].Length<=0)) { B=0;break; }
+        /* Sample steps, 0x8000 per output sample */
+        K  = WaveCH[J].Rate>0?
+             (SndRate<<15)/WaveCH[J].Freq/WaveCH[J].Rate
+           : (SndRate<<15)/WaveCH[J].Freq/WaveCH[J].Length;
+        /* Do not allow high frequencies (GBC Frogger) */
+        if(K<0x8000) { B=0;break; }
+        L = WaveCH[J].Pos%WaveCH[J].Length;
+        B = WaveCH[J].Data[L]*V;
+        Step(0,A,B,Pan);
+        A = B;
+        /* Step through waveform, changing level when needed */
+        P = WaveCH[J].Count;
+        E = P+(Samples<<15);
+        for(N=K;N<E;N+=K,A=B)
+        {
+          L = (L+1)%WaveCH[J].Length;
+          B = WaveCH[J].Data[L]*V;
+          Step(N>P? (N-P)>>10:0,A,B,Pan);
+        }
+        WaveCH[J].Pos   = L;
+        WaveCH[J].Count = E+K-N;
+        break;
+
+      case SND_NOISE: /* White Noise */
+        if(!V) { B=0;break; }
+        /* For high frequencies, recompute volume */
+        if(WaveCH[J].Freq<SndRate)
+          K=((unsigned int)WaveCH[J].Freq<<16)/SndRate;
+        else
+        {
+          V = V*SndRate/WaveCH[J].Freq;
+          K = 0x10000;
+        }
+        /* Use NoiseOut bit for output */
+        B = ((NoiseGen>>NoiseOut)&1? 127:-128)*V;
+        Step(0,A,B,Pan);
+        A = B;
+        /* Shift generator each time phase counter wraps */
+        P = WaveCH[J].Count;
+        E = P+K*Samples;
+        for(N=(P|0xFFFF)+1;N<=E;N+=0x10000,A=B)
+        {
+          /* XOR NoiseOut and NoiseXOR bits and feed them back */
+          NoiseGen=
+            (((NoiseGen>>NoiseOut)^(NoiseGen>>NoiseXor))&1)
+          | ((NoiseGen<<1)&((2<<NoiseOut)-1));
+          B = ((NoiseGen>>NoiseOut)&1? 127:-128)*V;
+          Step(((N-P)<<5)/K,A,B,Pan);
+        }
+        WaveCH[J].Count=E&0xFFFF;
+        break;
+
+      case SND_MELODIC:  /* Melodic Sound   */
+      case SND_TRIANGLE: /* Triangular Wave */
+      default:           /* Default Sound   */
+        /* Do not allow frequencies that are too high */
+        if(!V||(WaveCH[J].Freq>=SndRate/2)) { B=0;break; }
+        K = 0x10000*WaveCH[J].Freq/SndRate;
+        P = WaveCH[J].Count;
+        B = (P&0x8000? 127:-128)*V;
+        Step(0,A,B,Pan);
+        A = B;
+        /* Flip level at each half of the period */
+        E = P+K*Samples;
+        for(N=(P|0x7FFF)+1;N<E;N+=0x8000,A=B)
+        {
+          B = (N&0x8000? 127:-128)*V;
+          Step(((N-P)<<5)/K,A,B,Pan);
+        }
+        WaveCH[J].Count=E&0xFFFF;
+        break;
     }
 
-    /* Play samples */
-    I = WriteAudio(Buf,J);
+    /* Silenced channels go to zero level */
+    Step(0,A,B,Pan);
+    WaveCH[J].Amp  = B;
+    WaveCH[J].MAmp = MID(B,Pan);
+    WaveCH[J].SAmp = SIDE(B,Pan);
+    Panned|= Pan|WaveCH[J].SAmp;
+  }
+
+  /* Integrate level changes into the output, keeping */
+  /* changes that spill into the next run             */
+  for(I=0;I<Samples;I++) M[I]+=(Level[0]+=Delta[0][I]);
+  memmove(Delta[0],Delta[0]+Samples,BLEP_TAPS*sizeof(Delta[0][0]));
+  memset(Delta[0]+BLEP_TAPS,0,Samples*sizeof(Delta[0][0]));
+
+  /* Side stays zero until some channel gets panned, and */
+  /* until the steps back to zero have been integrated   */
+  I = Panned||Sided||Level[1];
+  if(I)
+  {
+    for(K=0;K<Samples;K++) S[K]+=(Level[1]+=Delta[1][K]);
+    memmove(Delta[1],Delta[1]+Samples,BLEP_TAPS*sizeof(Delta[1][0]));
+    memset(Delta[1]+BLEP_TAPS,0,Samples*sizeof(Delta[1][0]));
+  }
+  Sided = !!Panned;
+  return(I);
+}
+
+/** PlayAudio() **********************************************/
+/** Normalize given number of samples from the mid and side **/
+/** buffers into interleaved stereo and play them with one  **/
+/** WriteAudio() call. S=0 means there is no side. Returns  **/
+/** the number of samples actually played.                  **/
+/*************************************************************/
+static unsigned int PlayAudio(const int *M,const int *S,unsigned int Samples)
+{
+  unsigned int I;
+  int L,R;
+
+  /* Check if the buffer contains enough free space */
+  Samples = Samples<AUDIO_BUFFER_SIZE? Samples:AUDIO_BUFFER_SIZE;
+
+  /* Convert samples */
+  for(I=0;I<Samples;++I)
+  {
+    L = (M[I]*MasterVolume)>>8;
+    R = L;
+    if(S) { L=((M[I]-S[I])*MasterVolume)>>8;R=((M[I]+S[I])*MasterVolume)>>8; }
+    Out[2*I]   = L>32767? 32767:L<-32768? -32768:L;
+    Out[2*I+1] = R>32767? 32767:R<-32768? -32768:R;
   }
 
-  /* Return number of samples played */
-  return(K);
+  /* Play samples */
+  return(WriteAudio(Out,Samples));
 }
 
 /** RenderAndPlayAudio() *************************************/
@@ -367,55 +475,68 @@ static unsigned int PlayAudio(int *Wave,unsigned int Samples)
 /*************************************************************/
 unsigned int RenderAndPlayAudio(unsigned int Samples)
 {
-  int Buf[256];
-  unsigned int J,I,K,idx;
-  float ResampleRate,R,frac;
+  const int16_t *Fast;
+  unsigned int J,K;
+  int Pan,V;
 
   /* Exit if wave sound not initialized */
   if(SndRate<8192) return(0);
 
-  /* silence fMSX FM-PAC if NukeYKT is active */
-  if(OPTION(MSX_NUKEYKT))
+  /* silence fMSX FM-PAC if NukeYKT or FastOPLL is active */
+  if(OPTION(MSX_NUKEYKT|MSX_FASTOPLL))
   {
     for(K=0;K<YM2413_CHANNELS;K++)
       Sound(K+OPLL.First,0,0);
     OPLL.Changed=0;
   }
 
+  /* Wait for NukeYKT samples if they are made on a thread */
+  NukeYKT_Wait2413(&OPLL_NukeYKT);
+
   J       = AUDIO_BUFFER_SIZE;
   Samples = Samples<J? Samples:J;
-  ResampleRate = (float)OPLL_NukeYKT.sample_write_index/Samples;
+  memset(Mid,0,Samples*sizeof(Mid[0]));
+  memset(Side,0,Samples*sizeof(Side[0]));
+
+  /* NukeYKT and FastOPLL are panned as fMSX FM channels */
+  Pan = WaveCH[OPLL.First].Pan;
+
+  /*
+   * Merge in YM2413 NukeYKT, resampling the whole frame from 49.7kHz at once.
+   * Max input range slightly outside [-1024,+1023], output [-32768,+32767] or 16b signed after amplification by 32.
+   * BUT matching it to PSG volume (by hand) requires a further amplification by 4.
+   * That's still a factor 4-8 less loud than fMSX's FM-PAC volume.
+   */
+  if(!OPTION(MSX_NUKEYKT))
+    ResetResampler(&OPLLRsmp);
+  else if(!Pan)
+    Resample(&OPLLRsmp,Mid,Samples,OPLL_NukeYKT.samples+1,OPLL_NukeYKT.sample_write_index-1,128);
+  else
+  {
+    memset(FMBuf,0,Samples*sizeof(FMBuf[0]));
+    Resample(&OPLLRsmp,FMBuf,Samples,OPLL_NukeYKT.samples+1,OPLL_NukeYKT.sample_write_index-1,128);
+    for(K=0;K<Samples;K++) { Mid[K]+=MID(FMBuf[K],Pan);Side[K]+=SIDE(FMBuf[K],Pan); }
+  }
 
-  /* Render and play sound */
-  for(I=0,R=0.0;I<Samples;I+=J)
+  /* FastOPLL renders at the output rate, no resampling needed */
+  if(OPTION(MSX_FASTOPLL))
   {
-    J = Samples-I;
-    J = J<sizeof(Buf)/sizeof(Buf[0])? J:sizeof(Buf)/sizeof(Buf[0]);
-    memset(Buf,0,J*sizeof(Buf[0]));
-    RenderAudio(Buf,J);
-
-    /*
-     * Merge in YM2413 NukeYKT using simplistic linear resampler.
-     * Max input range slightly outside [-1024,+1023], output [-32768,+32767] or 16b signed after amplification by 32.
-     * BUT matching it to PSG volume (by hand) requires a further amplification by 4.
-     * That's still a factor 4-8 less loud than fMSX's FM-PAC volume.
-     */
-    if(OPTION(MSX_NUKEYKT))
-      for(K=0;K<J;K++,R+=ResampleRate)
-      {
-        idx=(unsigned int)R;
-        frac=R-idx;
-        Buf[K]+=(int)(.5+128.0*(OPLL_NukeYKT.samples[idx]*(1.0-frac) + OPLL_NukeYKT.samples[idx+1]*frac));
-      }
-
-    if(PlayAudio(Buf,J)<J) { I+=J;break; }
+    Fast = FlushOPLL(&OPLL_Fast,Samples);
+    if(!Pan)
+      for(K=0;K<Samples;K++) Mid[K]+=128*Fast[K];
+    else
+      for(K=0;K<Samples;K++) { V=128*Fast[K];Mid[K]+=MID(V,Pan);Side[K]+=SIDE(V,Pan); }
   }
 
-  // move last sample to beginning (for linear resampler) and signal a buffer refill
+  /* Add PSG, SCC and fMSX FM channels and play the frame */
+  K = RenderAudio(Mid,Side,Samples);
+  J = PlayAudio(Mid,K||Pan? Side:0,Samples);
+
+  // move last sample to beginning (for the idle check in WrapNukeYKT.c) and signal a buffer refill
   if (OPLL_NukeYKT.sample_write_index>0)
     OPLL_NukeYKT.samples[0]=OPLL_NukeYKT.samples[OPLL_NukeYKT.sample_write_index-1];
   OPLL_NukeYKT.sample_write_index=1;
 
   /* Return number of samples rendered */
-  return I;
+  return J;
 }
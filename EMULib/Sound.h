@@ -62,6 +62,12 @@ void SetSound(int Channel,int NewType);
 /*************************************************************/
 void SetChannels(int Volume,int Switch);
 
+/** SetPanning() *********************************************/
+/** Set stereo panning of a given channel, from -256 (left) **/
+/** to 256 (right). Zero centers the channel.               **/
+/*************************************************************/
+void SetPanning(int Channel,int Pan);
+
 /** SetNoise() ***********************************************/
 /** Initialize random noise generator to the given Seed and **/
 /** then take random output from OUTBit and XOR it with     **/
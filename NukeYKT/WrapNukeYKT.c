@@ -14,13 +14,155 @@
 
 #include <stdint.h>
 #include <string.h>
+#ifdef WORKER_THREADS
+#include <pthread.h>
+#endif
+
+uint64_t NukeYKT_IdleSamples;
+
+/*
+ * OPLL_DoRegWrite() updates channel registers at the cycle matching the address. Writes are issued
+ * at cycle 0, so when the address selects channel 0, the register only changes a sample later.
+ */
+static int NukeYKT_WritePending(const opll_t *chip)
+{
+  if (!chip->write_fm_data || (chip->address&0x0f))
+    return 0;
+  switch (chip->address&0xf0) {
+    case 0x10: return (chip->fnum[0]&0xff)!=chip->data;
+    case 0x20: return (chip->fnum[0]>>8)!=(chip->data&1) || chip->block[0]!=((chip->data>>1)&7)
+                   || chip->kon[0]!=((chip->data>>4)&1) || chip->son[0]!=((chip->data>>5)&1);
+    case 0x30: return chip->vol[0]!=(chip->data&0x0f) || chip->inst[0]!=(chip->data>>4);
+  }
+  return 0;
+}
+
+/*
+ * The OPLL is idle when every slot is in release at maximum attenuation, nothing is keyed on
+ * or about to be, and the last sample came out as 0. Clocking it then only produces more zeros,
+ * so skip it. Skipped samples are counted in idle_samples, and NukeYKT_CatchUp() advances the
+ * counters that keep running in a silent chip before it is clocked again.
+ */
+static int NukeYKT_Idle(YM2413_NukeYKT *opll)
+{
+  opll_t *chip=&opll->opll;
+  int i;
+
+  if (opll->port_write_index || chip->testmode || opll->samples[opll->sample_write_index-1])
+    return 0;
+  if (chip->eg_dokon || NukeYKT_WritePending(chip))
+    return 0;
+  if ((chip->rhythm&0x20) && (chip->rhythm&0x1f))
+    return 0;
+  for (i=0;i<9;i++)
+    if (chip->kon[i])
+      return 0;
+  for (i=0;i<18;i++)
+    if (chip->eg_level[i]!=0x7f || chip->eg_state[i]!=3) // 3: release
+      return 0;
+  return 1;
+}
+
+/*
+ * Phase increment of each slot with vibrato counter at vib, measured by clocking a copy of the
+ * chip for one sample. Slot 17 is added at cycle 0 of the next sample, so its increment is the
+ * pg_inc left pending. Clearing lfo_counter keeps vibrato from stepping meanwhile.
+ */
+static void NukeYKT_PhaseInc(const opll_t *chip, uint8_t vib, uint32_t *inc)
+{
+  opll_t copy=*chip;
+  int32_t buf[2];
+  int i;
+
+  copy.lfo_counter=0;
+  copy.lfo_vib_counter=vib;
+  for (i=0;i<CYCLE_COUNT;i++)
+    OPLL_Clock(&copy, buf);
+  for (i=0;i<17;i++)
+    inc[i]=copy.pg_phase[i]-chip->pg_phase[i];
+  inc[17]=copy.pg_inc;
+}
+
+/*
+ * Advance a silent chip by idle_samples, as if it had been clocked all along. Registers do not
+ * change while idle, so only these counters move: slot phases, EG timer, LFO and noise LFSR.
+ * They are stepped a sample at a time, following OPLL_EnvelopeGenerate(), OPLL_DoLFO() and
+ * OPLL_DoRhythm(). The first sample and the last CATCHUP_CLOCKED ones are clocked for real:
+ * the first applies latches a register write may have left behind, the last ones refresh what
+ * is derived from the counters, like EG timer locks, operator pipeline, rhythm phase bits.
+ * Run make -C test check after updating opll.c: nukeidle compares this with plain clocking.
+ */
+#define CATCHUP_CLOCKED 4
+
+static void NukeYKT_CatchUp(YM2413_NukeYKT *opll)
+{
+  opll_t *chip=&opll->opll;
+  uint32_t inc[8][18];
+  uint32_t n=opll->idle_samples;
+  uint8_t known=0,vib;
+  int32_t buf[2];
+  int i;
+
+  opll->idle_samples=0;
+
+  // Let register writes still in the pipeline settle first
+  for (i=0;i<CYCLE_COUNT;i++)
+    OPLL_Clock(chip, buf);
+  n--;
+
+  for (;n>CATCHUP_CLOCKED;n--) {
+    // Phases; slot 17 lags a cycle behind, in pg_phase_next+pg_inc
+    vib=chip->lfo_vib_counter;
+    if (!(known&(1<<vib))) {
+      NukeYKT_PhaseInc(chip, vib, inc[vib]);
+      known|=1<<vib;
+    }
+    for (i=0;i<17;i++)
+      chip->pg_phase[i]+=inc[vib][i];
+    chip->pg_phase_next+=chip->pg_inc;
+    chip->pg_phase[17]=chip->pg_phase_next;
+    chip->pg_inc=inc[vib][17];
+
+    // EG timer counts up in every 4th sample
+    if ((chip->eg_counter_state&3)==3)
+      chip->eg_timer=(chip->eg_timer+1)&0x3ffff;
+    chip->eg_counter_state++;
+
+    // AM counter steps up or down at cycles 0-8, then the LFO counter at cycle 17
+    if (chip->lfo_am_dir && (chip->lfo_am_counter&0x7f)==0)
+      chip->lfo_am_dir=0;
+    else if (!chip->lfo_am_dir && (chip->lfo_am_counter&0x69)==0x69)
+      chip->lfo_am_dir=1;
+    if (chip->lfo_am_step)
+      chip->lfo_am_counter=(chip->lfo_am_counter+(chip->lfo_am_dir?0x1ff:1))&0x1ff;
+    chip->lfo_am_step=((chip->lfo_counter&0x3f)+1)>>6;
+    chip->lfo_vib_counter=(chip->lfo_vib_counter+(((chip->lfo_counter&0x3ff)+1)>>10))&7;
+    chip->lfo_counter++;
+
+    // Noise LFSR steps every cycle; 9 steps at once shift in 9 bits of N^(N>>14)
+    if (chip->rm_noise) {
+      chip->rm_noise=(chip->rm_noise>>9)|(((chip->rm_noise^(chip->rm_noise>>14))&0x1ff)<<14);
+      chip->rm_noise=(chip->rm_noise>>9)|(((chip->rm_noise^(chip->rm_noise>>14))&0x1ff)<<14);
+    }
+    else
+      for (i=0;i<CYCLE_COUNT;i++)
+        chip->rm_noise=((((chip->rm_noise^(chip->rm_noise>>14))&1)|(chip->rm_noise==0))<<22)|(chip->rm_noise>>1);
+  }
+
+  // Output is all zeros and samples[] are cleared already
+  for (;n;n--)
+    for (i=0;i<CYCLE_COUNT;i++)
+      OPLL_Clock(chip, buf);
+}
 
 void NukeYKT_Reset2413(YM2413_NukeYKT *opll)
 {
+  NukeYKT_Wait2413(opll);
   OPLL_Reset(&opll->opll, opll_type_ym2413b);
   opll->port_write_index=0;
   opll->samples[0]=0;
   opll->sample_write_index=1;
+  opll->idle_samples=0;
 }
 
 void NukeYKT_generate_one_channel(YM2413_NukeYKT *opll, int16_t *out)
@@ -61,6 +203,18 @@ void NukeYKT_GenerateChannels(YM2413_NukeYKT *opll, uint32_t n)
 {
   int i,l;
 
+  // Samples are already zeroed by NukeYKT_Sync2413(), so an idle chip only needs to move the index
+  if (NukeYKT_Idle(opll)) {
+    NukeYKT_IdleSamples+=n;
+    opll->idle_samples+=n;
+    opll->sample_write_index+=n;
+    if (opll->sample_write_index > NUM_SAMPLES_PER_FRAME)
+      opll->sample_write_index=NUM_SAMPLES_PER_FRAME;
+    return;
+  }
+  if (opll->idle_samples)
+    NukeYKT_CatchUp(opll);
+
   for (l=0;l<n;l++) {
     if (l<opll->port_write_index)
       OPLL_Write(&opll->opll, opll->writes[l].port, opll->writes[l].value);
@@ -77,7 +231,7 @@ void NukeYKT_GenerateChannels(YM2413_NukeYKT *opll, uint32_t n)
   opll->port_write_index=opll->port_write_index<=l?0:opll->port_write_index-l;
 }
 
-void NukeYKT_Sync2413(YM2413_NukeYKT *opll, uint32_t ticks)
+static void NukeYKT_DoSync(YM2413_NukeYKT *opll, uint32_t ticks)
 {
   uint32_t num_samples_to_request;
 
@@ -91,7 +245,7 @@ void NukeYKT_Sync2413(YM2413_NukeYKT *opll, uint32_t ticks)
   NukeYKT_GenerateChannels(opll, num_samples_to_request);
 }
 
-void NukeYKT_WritePort2413(YM2413_NukeYKT *opll, bool port, byte value)
+static void NukeYKT_DoWrite(YM2413_NukeYKT *opll, bool port, byte value)
 {
   opll->writes[opll->port_write_index].port=port;
   opll->writes[opll->port_write_index].value=value;
@@ -100,3 +254,157 @@ void NukeYKT_WritePort2413(YM2413_NukeYKT *opll, bool port, byte value)
     // wrap around - should only happen when fMSX YM2413 emulation is on. There are 32 slots, and rarely more than 2 are used in practice (with NukeYKT enabled).
     opll->port_write_index=0;
 }
+
+#ifdef WORKER_THREADS
+/*
+ * Threaded synthesis: port writes and syncs are queued as events, in the order the Z80 issued them,
+ * so the position of a write among the syncs is its timestamp. The worker replays the events with
+ * NukeYKT_DoWrite()/NukeYKT_DoSync() on the same YM2413_NukeYKT, which gives exactly the samples[]
+ * the synchronous path would. Anyone else touching the struct must call NukeYKT_Wait2413() first.
+ */
+#define EVENT_WRITE 0x80000000 // else: sync, with ticks in the low bits
+#define EVENT_PORT  0x100
+#define QUEUE_SIZE  1024       // power of 2
+#define BATCH_SIZE  64         // events gathered before taking the lock
+
+static pthread_t thread_id;
+static pthread_mutex_t queue_lock;
+static pthread_cond_t queue_wake;  // signaled when the queue stops being empty
+static pthread_cond_t queue_idle;  // signaled when the queue empties
+static pthread_cond_t queue_room;  // signaled when the worker frees entries
+static uint32_t queue[QUEUE_SIZE];
+static unsigned int queue_head,queue_tail;
+static uint32_t batch[BATCH_SIZE];
+static unsigned int batch_count;
+static YM2413_NukeYKT *thread_opll; // chip the worker runs, NULL if none
+static bool thread_quit;
+
+static void *NukeYKT_ThreadLoop(void *arg)
+{
+  unsigned int head,tail;
+  uint32_t e;
+
+  pthread_mutex_lock(&queue_lock);
+  for (;;) {
+    while (queue_tail==queue_head && !thread_quit)
+      pthread_cond_wait(&queue_wake, &queue_lock);
+    if (queue_tail==queue_head)
+      break;
+
+    // entries between tail and head are ours until queue_tail moves
+    head=queue_head;
+    pthread_mutex_unlock(&queue_lock);
+    for (tail=queue_tail;tail!=head;tail++) {
+      e=queue[tail&(QUEUE_SIZE-1)];
+      if (e&EVENT_WRITE)
+        NukeYKT_DoWrite(thread_opll, (e&EVENT_PORT)!=0, e&0xff);
+      else
+        NukeYKT_DoSync(thread_opll, e);
+    }
+    pthread_mutex_lock(&queue_lock);
+
+    queue_tail=head;
+    pthread_cond_signal(&queue_room);
+    if (queue_tail==queue_head)
+      pthread_cond_signal(&queue_idle);
+  }
+  pthread_mutex_unlock(&queue_lock);
+  return NULL;
+}
+
+static void NukeYKT_Flush(void)
+{
+  unsigned int i;
+
+  pthread_mutex_lock(&queue_lock);
+  while (queue_head-queue_tail>QUEUE_SIZE-batch_count)
+    pthread_cond_wait(&queue_room, &queue_lock);
+  if (queue_head==queue_tail)
+    pthread_cond_signal(&queue_wake);
+  for (i=0;i<batch_count;i++)
+    queue[queue_head++&(QUEUE_SIZE-1)]=batch[i];
+  pthread_mutex_unlock(&queue_lock);
+  batch_count=0;
+}
+
+static void NukeYKT_Queue(uint32_t e)
+{
+  batch[batch_count++]=e;
+  if (batch_count==BATCH_SIZE)
+    NukeYKT_Flush();
+}
+
+void NukeYKT_Wait2413(YM2413_NukeYKT *opll)
+{
+  if (thread_opll!=opll)
+    return;
+  if (batch_count)
+    NukeYKT_Flush();
+  pthread_mutex_lock(&queue_lock);
+  while (queue_tail!=queue_head)
+    pthread_cond_wait(&queue_idle, &queue_lock);
+  pthread_mutex_unlock(&queue_lock);
+}
+
+int NukeYKT_SetThread2413(YM2413_NukeYKT *opll, int on)
+{
+  if (!on==!thread_opll)
+    return thread_opll!=NULL;
+
+  if (!on) {
+    if (batch_count)
+      NukeYKT_Flush();
+    pthread_mutex_lock(&queue_lock);
+    thread_quit=true;
+    pthread_cond_signal(&queue_wake);
+    pthread_mutex_unlock(&queue_lock);
+    // the worker drains the queue before it quits
+    pthread_join(thread_id, NULL);
+    pthread_cond_destroy(&queue_room);
+    pthread_cond_destroy(&queue_idle);
+    pthread_cond_destroy(&queue_wake);
+    pthread_mutex_destroy(&queue_lock);
+    thread_opll=NULL;
+    return 0;
+  }
+
+  queue_head=queue_tail=batch_count=0;
+  thread_quit=false;
+  thread_opll=opll;
+  pthread_mutex_init(&queue_lock, NULL);
+  pthread_cond_init(&queue_wake, NULL);
+  pthread_cond_init(&queue_idle, NULL);
+  pthread_cond_init(&queue_room, NULL);
+  if (pthread_create(&thread_id, NULL, NukeYKT_ThreadLoop, NULL)) {
+    pthread_cond_destroy(&queue_room);
+    pthread_cond_destroy(&queue_idle);
+    pthread_cond_destroy(&queue_wake);
+    pthread_mutex_destroy(&queue_lock);
+    thread_opll=NULL;
+    return 0;
+  }
+  return 1;
+}
+#endif
+
+void NukeYKT_Sync2413(YM2413_NukeYKT *opll, uint32_t ticks)
+{
+#ifdef WORKER_THREADS
+  if (thread_opll==opll) {
+    NukeYKT_Queue(ticks);
+    return;
+  }
+#endif
+  NukeYKT_DoSync(opll, ticks);
+}
+
+void NukeYKT_WritePort2413(YM2413_NukeYKT *opll, bool port, byte value)
+{
+#ifdef WORKER_THREADS
+  if (thread_opll==opll) {
+    NukeYKT_Queue(EVENT_WRITE|(port?EVENT_PORT:0)|value);
+    return;
+  }
+#endif
+  NukeYKT_DoWrite(opll, port, value);
+}
@@ -40,6 +40,7 @@ typedef unsigned char byte;
 
 #define CYCLE_COUNT 18
 #define Z80_CYCLES_PER_SAMPLE (4*CYCLE_COUNT)
+#define NUKEYKT_RATE (3579545/Z80_CYCLES_PER_SAMPLE) // 49716Hz, resampled in Sound.c
 #define NUM_SAMPLES_PER_FRAME (1 + (CPU_V313 / Z80_CYCLES_PER_SAMPLE)) // 992 at 50Hz; 60Hz uses ~830 samples per frame
 
 typedef struct
@@ -51,15 +52,32 @@ typedef struct
 typedef struct
 {
   opll_t opll;
-  int16_t samples[NUM_SAMPLES_PER_FRAME+2]; // 1 'frame' of 20ms (50Hz) at 49,7kHz. +2 for resampler; first and last index.
+  int16_t samples[NUM_SAMPLES_PER_FRAME+2]; // 1 'frame' of 20ms (50Hz) at 49,7kHz. samples[0] is the last sample of the previous frame.
   unsigned int sample_write_index;
   uint32_t ticksPending;
   Write writes[MAX_WRITES];
   unsigned int port_write_index;
+  uint32_t idle_samples; // skipped while idle, counters not advanced yet
 } YM2413_NukeYKT;
 
+extern uint64_t NukeYKT_IdleSamples; // samples skipped while the OPLL was silent
+
 void NukeYKT_Reset2413(YM2413_NukeYKT *opll);
 void NukeYKT_WritePort2413(YM2413_NukeYKT *opll, bool port, byte value);
 void NukeYKT_Sync2413(YM2413_NukeYKT *opll, uint32_t ticks);
 
+/*
+ * With WORKER_THREADS, NukeYKT_SetThread2413(opll,1) moves synthesis to a worker thread: writes and
+ * syncs are queued in order and replayed there, so samples[] come out the same as when synced inline.
+ * Call NukeYKT_Wait2413() before reading or changing the struct outside of the functions above,
+ * i.e. before mixing samples[] or saving/loading state. SetThread2413() returns 1 if the thread runs.
+ */
+#ifdef WORKER_THREADS
+int NukeYKT_SetThread2413(YM2413_NukeYKT *opll, int on);
+void NukeYKT_Wait2413(YM2413_NukeYKT *opll);
+#else
+static inline int NukeYKT_SetThread2413(YM2413_NukeYKT *opll, int on) { (void)opll; (void)on; return 0; }
+static inline void NukeYKT_Wait2413(YM2413_NukeYKT *opll) { (void)opll; }
+#endif
+
 #endif
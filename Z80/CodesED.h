@@ -138,9 +138,15 @@ case INI:
   break;
 
 case INIR:
-  WrZ80(R->HL.W++,InZ80(R->BC.W));
-  if(--R->BC.B.h) { R->AF.B.l=N_FLAG;R->ICount-=21;R->PC.W-=2; }
-  else            { R->AF.B.l=Z_FLAG|N_FLAG;R->ICount-=16; }
+  for(;;)
+  {
+    WrZ80(R->HL.W++,InZ80(R->BC.W));
+    if(!--R->BC.B.h) break;
+    R->ICount-=21;
+    if(!M_AGAIN(INIR)) break;
+  }
+  if(R->BC.B.h) { R->AF.B.l=N_FLAG;R->PC.W-=2; }
+  else          { R->AF.B.l=Z_FLAG|N_FLAG;R->ICount-=16; }
   break;
 
 case IND:
@@ -150,9 +156,15 @@ case IND:
   break;
 
 case INDR:
-  WrZ80(R->HL.W--,InZ80(R->BC.W));
-  if(!--R->BC.B.h) { R->AF.B.l=N_FLAG;R->ICount-=21;R->PC.W-=2; }
-  else             { R->AF.B.l=Z_FLAG|N_FLAG;R->ICount-=16; }
+  for(;;)
+  {
+    WrZ80(R->HL.W--,InZ80(R->BC.W));
+    if(!--R->BC.B.h) break;
+    R->ICount-=21;
+    if(!M_AGAIN(INDR)) break;
+  }
+  if(R->BC.B.h) { R->AF.B.l=N_FLAG;R->PC.W-=2; }
+  else          { R->AF.B.l=Z_FLAG|N_FLAG;R->ICount-=16; }
   break;
 
 case OUTI:
@@ -163,13 +175,19 @@ case OUTI:
   break;
 
 case OTIR:
-  --R->BC.B.h;
-  I=RdZ80(R->HL.W++);
-  OutZ80(R->BC.W,I);
+  for(;;)
+  {
+    if(OutRun(R)) continue;
+    --R->BC.B.h;
+    I=RdZ80(R->HL.W++);
+    OutZ80(R->BC.W,I);
+    if(!R->BC.B.h) break;
+    R->ICount-=21;
+    if(!M_AGAIN(OTIR)) break;
+  }
   if(R->BC.B.h)
   {
     R->AF.B.l=N_FLAG|(R->HL.B.l+I>255? (C_FLAG|H_FLAG):0);
-    R->ICount-=21;
     R->PC.W-=2;
   }
   else
@@ -187,13 +205,18 @@ case OUTD:
   break;
 
 case OTDR:
-  --R->BC.B.h;
-  I=RdZ80(R->HL.W--);
-  OutZ80(R->BC.W,I);
+  for(;;)
+  {
+    --R->BC.B.h;
+    I=RdZ80(R->HL.W--);
+    OutZ80(R->BC.W,I);
+    if(!R->BC.B.h) break;
+    R->ICount-=21;
+    if(!M_AGAIN(OTDR)) break;
+  }
   if(R->BC.B.h)
   {
     R->AF.B.l=N_FLAG|(R->HL.B.l+I>255? (C_FLAG|H_FLAG):0);
-    R->ICount-=21;
     R->PC.W-=2;
   }
   else
@@ -210,11 +233,17 @@ case LDI:
   break;
 
 case LDIR:
-  WrZ80(R->DE.W++,RdZ80(R->HL.W++));
-  if(--R->BC.W)
+  for(;;)
   {
-    R->AF.B.l=(R->AF.B.l&~(H_FLAG|P_FLAG))|N_FLAG;
+    if(CopyRun(R,1)) continue;
+    WrZ80(R->DE.W++,RdZ80(R->HL.W++));
+    if(!--R->BC.W) break;
     R->ICount-=21;
+    if(!M_AGAIN(LDIR)) break;
+  }
+  if(R->BC.W)
+  {
+    R->AF.B.l=(R->AF.B.l&~(H_FLAG|P_FLAG))|N_FLAG;
     R->PC.W-=2;
   }
   else
@@ -231,12 +260,18 @@ case LDD:
   break;
 
 case LDDR:
-  WrZ80(R->DE.W--,RdZ80(R->HL.W--));
+  for(;;)
+  {
+    if(CopyRun(R,-1)) continue;
+    WrZ80(R->DE.W--,RdZ80(R->HL.W--));
+    if(!--R->BC.W) break;
+    R->ICount-=21;
+    if(!M_AGAIN(LDDR)) break;
+  }
   R->AF.B.l&=~(N_FLAG|H_FLAG|P_FLAG);
-  if(--R->BC.W)
+  if(R->BC.W)
   {
     R->AF.B.l=(R->AF.B.l&~(H_FLAG|P_FLAG))|N_FLAG;
-    R->ICount-=21;
     R->PC.W-=2;
   }
   else
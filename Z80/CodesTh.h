@@ -0,0 +1,154 @@
+/** Z80: portable Z80 emulator *******************************/
+/**                                                         **/
+/**                         CodesTh.h                       **/
+/**                                                         **/
+/** This file generates opcode handlers for the threaded    **/
+/** interpreter. It is included from Z80.c and includes     **/
+/** itself for each TH_HI and TH_LO value. Every handler    **/
+/** switch()es on a constant opcode, so the compiler only   **/
+/** keeps one case of Codes.h in it. When TH_BLOCK is       **/
+/** #defined, handlers for translated blocks are generated  **/
+/** instead.                                                **/
+/**                                                         **/
+/** Copyright (C) Marat Fayzullin 1994-2021                 **/
+/**     You are not allowed to distribute this software     **/
+/**     commercially. Please, notify me, if you make any    **/
+/**     changes to this file.                               **/
+/*************************************************************/
+
+#if !defined(TH_HI)
+
+#define TH_HI 0
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI 1
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI 2
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI 3
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI 4
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI 5
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI 6
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI 7
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI 8
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI 9
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI A
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI B
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI C
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI D
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI E
+#include "CodesTh.h"
+#undef TH_HI
+#define TH_HI F
+#include "CodesTh.h"
+#undef TH_HI
+
+#elif !defined(TH_LO)
+
+#define TH_LO 0
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO 1
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO 2
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO 3
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO 4
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO 5
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO 6
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO 7
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO 8
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO 9
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO A
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO B
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO C
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO D
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO E
+#include "CodesTh.h"
+#undef TH_LO
+#define TH_LO F
+#include "CodesTh.h"
+#undef TH_LO
+
+#elif !defined(TH_BLOCK)
+
+TH_LABEL(TH_HI,TH_LO):
+  R->ICount-=Cycles[TH_OP(TH_HI,TH_LO)];
+  INCR(1);
+  switch(TH_OP(TH_HI,TH_LO))
+  {
+#include "Codes.h"
+    case PFX_CB: CodesCB(R);break;
+    case PFX_ED: CodesED(R);break;
+    case PFX_FD: CodesFD(R);break;
+    case PFX_DD: CodesDD(R);break;
+  }
+  if(R->ICount<=0) goto Expired;
+  TH_DISPATCH;
+
+#else /* TH_BLOCK */
+
+/* Cycles and R were counted on block entry. Only opcodes */
+/* that may appear inside blocks get any code here.       */
+TB_LABEL(TH_HI,TH_LO):
+  if(BlkInfo[TH_OP(TH_HI,TH_LO)])
+  {
+    R->PC.W++;
+    switch(TH_OP(TH_HI,TH_LO))
+    {
+#include "Codes.h"
+    }
+    if((BlkInfo[TH_OP(TH_HI,TH_LO)]&BLK_WRITE)&&(BlkStop||(RAM[BP]!=BBase)))
+      goto BlkAbort;
+  }
+  goto *(*++BOp);
+
+#endif /* TH_BLOCK */
@@ -233,6 +233,7 @@ case HALT:
   R->PC.W--;
   R->IFF|=IFF_HALT;
   R->IBackup=0;
+  M_HALT(R->ICount);
   R->ICount=0;
   break;
 
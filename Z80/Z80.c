@@ -18,6 +18,9 @@
 #include "Z80.h"
 #include "Tables.h"
 
+#include <string.h>
+#include <stddef.h>
+
 /** INLINE ***************************************************/
 /** C99 standard has "inline", but older compilers used     **/
 /** __inline for the same purpose.                          **/
@@ -37,6 +40,57 @@ INLINE uint8_t OpZ80(uint16_t A) { return(RAM[A>>13][A&0x1FFF]); }
 
 #define OpZ80(A) RdZ80(A)
 
+/** Idle Loop Skipping ***************************************/
+/** IdleLoop() is called on each backward jump taken. It    **/
+/** keeps registers from the last such jump and skips loop  **/
+/** iterations when they repeat. Any port output, accepted  **/
+/** interrupt or BusyZ80() call in between marks the loop   **/
+/** as busy, so it is never skipped. So does LoopZ80() if   **/
+/** the loop reads ports, as their values may change there. **/
+/** RAM changes are logged and must be undone by the time   **/
+/** the loop jumps back, as with stack pushes.              **/
+/*************************************************************/
+#ifdef Z80_IDLE
+#define IDLE_LOG  16              /* Max RAM changes per loop     */
+#define IDLE_KEEP 2048            /* Max cycles per outer loop    */
+
+uint64_t IdleCycles = 0;          /* Total CPU cycles skipped     */
+static Z80 IdleRegs;              /* Registers at the last jump   */
+static unsigned int IdleEpoch;    /* Cycles run when ICount=0     */
+static unsigned int IdleTime;     /* Cycles run at the last jump  */
+static uint8_t IdleBusy = 1;      /* 1: Side effects since then   */
+static uint8_t IdleIn   = 0;      /* 1: Ports read since then     */
+static uint16_t IdleAddr[IDLE_LOG]; /* RAM changed since then     */
+static uint8_t IdleOld[IDLE_LOG];   /* Previous RAM values        */
+static int IdleLogged;              /* Number of logged changes   */
+
+static void IdleLoop(Z80 *R,uint8_t Offset);
+
+static uint16_t IdleLoopZ80(Z80 *R)
+{
+  uint16_t J = LoopZ80(R);
+  IdleEpoch += R->IPeriod;
+  IdleBusy  |= IdleIn;
+  return(J);
+}
+
+#define InZ80(P)      (IdleIn=1,InZ80(P))
+#define OutZ80(P,V)   (IdleBusy=1,OutZ80(P,V))
+#define OutsZ80(P,D,N) (IdleBusy=1,OutsZ80(P,D,N))
+#define LoopZ80(R)    IdleLoopZ80(R)
+#ifdef PATCH_Z80
+#define PatchZ80(R)   (IdleBusy=1,PatchZ80(R))
+#endif
+
+#define M_IDLE(Back,Offset) if(Back) IdleLoop(R,Offset)
+#define M_HALT(N)           IdleCycles+=(N)>0? (N):0
+#define M_BUSY              IdleBusy=1
+#else
+#define M_IDLE(Back,Offset)
+#define M_HALT(N)
+#define M_BUSY
+#endif
+
 #define S(Fl)        R->AF.B.l|=Fl
 #define R(Fl)        R->AF.B.l&=~(Fl)
 #define FLAGS(Rg,Fl) R->AF.B.l=Fl|ZSTable[Rg]
@@ -96,10 +150,24 @@ INLINE uint8_t OpZ80(uint16_t A) { return(RAM[A>>13][A&0x1FFF]); }
   R->PC.W=J.W; \
   JumpZ80(J.W)
 
-#define M_JP  J.B.l=OpZ80(R->PC.W++);J.B.h=OpZ80(R->PC.W);R->PC.W=J.W;JumpZ80(J.W)
-#define M_JR  R->PC.W+=(offset)OpZ80(R->PC.W)+1;JumpZ80(R->PC.W)
+#define M_JP  \
+  J.B.l=OpZ80(R->PC.W++);J.B.h=OpZ80(R->PC.W); \
+  M_IDLE(J.W<R->PC.W,0);R->PC.W=J.W;JumpZ80(J.W)
+#define M_JR  \
+  J.B.l=OpZ80(R->PC.W);M_IDLE(J.B.l&0x80,J.B.l); \
+  R->PC.W+=(offset)J.B.l+1;JumpZ80(R->PC.W)
 #define M_RET R->PC.B.l=OpZ80(R->SP.W++);R->PC.B.h=OpZ80(R->SP.W++);JumpZ80(R->PC.W)
 
+/* Repeat block instruction Op in place while LoopZ80() is */
+/* not due and the code is still there, counting R as if   */
+/* ED Op was fetched again                                 */
+#ifdef DEBUG
+#define M_AGAIN(Op) 0
+#else
+#define M_AGAIN(Op) \
+  ((R->ICount>0)&&(OpZ80(R->PC.W-2)==PFX_ED)&&(OpZ80(R->PC.W-1)==Op)&&(INCR(2),1))
+#endif
+
 #define M_RST(Ad)      \
   WrZ80(--R->SP.W,R->PC.B.h);WrZ80(--R->SP.W,R->PC.B.l);R->PC.W=Ad;JumpZ80(Ad)
 
@@ -359,6 +427,120 @@ static void CodesFDCB(Z80 *R)
 #undef XX
 }
 
+/** Block Runs ***********************************************/
+/** LDIR, LDDR, and OTIR repeating within a LoopZ80() period **/
+/** move plain RAM found by PlainZ80() in runs. A run stays  **/
+/** within 256-byte blocks and ends one iteration before the **/
+/** instruction or the period does, so the last byte and the **/
+/** flags still go the usual way. Registers, cycles, and R   **/
+/** are updated once per run, and decoded code is dropped    **/
+/** once per run if it has changed.                          **/
+/*************************************************************/
+#ifdef DEBUG
+#define CopyRun(R,Dir) 0
+#define OutRun(R)      0
+#else
+#define RUN_MIN 4                 /* Shorter runs go byte by byte */
+
+#ifdef Z80_THREADED
+static void TouchRun(uint16_t A,int N);
+#else
+#define TouchRun(A,N)
+#endif
+
+/** RunLength() **********************************************/
+/** Return the number of LDIR/LDDR/OTIR iterations, going   **/
+/** in direction Dir from HL, that can be done as a run, or **/
+/** 0 if the instruction code itself is not plain RAM.      **/
+/*************************************************************/
+static int RunLength(Z80 *R,int Dir,int Count)
+{
+  int N,J;
+
+  N = (R->ICount-1)/21;
+  N = N<Count-1? N:Count-1;
+  J = Dir>0? 256-R->HL.B.l:R->HL.B.l+1;
+  N = N<J? N:J;
+  if(N<RUN_MIN) return(0);
+  return(PlainZ80(R->PC.W-2,0)&&PlainZ80(R->PC.W-1,0)? N:0);
+}
+
+/** CopyRun() ************************************************/
+/** Do a run of LDIR (Dir=1) or LDDR (Dir=-1) iterations.   **/
+/** Returns number of bytes copied, 0 if none.              **/
+/*************************************************************/
+static int CopyRun(Z80 *R,int Dir)
+{
+  uint8_t *S,*D,*C;
+  uint16_t A;
+  int N,J,Changed;
+
+  if(!(N=RunLength(R,Dir,R->BC.W))) return(0);
+  J = Dir>0? 256-R->DE.B.l:R->DE.B.l+1;
+  N = N<J? N:J;
+  if(N<RUN_MIN) return(0);
+
+  /* Runs start at the lowest address */
+  if(!(S=PlainZ80(R->HL.W,0))||!(D=PlainZ80(R->DE.W,1))) return(0);
+  A  = Dir>0? R->DE.W:R->DE.W-N+1;
+  S += Dir>0? R->HL.B.l:R->HL.B.l-N+1;
+  D += A&0xFF;
+
+  /* Instruction code must stay intact, even if RAM is mirrored */
+  for(J=1;J<=2;++J)
+  {
+    C = PlainZ80(R->PC.W-J,0)+((R->PC.W-J)&0xFF);
+    if((C>=D)&&(C<D+N)) return(0);
+  }
+
+  if(Dir>0? (D>S)&&(D<S+N):(D<S)&&(D+N>S))
+  {
+    /* Fill patterns depend on byte order, keep it */
+    for(J=Dir>0? 0:N-1,Changed=0;(J>=0)&&(J<N);J+=Dir)
+      if(D[J]!=S[J]) { ChangeZ80(A+J,D[J]);D[J]=S[J];Changed=1; }
+  }
+  else
+  {
+#ifdef Z80_IDLE
+    for(J=Dir>0? 0:N-1,Changed=0;(J>=0)&&(J<N);J+=Dir)
+      if(D[J]!=S[J]) { ChangeZ80(A+J,D[J]);Changed=1; }
+#else
+    Changed=memcmp(D,S,N);
+#endif
+    if(Changed) memmove(D,S,N);
+  }
+
+  if(Changed) TouchRun(A,N);
+  R->HL.W   += Dir*N;
+  R->DE.W   += Dir*N;
+  R->BC.W   -= N;
+  R->ICount -= 21*N;
+  INCR(2*N);
+  return(N);
+}
+
+/** OutRun() *************************************************/
+/** Do a run of OTIR iterations through OutsZ80(). Returns  **/
+/** number of bytes written, 0 if none.                     **/
+/*************************************************************/
+static int OutRun(Z80 *R)
+{
+  const uint8_t *S;
+  int N;
+
+  if(!(N=RunLength(R,1,R->BC.B.h))) return(0);
+  if(!(S=PlainZ80(R->HL.W,0))) return(0);
+  N = OutsZ80(((R->BC.B.h-1)<<8)|R->BC.B.l,S+R->HL.B.l,N);
+  if(N<=0) return(0);
+
+  R->HL.W   += N;
+  R->BC.B.h -= N;
+  R->ICount -= 21*N;
+  INCR(2*N);
+  return(N);
+}
+#endif /* !DEBUG */
+
 static void CodesED(Z80 *R)
 {
   uint8_t I;
@@ -435,6 +617,83 @@ static void CodesFD(Z80 *R)
 #undef XX
 }
 
+#ifdef Z80_IDLE
+/** IdleLoop() ***********************************************/
+/** Skip as many iterations of a loop ending with a jump at **/
+/** R->PC as fit before the next LoopZ80() call, keeping    **/
+/** cycles and R exactly as if they were executed. Offset   **/
+/** is the relative jump offset or 0.                       **/
+/*************************************************************/
+static void IdleLoop(Z80 *R,uint8_t Offset)
+{
+  int C,K;
+
+  /* DJNZ to itself: skip all but the last taken iteration */
+  if((Offset==0xFE)&&(RdZ80(R->PC.W-1)==DJNZ))
+  {
+    C = Cycles[DJNZ]+5;
+    K = (R->ICount-1)/C;
+    if(K>R->BC.B.h-1) K=R->BC.B.h-1;
+    if(K>0)
+    {
+      R->BC.B.h  -= K;
+      R->ICount  -= K*C;
+      IdleCycles += K*C;
+      INCR(K);
+    }
+    return;
+  }
+
+  /* Inner loops do not replace a recent outer loop state */
+  C = (int)(IdleEpoch-R->ICount-IdleTime);
+  if((R->PC.W!=IdleRegs.PC.W)&&(C<IDLE_KEEP)) return;
+
+  /* Loop repeated the same state with no side effects */
+  for(K=0;!IdleBusy&&(K<IdleLogged);++K)
+    if(RdZ80(IdleAddr[K])!=IdleOld[K]) IdleBusy=1;
+  if(!IdleBusy&&(C>0)&&!memcmp(&IdleRegs,R,offsetof(Z80,R)))
+  {
+    K = (R->ICount-1)/C;
+    if(K>0)
+    {
+      R->ICount  -= K*C;
+      IdleCycles += K*C;
+      INCR(K*((R->R-IdleRegs.R)&0x7F));
+    }
+  }
+
+  /* Remember state at this jump, unless an EI is pending */
+  memcpy(&IdleRegs,R,offsetof(Z80,R)+1);
+  IdleTime   = IdleEpoch-R->ICount;
+  IdleBusy   = (R->IFF&IFF_EI)!=0;
+  IdleIn     = 0;
+  IdleLogged = 0;
+}
+
+/** BusyZ80() ************************************************/
+/** Call this function from RdZ80(), WrZ80(), and InZ80()   **/
+/** when an access changes memory or hardware state, so     **/
+/** that the current loop will not be skipped.              **/
+/*************************************************************/
+void BusyZ80(void) { IdleBusy=1; }
+
+/** ChangeZ80() **********************************************/
+/** Call this function from WrZ80() when plain RAM at A is  **/
+/** about to change from value Old.                         **/
+/*************************************************************/
+void ChangeZ80(uint16_t A,uint8_t Old)
+{
+  int J;
+
+  if(IdleBusy) return;
+  for(J=0;J<IdleLogged;++J)
+    if(IdleAddr[J]==A) return;
+  if(IdleLogged>=IDLE_LOG) { IdleBusy=1;return; }
+  IdleAddr[IdleLogged] = A;
+  IdleOld[IdleLogged++] = Old;
+}
+#endif /* Z80_IDLE */
+
 /** ResetZ80() ***********************************************/
 /** This function can be used to reset the register struct  **/
 /** before starting execution with Z80(). It sets the       **/
@@ -461,6 +720,7 @@ void ResetZ80(Z80 *R)
   R->IRequest = INT_NONE;
   R->IBackup  = 0;
 
+  FlushZ80();
   JumpZ80(R->PC.W);
 }
 
@@ -530,6 +790,9 @@ void IntZ80(Z80 *R,uint16_t Vector)
 
   if((R->IFF&IFF_1)||(Vector==INT_NMI))
   {
+    /* Interrupted loop is not idle */
+    M_BUSY;
+
     /* Save PC on stack */
     M_PUSH(PC);
 
@@ -584,6 +847,405 @@ void IntZ80(Z80 *R,uint16_t Vector)
   }
 }
 
+#ifdef Z80_THREADED
+/** Decoded Code Cache ***************************************/
+/** Each 8kB page the CPU executes from gets a table of     **/
+/** opcode handlers, one per byte. Pages are identified by  **/
+/** their RAM[] pointers, so switching slots or MegaROM     **/
+/** banks just selects another table. Tables are recycled   **/
+/** on least-recently-used basis.                           **/
+/*************************************************************/
+#define DC_PAGES  16
+
+/** Translated Blocks ****************************************/
+/** With ThreadedZ80=2, straight runs of simple opcodes are **/
+/** translated into blocks of handlers executed back to     **/
+/** back, and the first opcode handler is replaced with one **/
+/** entering the block. Cycles and R are counted once when  **/
+/** the whole block fits before the next LoopZ80() call.    **/
+/** Blocks end before any jump, I/O, prefixed, or interrupt **/
+/** related opcode. Opcodes writing memory leave the block  **/
+/** early if the write has changed the block page mapping   **/
+/** or its code.                                            **/
+/*************************************************************/
+#define BLK_MAX   32              /* Max opcodes in a block       */
+#define BLK_BYTES (BLK_MAX*3)     /* Max bytes in a block         */
+#define BLK_OPS   4096            /* Block storage per page       */
+#define BLK_WRITE 0x10            /* BlkInfo[]: writes memory     */
+#define BLK_IN    0x01            /* BFlags[]: opcode in a block  */
+#define BLK_BAN   0x02            /* BFlags[]: block was modified */
+
+int ThreadedZ80 = 1;              /* 1: Threaded, 2: +blocks      */
+
+struct DCPage
+{
+  const uint8_t *Base;            /* Decoded 8kB page or 0        */
+  unsigned int Used;              /* Last time page was mapped    */
+  unsigned int Lo,Hi;             /* Offsets in use, Lo>Hi: none  */
+  const void *Op[0x2000];         /* Opcode handlers, 0=undecoded */
+  uint16_t BlkAt[0x2000];         /* Block offset+1 or 0=none     */
+  uint8_t BFlags[0x2000];         /* BLK_IN, BLK_BAN flags        */
+  unsigned int BlkUsed;           /* Used BOp[] entries           */
+  const void *BOp[BLK_OPS];       /* 1st opcode, block, end       */
+  uint16_t BCyc[BLK_OPS];         /* Cycles left from this opcode */
+};
+
+static struct DCPage DCPage[DC_PAGES];
+
+static const uint8_t *DCBase[8];  /* RAM[] values DCMap[] is for  */
+static const void **DCMap[8];     /* Handler tables for RAM[]     */
+static struct DCPage *DCPg[8];    /* Decoded pages for RAM[]      */
+static uint8_t BlkStop;           /* 1: Running block dropped     */
+
+/** BlkInfo[] ************************************************/
+/** Length of each opcode allowed inside a block, ORed with **/
+/** BLK_WRITE if it writes memory. 0 means block ends here. **/
+/*************************************************************/
+static const uint8_t BlkInfo[256] =
+{
+  0x01,0x03,0x11,0x01,0x01,0x01,0x02,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x02,0x01,
+  0x00,0x03,0x11,0x01,0x01,0x01,0x02,0x01,0x00,0x01,0x01,0x01,0x01,0x01,0x02,0x01,
+  0x00,0x03,0x13,0x01,0x01,0x01,0x02,0x01,0x00,0x01,0x03,0x01,0x01,0x01,0x02,0x01,
+  0x00,0x03,0x13,0x01,0x11,0x11,0x12,0x01,0x00,0x01,0x03,0x01,0x01,0x01,0x02,0x01,
+  0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+  0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+  0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+  0x11,0x11,0x11,0x11,0x11,0x11,0x00,0x11,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+  0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+  0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+  0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+  0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+  0x00,0x01,0x00,0x00,0x00,0x11,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x02,0x00,
+  0x00,0x01,0x00,0x00,0x00,0x11,0x02,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x02,0x00,
+  0x00,0x01,0x00,0x11,0x00,0x11,0x02,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x02,0x00,
+  0x00,0x01,0x00,0x00,0x00,0x11,0x02,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x02,0x00
+};
+
+/** DCClear() ************************************************/
+/** Clear handlers and blocks of a decoded page. Only the   **/
+/** Lo..Hi range of offsets decoded so far needs clearing.  **/
+/*************************************************************/
+static void DCClear(struct DCPage *Pg)
+{
+  unsigned int N = Pg->Lo<=Pg->Hi? Pg->Hi-Pg->Lo+1:0;
+
+  memset(Pg->Op+Pg->Lo,0,N*sizeof(Pg->Op[0]));
+  memset(Pg->BlkAt+Pg->Lo,0,N*sizeof(Pg->BlkAt[0]));
+  memset(Pg->BFlags+Pg->Lo,0,N*sizeof(Pg->BFlags[0]));
+  Pg->Lo      = 0x2000;
+  Pg->Hi      = 0;
+  Pg->BlkUsed = 0;
+}
+
+/** DCMark() *************************************************/
+/** Add offsets A..B to the range DCClear() has to clear.   **/
+/*************************************************************/
+#define DCMark(Pg,A,B) \
+  if((Pg)->Lo>(A)) (Pg)->Lo=(A); \
+  if((Pg)->Hi<(B)) (Pg)->Hi=(B)
+
+/** DCLookup() ***********************************************/
+/** Find handler table for the current RAM[P] page. If none **/
+/** exists and Alloc=1, recycle the least recently used one.**/
+/*************************************************************/
+static void DCLookup(uint8_t P,uint8_t Alloc)
+{
+  static unsigned int Time = 0;
+  struct DCPage *Pg;
+  int J,K,N;
+
+  DCBase[P] = RAM[P];
+  DCMap[P]  = 0;
+  DCPg[P]   = 0;
+
+  /* Look for an existing table */
+  for(J=0;(J<DC_PAGES)&&(DCPage[J].Base!=RAM[P]);++J);
+  if(J<DC_PAGES)
+  {
+    DCPage[J].Used = ++Time;
+    DCMap[P]       = DCPage[J].Op;
+    DCPg[P]        = &DCPage[J];
+    return;
+  }
+
+  /* Only allocate tables for code */
+  if(!Alloc||!RAM[P]) return;
+
+  /* Find least recently used table not mapped anywhere */
+  for(J=0,K=-1;J<DC_PAGES;++J)
+  {
+    for(N=0;(N<8)&&(DCPage[J].Base!=RAM[N]);++N);
+    if((N==8)&&((K<0)||(DCPage[J].Used<DCPage[K].Used))) K=J;
+  }
+
+  /* Recycle it */
+  Pg          = &DCPage[K];
+  Pg->Base    = RAM[P];
+  Pg->Used    = ++Time;
+  DCClear(Pg);
+
+  /* Other pages may have cached the old table, or no table */
+  /* for the same RAM[] page                               */
+  for(N=0;N<8;++N)
+    if((DCPg[N]==Pg)||(DCBase[N]==RAM[P])) DCBase[N]=0;
+  DCBase[P] = RAM[P];
+  DCMap[P]  = Pg->Op;
+  DCPg[P]   = Pg;
+}
+
+/** BlkTranslate() *******************************************/
+/** Translate a block starting at address PC of the decoded **/
+/** page Pg. Op is the plain handler of the first opcode,   **/
+/** BOps[] are block handlers, and End leaves the block.    **/
+/** Returns 1 if a block has been made, 0 otherwise.        **/
+/*************************************************************/
+static uint8_t BlkTranslate(struct DCPage *Pg,uint16_t PC,const void *Op,const void *const *BOps,const void *End)
+{
+  const uint8_t *Page = RAM[PC>>13];
+  uint8_t Code[BLK_MAX];
+  unsigned int A,J,N,Off;
+
+  /* Do not translate self-modifying code again */
+  if(Pg->BFlags[PC&0x1FFF]&BLK_BAN) return(0);
+
+  /* Collect opcodes up to the first one ending the block */
+  for(A=PC&0x1FFF,N=0;(N<BLK_MAX)&&(A<0x2000);A+=BlkInfo[Code[N++]]&0x03)
+    if(!CodeZ80((PC&0xE000)|A)||!BlkInfo[Code[N]=Page[A]]) break;
+
+  /* Single opcodes are not worth it */
+  if(N<2) return(0);
+
+  /* Drop all blocks in this page when out of space */
+  if(Pg->BlkUsed+BLK_MAX+2>BLK_OPS) DCClear(Pg);
+
+  /* Store handlers and cycles left to the end of block */
+  Off               = Pg->BlkUsed;
+  Pg->BlkUsed      += N+2;
+  Pg->BOp[Off]      = Op;
+  Pg->BOp[Off+N+1]  = End;
+  Pg->BCyc[Off+N+1] = 0;
+  for(A=N;A--;)
+  {
+    Pg->BOp[Off+A+1]  = BOps[Code[A]];
+    Pg->BCyc[Off+A+1] = Pg->BCyc[Off+A+2]+Cycles[Code[A]];
+  }
+
+  /* Mark opcodes belonging to the block */
+  for(A=PC&0x1FFF,J=0;J<N;A+=BlkInfo[Code[J++]]&0x03)
+    Pg->BFlags[A]|=BLK_IN;
+
+  Pg->BlkAt[PC&0x1FFF]=Off+1;
+  DCMark(Pg,PC&0x1FFF,A-1);
+  return(1);
+}
+
+/** TouchZ80() ***********************************************/
+/** Drop decoded opcode at address A. Call it whenever code **/
+/** at A changes without going through WrZ80(). Remapping   **/
+/** RAM[] pages does not require this call.                 **/
+/*************************************************************/
+void TouchZ80(uint16_t A)
+{
+  uint8_t P = A>>13;
+  struct DCPage *Pg;
+  int J;
+
+  if(DCBase[P]!=RAM[P]) DCLookup(P,0);
+  if(!(Pg=DCPg[P])) return;
+
+  A&=0x1FFF;
+  Pg->Op[A]=0;
+
+  /* Drop all blocks that may contain this opcode */
+  if(Pg->BFlags[A]&BLK_IN)
+  {
+    for(J=A;(J>=0)&&(J>A-BLK_BYTES);--J)
+      if(Pg->BlkAt[J])
+      {
+        Pg->BlkAt[J]   = 0;
+        Pg->Op[J]      = 0;
+        Pg->BFlags[J] |= BLK_BAN;
+      }
+    Pg->BFlags[A] &= ~BLK_IN;
+    BlkStop        = 1;
+  }
+}
+
+/** TouchRun() ***********************************************/
+/** Drop decoded opcodes at N addresses from A on, all in   **/
+/** the same 8kB page, as TouchZ80() does for each of them. **/
+/*************************************************************/
+static void TouchRun(uint16_t A,int N)
+{
+  uint8_t P = A>>13;
+  struct DCPage *Pg;
+  int J,K;
+
+  if(DCBase[P]!=RAM[P]) DCLookup(P,0);
+  if(!(Pg=DCPg[P])) return;
+
+  K = A&0x1FFF;
+  for(J=0;J<N;++J) Pg->Op[K+J]=0;
+
+  /* Opcodes in blocks are rare, drop those one by one */
+  for(J=0;J<N;++J)
+    if(Pg->BFlags[K+J]&BLK_IN) TouchZ80(A+J);
+}
+
+/** FlushZ80() ***********************************************/
+/** Drop all decoded opcodes. Call it when memory contents  **/
+/** are replaced wholesale, i.e. when loading state.        **/
+/*************************************************************/
+void FlushZ80(void)
+{
+  int J;
+
+  for(J=0;J<DC_PAGES;++J) { DCPage[J].Base=0;DCPage[J].Used=0; }
+  for(J=0;J<8;++J) { DCBase[J]=0;DCMap[J]=0;DCPg[J]=0; }
+}
+
+/** Threaded Dispatch ****************************************/
+/** Each handler ends by fetching the next handler from the **/
+/** decode cache, decoding via RdZ80() on a miss, and then  **/
+/** jumping to it directly.                                 **/
+/*************************************************************/
+#define TH_OP(H,L)     TH_OP_(H,L)
+#define TH_OP_(H,L)    0x##H##L
+#define TH_LABEL(H,L)  TH_LABEL_(H,L)
+#define TH_LABEL_(H,L) Op##H##L
+#define TB_LABEL(H,L)  TB_LABEL_(H,L)
+#define TB_LABEL_(H,L) Blk##H##L
+#define TH_ROW(H) \
+  &&Op##H##0,&&Op##H##1,&&Op##H##2,&&Op##H##3, \
+  &&Op##H##4,&&Op##H##5,&&Op##H##6,&&Op##H##7, \
+  &&Op##H##8,&&Op##H##9,&&Op##H##A,&&Op##H##B, \
+  &&Op##H##C,&&Op##H##D,&&Op##H##E,&&Op##H##F
+#define TB_ROW(H) \
+  &&Blk##H##0,&&Blk##H##1,&&Blk##H##2,&&Blk##H##3, \
+  &&Blk##H##4,&&Blk##H##5,&&Blk##H##6,&&Blk##H##7, \
+  &&Blk##H##8,&&Blk##H##9,&&Blk##H##A,&&Blk##H##B, \
+  &&Blk##H##C,&&Blk##H##D,&&Blk##H##E,&&Blk##H##F
+
+#define TH_DISPATCH \
+  P=R->PC.W>>13; \
+  if(DCBase[P]!=RAM[P]) DCLookup(P,1); \
+  Map=DCMap[P]; \
+  if(!Map||!(Op=Map[R->PC.W&0x1FFF])) goto Decode; \
+  R->PC.W++; \
+  goto *Op
+
+/** RunThreaded() ********************************************/
+/** Threaded version of RunZ80(). Handlers are generated by **/
+/** CodesTh.h from the same Codes.h used by RunZ80().       **/
+/*************************************************************/
+static uint16_t RunThreaded(Z80 *R)
+{
+  static const void *const Ops[256] =
+  {
+    TH_ROW(0),TH_ROW(1),TH_ROW(2),TH_ROW(3),
+    TH_ROW(4),TH_ROW(5),TH_ROW(6),TH_ROW(7),
+    TH_ROW(8),TH_ROW(9),TH_ROW(A),TH_ROW(B),
+    TH_ROW(C),TH_ROW(D),TH_ROW(E),TH_ROW(F)
+  };
+  static const void *const BOps[256] =
+  {
+    TB_ROW(0),TB_ROW(1),TB_ROW(2),TB_ROW(3),
+    TB_ROW(4),TB_ROW(5),TB_ROW(6),TB_ROW(7),
+    TB_ROW(8),TB_ROW(9),TB_ROW(A),TB_ROW(B),
+    TB_ROW(C),TB_ROW(D),TB_ROW(E),TB_ROW(F)
+  };
+  const uint8_t Blocks = ThreadedZ80>1;
+  const void *const *BOp;
+  const void *const *BStart;
+  const uint8_t *BBase;
+  struct DCPage *Pg;
+  const void **Map;
+  const void *Op;
+  uint16_t K;
+  uint8_t I,P,BP;
+  pair J;
+
+  /* No block is running yet */
+  BOp=BStart=0;
+  BBase=0;
+  Pg=0;
+  BP=0;
+
+  /* Start executing */
+  TH_DISPATCH;
+
+  /* Opcode handlers */
+#include "CodesTh.h"
+
+  /* Block handlers */
+#define TH_BLOCK
+#include "CodesTh.h"
+#undef TH_BLOCK
+
+Decode:
+  /* Decode opcode, try making a block if enabled */
+  Op=Ops[RdZ80(R->PC.W)];
+  if(Map&&CodeZ80(R->PC.W))
+  {
+    if(Blocks&&BlkTranslate(DCPg[P],R->PC.W,Op,BOps,&&BlkEnd)) Op=&&BlkEnter;
+    Map[R->PC.W&0x1FFF]=Op;
+    DCMark(DCPg[P],R->PC.W&0x1FFF,R->PC.W&0x1FFF);
+  }
+  R->PC.W++;
+  goto *Op;
+
+BlkEnter:
+  /* Enter block if it ends before LoopZ80() is due */
+  Pg=DCPg[P];
+  K=Pg->BlkAt[(R->PC.W-1)&0x1FFF]-1;
+  if(R->ICount<=Pg->BCyc[K+1]) goto *Pg->BOp[K];
+  R->PC.W--;
+  R->ICount-=Pg->BCyc[K+1];
+  BStart=BOp=&Pg->BOp[K+1];
+  BBase=RAM[P];
+  BP=P;
+  BlkStop=0;
+  goto *(*BOp);
+
+BlkAbort:
+  /* Return cycles of opcodes not executed */
+  R->ICount+=Pg->BCyc[BOp-Pg->BOp+1];
+  ++BOp;
+
+BlkEnd:
+  /* Count executed opcodes */
+  INCR(BOp-BStart);
+  TH_DISPATCH;
+
+Expired:
+  /* Same as in RunZ80() */
+  if(R->IFF&IFF_EI)
+  {
+    R->IFF=(R->IFF&~IFF_EI)|IFF_1; /* Done with AfterEI state */
+    R->ICount+=R->IBackup-1;       /* Restore the ICount      */
+
+    /* Call periodic handler or set pending IRQ */
+    if(R->ICount>0) J.W=R->IRequest;
+    else
+    {
+      J.W=LoopZ80(R);        /* Call periodic handler    */
+      R->ICount+=R->IPeriod; /* Reset the cycle counter  */
+      if(J.W==INT_NONE) J.W=R->IRequest;  /* Pending IRQ */
+    }
+  }
+  else
+  {
+    J.W=LoopZ80(R);          /* Call periodic handler    */
+    R->ICount+=R->IPeriod;   /* Reset the cycle counter  */
+    if(J.W==INT_NONE) J.W=R->IRequest;    /* Pending IRQ */
+  }
+
+  if(J.W==INT_QUIT) return(R->PC.W); /* Exit if INT_QUIT */
+  if(J.W!=INT_NONE) IntZ80(R,J.W);   /* Int-pt if needed */
+  TH_DISPATCH;
+}
+#endif /* Z80_THREADED */
+
 /** RunZ80() *************************************************/
 /** This function will run Z80 code until a LoopZ80()  call **/
 /** returns INT_QUIT. It will return the PC at which        **/
@@ -595,6 +1257,14 @@ uint16_t RunZ80(Z80 *R)
   uint8_t I;
   pair J;
 
+  /* Registers may have been changed by the caller */
+  M_BUSY;
+
+#ifdef Z80_THREADED
+  /* Use threaded interpreter if enabled */
+  if(ThreadedZ80) return(RunThreaded(R));
+#endif
+
   for(;;)
   {
 #ifdef DEBUG
@@ -116,6 +116,82 @@ void IntZ80(Z80 *R,uint16_t Vector);
 uint16_t RunZ80(Z80 *R);
 #endif
 
+/** Threaded Interpreter *************************************/
+/** When Z80_THREADED is #defined, RunZ80() can decode each **/
+/** opcode once into a per-8kB-page cache of handlers and   **/
+/** dispatch them with computed goto. Set ThreadedZ80=2 to  **/
+/** also translate straight-line code into blocks of such   **/
+/** handlers, or ThreadedZ80=0 to use the plain switch()    **/
+/** interpreter. Cycle counting is identical in all cases.  **/
+/*************************************************************/
+#if defined(Z80_THREADED) && !defined(__GNUC__)
+#undef Z80_THREADED
+#endif
+#if defined(Z80_THREADED) && (defined(EXECZ80) || defined(DEBUG))
+#undef Z80_THREADED
+#endif
+
+#ifdef Z80_THREADED
+extern int ThreadedZ80;  /* 1: Threaded, 2: +blocks      */
+
+/** TouchZ80() ***********************************************/
+/** Drop decoded opcode at address A. Call it whenever code **/
+/** at A changes without going through WrZ80(). Remapping   **/
+/** RAM[] pages does not require this call.                 **/
+/*************************************************************/
+void TouchZ80(uint16_t A);
+
+/** FlushZ80() ***********************************************/
+/** Drop all decoded opcodes. Call it when memory contents  **/
+/** are replaced wholesale, i.e. when loading state.        **/
+/*************************************************************/
+void FlushZ80(void);
+
+/** CodeZ80() ************************************************/
+/** Z80 emulation calls this function to check if opcode at **/
+/** address A is plain memory that can be decoded once, as  **/
+/** opposed to a hardware register read with RdZ80().       **/
+/************************************ TO BE WRITTEN BY USER **/
+uint8_t CodeZ80(uint16_t A);
+#else
+#define TouchZ80(A) ((void)0)
+#define FlushZ80()  ((void)0)
+#endif
+
+/** Idle Loop Skipping ***************************************/
+/** When Z80_IDLE is #defined, RunZ80() detects loops that  **/
+/** return to the same register state without changing     **/
+/** memory or writing ports, such as VBlank or keyboard     **/
+/** polling, and skips their iterations up to the next      **/
+/** LoopZ80() call. DJNZ delay loops are skipped as well.   **/
+/** Cycles skipped this way and by HALT go to IdleCycles.   **/
+/*************************************************************/
+#if defined(Z80_IDLE) && (defined(EXECZ80) || defined(DEBUG))
+#undef Z80_IDLE
+#endif
+
+#ifdef Z80_IDLE
+extern uint64_t IdleCycles;  /* Total CPU cycles skipped     */
+
+/** BusyZ80() ************************************************/
+/** Call this function from RdZ80(), WrZ80(), and InZ80()   **/
+/** when an access changes hardware state, so that the      **/
+/** current loop will not be skipped.                       **/
+/*************************************************************/
+void BusyZ80(void);
+
+/** ChangeZ80() **********************************************/
+/** Call this function from WrZ80() when plain RAM at A is  **/
+/** about to change from value Old. Loops that restore such **/
+/** RAM before jumping back, i.e. with PUSH/POP, can still  **/
+/** be skipped.                                             **/
+/*************************************************************/
+void ChangeZ80(uint16_t A,uint8_t Old);
+#else
+#define BusyZ80()         ((void)0)
+#define ChangeZ80(A,Old) ((void)0)
+#endif
+
 /** RdZ80()/WrZ80() ******************************************/
 /** These functions are called when access to RAM occurs.   **/
 /** They allow to control memory access.                    **/
@@ -131,6 +207,24 @@ uint8_t RdZ80(uint16_t Addr);
 void OutZ80(uint16_t Port,uint8_t Value);
 uint8_t InZ80(uint16_t Port);
 
+/** PlainZ80() ***********************************************/
+/** Z80 emulation calls this function to find 256 bytes of  **/
+/** plain RAM at A&FF00h, that RdZ80() (Write=0) or WrZ80() **/
+/** (Write=1) would access directly, so that LDIR, LDDR and **/
+/** OTIR can move them in runs. Return a pointer to the     **/
+/** first byte, or 0 if the block is not plain RAM.         **/
+/************************************ TO BE WRITTEN BY USER **/
+uint8_t *PlainZ80(uint16_t A,uint8_t Write);
+
+/** OutsZ80() ************************************************/
+/** Z80 emulation calls this function with N bytes that     **/
+/** OTIR is about to write to ports Port, Port-100h, and so **/
+/** on. Write as many of them as OutZ80() would at once,    **/
+/** without changing memory mapping, and return how many    **/
+/** were written. Return 0 to get OutZ80() calls instead.   **/
+/************************************ TO BE WRITTEN BY USER **/
+int OutsZ80(uint16_t Port,const uint8_t *Data,int N);
+
 /** PatchZ80() ***********************************************/
 /** Z80 emulation calls this function when it encounters a  **/
 /** special patch command (ED FE) provided for user needs.  **/
@@ -13,31 +13,387 @@
 /**     changes to this file.                               **/
 /*************************************************************/
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+#if defined(__SSSE3__) || (defined(__SSE2__) && defined(__GNUC__) && (__GNUC__>=5 || defined(__clang__)))
+#include <tmmintrin.h>
+#define PAL_X86
+#endif
+
 static int FirstLine = 10 + BORDER;/* First scanline in XBuf */
 
-static void  Sprites(uint8_t Y,uint16_t *Line);
+static void  Sprites(uint8_t Y,pixel *Line);
 static void  ColorSprites(uint8_t Y,uint8_t *ZBuf);
-static uint16_t *RefreshBorder(uint8_t Y,uint16_t C);
-static void  ClearLine(uint16_t *P,uint16_t C);
-static uint16_t YJKColor(int Y,int J,int K);
+static pixel *RefreshBorder(uint8_t Y,pixel C);
+static void  ClearLine(pixel *P,pixel C);
+static void  FillLine(pixel *P,pixel C,int N);
+static void  ExpandByte(pixel *P,uint8_t K,pixel FC,pixel BC);
+static pixel YJKColor(int Y,int J,int K);
+static const pixel *YJKTable(void);
+
+/** YJK Colors ***********************************************/
+/** All 5bit Y by 6bit J by 6bit K colors, indexed by       **/
+/** (Y<<12)|(J<<6)|K with J and K taken straight from VRAM. **/
+/** YJKTable() builds it on first use and again whenever    **/
+/** PIXEL() starts producing a different format.            **/
+/*************************************************************/
+static pixel   YJKTab[32*64*64];
+static pixel   YJKFormat = 0;
+static uint8_t YJKReady  = 0;
+
+/** Palette Shuffles *****************************************/
+/** With SSSE3 or NEON, 16-color modes look up 16 pixels at **/
+/** once by shuffling each byte plane of XPal[0..15] (B[0]  **/
+/** being the lowest) with a vector of color numbers.       **/
+/** LoadPal() prepares this PalTab once per line, after     **/
+/** RefreshBorder() sets XPal[0]. x86 builds without SSSE3  **/
+/** enabled compile this code for SSSE3 only (PAL_TARGET)   **/
+/** and use it if the CPU has SSSE3. PalSIMD=0 forces the   **/
+/** scalar code, -1 asks the CPU (PAL_CPU) on first use.    **/
+/*************************************************************/
+#if defined(PAL_X86) && !defined(MSB_FIRST)
+#define PAL_SSSE3
+typedef struct { __m128i B[sizeof(pixel)]; } PalTab;
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(MSB_FIRST)
+#define PAL_NEON
+typedef struct { uint8x16_t B[sizeof(pixel)]; } PalTab;
+#ifdef __aarch64__
+#define PAL_TBL(Tab,I) vqtbl1q_u8(Tab,I)
+#else
+#define PAL_TBL(Tab,I) vcombine_u8( \
+  vtbl2_u8((uint8x8x2_t){{ vget_low_u8(Tab),vget_high_u8(Tab) }},vget_low_u8(I)), \
+  vtbl2_u8((uint8x8x2_t){{ vget_low_u8(Tab),vget_high_u8(Tab) }},vget_high_u8(I)))
+#endif
+#endif
+
+#if (defined(PAL_SSSE3) || defined(PAL_NEON)) && !defined(PAL_TARGET)
+#define PAL_SIMD
+#if defined(PAL_SSSE3) && !defined(__SSSE3__)
+#define PAL_TARGET __attribute__((target("ssse3")))
+#define PAL_CPU    __builtin_cpu_supports("ssse3")
+#else
+#define PAL_TARGET
+#define PAL_CPU    1
+#endif
+static int PalSIMD = -1;
+#endif
+
+static void  NibbleRun(pixel *P,const uint8_t *T,const uint8_t *R,int Wide,int N);
+static void  CrumbRun(pixel *P,const uint8_t *T,const uint8_t *R,int N);
+#ifdef PAL_SIMD
+PAL_TARGET static void LoadPal(PalTab *Tab,const pixel *Pal);
+PAL_TARGET static void PalNibbles(pixel *P,const uint8_t *T,const uint8_t *R,int Wide,const PalTab *Tab);
+PAL_TARGET static void PalCrumbs(pixel *P,const uint8_t *T,const uint8_t *R,const PalTab *Tab);
+#endif
 
 extern void PutImage(void);
 
 /** ClearLine() **********************************************/
-/** Clear 256 uint16_ts from P with color C.                   **/
+/** Clear 256 pixels from P with color C.                   **/
 /*************************************************************/
-static void ClearLine(uint16_t *P,uint16_t C)
+static void ClearLine(pixel *P,pixel C)
 {
   int J;
 
   for(J=0;J<256;J++) P[J]=C;
 }
 
+/** FillLine() ***********************************************/
+/** Fill N pixels from P with color C.                      **/
+/*************************************************************/
+INLINE void FillLine(pixel *P,pixel C,int N)
+{
+  while(N--) *P++=C;
+}
+
+/** ExpandByte() *********************************************/
+/** Write 8 pixels to P, FC for each set bit of pattern K   **/
+/** (MSB first) and BC for each clear one. All 8 pixels are **/
+/** always written, even when the caller only needs 6.      **/
+/*************************************************************/
+INLINE void ExpandByte(pixel *P,uint8_t K,pixel FC,pixel BC)
+{
+#if defined(__SSE2__) && defined(BPP32)
+  const __m128i B0 = _mm_set_epi32(0x10,0x20,0x40,0x80);
+  const __m128i B1 = _mm_set_epi32(0x01,0x02,0x04,0x08);
+  __m128i V = _mm_set1_epi32(K);
+  __m128i F = _mm_set1_epi32(FC);
+  __m128i B = _mm_set1_epi32(BC);
+  __m128i M = _mm_cmpeq_epi32(_mm_and_si128(V,B0),B0);
+  _mm_storeu_si128((__m128i *)P,_mm_or_si128(_mm_and_si128(M,F),_mm_andnot_si128(M,B)));
+  M = _mm_cmpeq_epi32(_mm_and_si128(V,B1),B1);
+  _mm_storeu_si128((__m128i *)(P+4),_mm_or_si128(_mm_and_si128(M,F),_mm_andnot_si128(M,B)));
+#elif defined(__SSE2__)
+  const __m128i Bits = _mm_set_epi16(0x01,0x02,0x04,0x08,0x10,0x20,0x40,0x80);
+  __m128i M = _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16(K),Bits),Bits);
+  __m128i V = _mm_or_si128(_mm_and_si128(M,_mm_set1_epi16(FC)),_mm_andnot_si128(M,_mm_set1_epi16(BC)));
+  _mm_storeu_si128((__m128i *)P,V);
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(BPP32)
+  static const uint32_t Bits[8] = { 0x80,0x40,0x20,0x10,0x08,0x04,0x02,0x01 };
+  uint32x4_t V = vdupq_n_u32(K);
+  vst1q_u32(P,vbslq_u32(vtstq_u32(V,vld1q_u32(Bits)),vdupq_n_u32(FC),vdupq_n_u32(BC)));
+  vst1q_u32(P+4,vbslq_u32(vtstq_u32(V,vld1q_u32(Bits+4)),vdupq_n_u32(FC),vdupq_n_u32(BC)));
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  static const uint16_t Bits[8] = { 0x80,0x40,0x20,0x10,0x08,0x04,0x02,0x01 };
+  uint16x8_t M = vtstq_u16(vdupq_n_u16(K),vld1q_u16(Bits));
+  vst1q_u16(P,vbslq_u16(M,vdupq_n_u16(FC),vdupq_n_u16(BC)));
+#else
+  P[0]=K&0x80? FC:BC;P[1]=K&0x40? FC:BC;
+  P[2]=K&0x20? FC:BC;P[3]=K&0x10? FC:BC;
+  P[4]=K&0x08? FC:BC;P[5]=K&0x04? FC:BC;
+  P[6]=K&0x02? FC:BC;P[7]=K&0x01? FC:BC;
+#endif
+}
+
+#ifdef PAL_SIMD
+/** LoadPal() ************************************************/
+/** Prepare PalTab for 16 colors starting at Pal.           **/
+/*************************************************************/
+PAL_TARGET INLINE void LoadPal(PalTab *Tab,const pixel *Pal)
+{
+#if defined(PAL_SSSE3) && defined(BPP32)
+  /* Gather byte planes in each 4 colors, then transpose */
+  const __m128i S = _mm_setr_epi8(0,4,8,12,1,5,9,13,2,6,10,14,3,7,11,15);
+  __m128i A = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)Pal),S);
+  __m128i B = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(Pal+4)),S);
+  __m128i C = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(Pal+8)),S);
+  __m128i D = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(Pal+12)),S);
+  __m128i AB = _mm_unpacklo_epi32(A,B);
+  __m128i CD = _mm_unpacklo_epi32(C,D);
+  Tab->B[0] = _mm_unpacklo_epi64(AB,CD);
+  Tab->B[1] = _mm_unpackhi_epi64(AB,CD);
+  AB = _mm_unpackhi_epi32(A,B);
+  CD = _mm_unpackhi_epi32(C,D);
+  Tab->B[2] = _mm_unpacklo_epi64(AB,CD);
+  Tab->B[3] = _mm_unpackhi_epi64(AB,CD);
+#elif defined(PAL_SSSE3)
+  const __m128i M = _mm_set1_epi16(0xFF);
+  __m128i A = _mm_loadu_si128((const __m128i *)Pal);
+  __m128i B = _mm_loadu_si128((const __m128i *)(Pal+8));
+  Tab->B[0] = _mm_packus_epi16(_mm_and_si128(A,M),_mm_and_si128(B,M));
+  Tab->B[1] = _mm_packus_epi16(_mm_srli_epi16(A,8),_mm_srli_epi16(B,8));
+#elif defined(PAL_NEON) && defined(BPP32)
+  uint8x16x4_t V = vld4q_u8((const uint8_t *)Pal);
+  Tab->B[0] = V.val[0];
+  Tab->B[1] = V.val[1];
+  Tab->B[2] = V.val[2];
+  Tab->B[3] = V.val[3];
+#elif defined(PAL_NEON)
+  uint8x16x2_t V = vld2q_u8((const uint8_t *)Pal);
+  Tab->B[0] = V.val[0];
+  Tab->B[1] = V.val[1];
+#endif
+}
+
+#if defined(PAL_SSSE3)
+/** PalStore() ***********************************************/
+/** Write 16 pixels of colors I to P, with non-zero sprite  **/
+/** colors R taking priority.                               **/
+/*************************************************************/
+PAL_TARGET INLINE void PalStore(pixel *P,__m128i I,__m128i R,const PalTab *Tab)
+{
+  __m128i Z = _mm_cmpeq_epi8(R,_mm_setzero_si128());
+  __m128i Lo,Hi;
+#ifdef BPP32
+  __m128i B0,B1,B2,B3;
+
+  I  = _mm_or_si128(_mm_and_si128(Z,I),_mm_andnot_si128(Z,R));
+  B0 = _mm_shuffle_epi8(Tab->B[0],I);
+  B1 = _mm_shuffle_epi8(Tab->B[1],I);
+  B2 = _mm_shuffle_epi8(Tab->B[2],I);
+  B3 = _mm_shuffle_epi8(Tab->B[3],I);
+  Lo = _mm_unpacklo_epi8(B0,B1);
+  Hi = _mm_unpacklo_epi8(B2,B3);
+  _mm_storeu_si128((__m128i *)P,_mm_unpacklo_epi16(Lo,Hi));
+  _mm_storeu_si128((__m128i *)(P+4),_mm_unpackhi_epi16(Lo,Hi));
+  Lo = _mm_unpackhi_epi8(B0,B1);
+  Hi = _mm_unpackhi_epi8(B2,B3);
+  _mm_storeu_si128((__m128i *)(P+8),_mm_unpacklo_epi16(Lo,Hi));
+  _mm_storeu_si128((__m128i *)(P+12),_mm_unpackhi_epi16(Lo,Hi));
+#else
+  I  = _mm_or_si128(_mm_and_si128(Z,I),_mm_andnot_si128(Z,R));
+  Lo = _mm_shuffle_epi8(Tab->B[0],I);
+  Hi = _mm_shuffle_epi8(Tab->B[1],I);
+  _mm_storeu_si128((__m128i *)P,_mm_unpacklo_epi8(Lo,Hi));
+  _mm_storeu_si128((__m128i *)(P+8),_mm_unpackhi_epi8(Lo,Hi));
+#endif
+}
+
+/** PalSprites() *********************************************/
+/** Load sprite colors for 16 pixels from R. When Wide is   **/
+/** set, each of 8 entries in R covers two pixels.          **/
+/*************************************************************/
+PAL_TARGET INLINE __m128i PalSprites(const uint8_t *R,int Wide)
+{
+  __m128i V;
+
+  if(!Wide) return(_mm_loadu_si128((const __m128i *)R));
+  V = _mm_loadl_epi64((const __m128i *)R);
+  return(_mm_unpacklo_epi8(V,V));
+}
+#elif defined(PAL_NEON)
+INLINE void PalStore(pixel *P,uint8x16_t I,uint8x16_t R,const PalTab *Tab)
+{
+#ifdef BPP32
+  uint8x16x4_t V;
+#else
+  uint8x16x2_t V;
+#endif
+
+  I = vbslq_u8(vceqq_u8(R,vdupq_n_u8(0)),I,R);
+  V.val[0] = PAL_TBL(Tab->B[0],I);
+  V.val[1] = PAL_TBL(Tab->B[1],I);
+#ifdef BPP32
+  V.val[2] = PAL_TBL(Tab->B[2],I);
+  V.val[3] = PAL_TBL(Tab->B[3],I);
+  vst4q_u8((uint8_t *)P,V);
+#else
+  vst2q_u8((uint8_t *)P,V);
+#endif
+}
+
+INLINE uint8x16_t PalSprites(const uint8_t *R,int Wide)
+{
+  uint8x8x2_t V;
+
+  if(!Wide) return(vld1q_u8(R));
+  V = vzip_u8(vld1_u8(R),vld1_u8(R));
+  return(vcombine_u8(V.val[0],V.val[1]));
+}
+#endif
+
+/** PalNibbles() *********************************************/
+/** Write 16 pixels of 4bpp data from 8 bytes at T to P,    **/
+/** with non-zero sprite colors in R taking priority. When  **/
+/** Wide is set, each entry in R covers two pixels.         **/
+/*************************************************************/
+PAL_TARGET INLINE void PalNibbles(pixel *P,const uint8_t *T,const uint8_t *R,int Wide,const PalTab *Tab)
+{
+#if defined(PAL_SSSE3)
+  const __m128i F = _mm_set1_epi8(0x0F);
+  __m128i V = _mm_loadl_epi64((const __m128i *)T);
+  V = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(V,4),F),_mm_and_si128(V,F));
+  PalStore(P,V,PalSprites(R,Wide),Tab);
+#elif defined(PAL_NEON)
+  uint8x8_t V = vld1_u8(T);
+  uint8x8x2_t I = vzip_u8(vshr_n_u8(V,4),vand_u8(V,vdup_n_u8(0x0F)));
+  PalStore(P,vcombine_u8(I.val[0],I.val[1]),PalSprites(R,Wide),Tab);
+#endif
+}
+
+/** PalCrumbs() **********************************************/
+/** Write 16 pixels of 2bpp data from 4 bytes at T to P,    **/
+/** with non-zero sprite colors in R taking priority. Each  **/
+/** entry in R covers two pixels.                           **/
+/*************************************************************/
+PAL_TARGET INLINE void PalCrumbs(pixel *P,const uint8_t *T,const uint8_t *R,const PalTab *Tab)
+{
+#if defined(PAL_SSSE3)
+  int W;
+  __m128i V;
+
+  /* Repeat each byte 4 times, pick 2 bits at each position */
+  memcpy(&W,T,4);
+  V = _mm_cvtsi32_si128(W);
+  V = _mm_unpacklo_epi8(V,V);
+  V = _mm_unpacklo_epi16(V,V);
+  V = _mm_or_si128(
+        _mm_or_si128(
+          _mm_and_si128(_mm_srli_epi16(V,6),_mm_set1_epi32(0x00000003)),
+          _mm_and_si128(_mm_srli_epi16(V,4),_mm_set1_epi32(0x00000300))),
+        _mm_or_si128(
+          _mm_and_si128(_mm_srli_epi16(V,2),_mm_set1_epi32(0x00030000)),
+          _mm_and_si128(V,_mm_set1_epi32(0x03000000))));
+  PalStore(P,V,PalSprites(R,1),Tab);
+#elif defined(PAL_NEON)
+  static const int8_t Shifts[16] = { -6,-4,-2,0,-6,-4,-2,0,-6,-4,-2,0,-6,-4,-2,0 };
+  uint32_t W;
+  uint8x8_t V;
+  uint8x16_t I;
+
+  /* Repeat each byte 4 times, pick 2 bits at each position */
+  memcpy(&W,T,4);
+  V = vreinterpret_u8_u32(vdup_n_u32(W));
+  I = vcombine_u8(vtbl1_u8(V,vcreate_u8(0x0101010100000000ULL)),
+                  vtbl1_u8(V,vcreate_u8(0x0303030302020202ULL)));
+  I = vandq_u8(vshlq_u8(I,vld1q_s8(Shifts)),vdupq_n_u8(0x03));
+  PalStore(P,I,PalSprites(R,1),Tab);
+#endif
+}
+
+/** PalNibbleRun() *******************************************/
+/** NibbleRun() with palette shuffles.                      **/
+/*************************************************************/
+PAL_TARGET static void PalNibbleRun(pixel *P,const uint8_t *T,const uint8_t *R,int Wide,int N)
+{
+  PalTab Tab;
+
+  LoadPal(&Tab,XPal);
+  for(;N;N--,P+=16,T+=8,R+=Wide? 8:16) PalNibbles(P,T,R,Wide,&Tab);
+}
+
+/** PalCrumbRun() ********************************************/
+/** CrumbRun() with palette shuffles.                       **/
+/*************************************************************/
+PAL_TARGET static void PalCrumbRun(pixel *P,const uint8_t *T,const uint8_t *R,int N)
+{
+  PalTab Tab;
+
+  LoadPal(&Tab,XPal);
+  for(;N;N--,P+=16,T+=4,R+=8) PalCrumbs(P,T,R,&Tab);
+}
+#endif /* PAL_SIMD */
+
+/** NibbleRun() **********************************************/
+/** Write N*16 pixels of 4bpp data from T to P, with non-   **/
+/** zero sprite colors in R taking priority. When Wide is   **/
+/** set, each entry in R covers two pixels.                 **/
+/*************************************************************/
+static void NibbleRun(pixel *P,const uint8_t *T,const uint8_t *R,int Wide,int N)
+{
+  uint8_t C;
+
+#ifdef PAL_SIMD
+  if(PalSIMD<0) PalSIMD=!!PAL_CPU;
+  if(PalSIMD) { PalNibbleRun(P,T,R,Wide,N);return; }
+#endif
+
+  for(N<<=3;N;N--,P+=2,T++,R+=Wide? 1:2)
+  {
+    C=R[0];P[0]=XPal[C? C:T[0]>>4];
+    C=R[Wide? 0:1];P[1]=XPal[C? C:T[0]&0x0F];
+  }
+}
+
+/** CrumbRun() ***********************************************/
+/** Write N*16 pixels of 2bpp data from T to P, with non-   **/
+/** zero sprite colors in R taking priority. Each entry in  **/
+/** R covers two pixels.                                    **/
+/*************************************************************/
+static void CrumbRun(pixel *P,const uint8_t *T,const uint8_t *R,int N)
+{
+  uint8_t C;
+
+#ifdef PAL_SIMD
+  if(PalSIMD<0) PalSIMD=!!PAL_CPU;
+  if(PalSIMD) { PalCrumbRun(P,T,R,N);return; }
+#endif
+
+  for(N<<=2;N;N--,P+=4,T++,R+=2)
+  {
+    C=R[0];P[0]=XPal[C? C:T[0]>>6];P[1]=XPal[C? C:(T[0]>>4)&0x03];
+    C=R[1];P[2]=XPal[C? C:(T[0]>>2)&0x03];P[3]=XPal[C? C:T[0]&0x03];
+  }
+}
+
 /** YJKColor() ***********************************************/
 /** Given a color in YJK format, return the corresponding   **/
 /** palette entry.                                          **/
 /*************************************************************/
-INLINE uint16_t YJKColor(int Y,int J,int K)
+INLINE pixel YJKColor(int Y,int J,int K)
 {
   // See http://map.grauw.nl/articles/yjk/
   // YJK566 (17 bits of information, 131072 values) translates to RGB555 (15 bits, 32768 values)
@@ -54,15 +410,37 @@ INLINE uint16_t YJKColor(int Y,int J,int K)
   return PIXEL(R,G,B);
 }
 
+/** YJKTable() ***********************************************/
+/** Return YJKTab[], (re)building it if needed.             **/
+/*************************************************************/
+static const pixel *YJKTable(void)
+{
+  int Y,J,K;
+
+  /* A format change shows up in how a known color packs */
+  if(!YJKReady||(YJKFormat!=PIXEL(255,128,0)))
+  {
+    for(Y=0;Y<32;Y++)
+      for(J=0;J<64;J++)
+        for(K=0;K<64;K++)
+          YJKTab[(Y<<12)|(J<<6)|K]=YJKColor(Y,J&0x20? J-64:J,K&0x20? K-64:K);
+    YJKFormat=PIXEL(255,128,0);
+    YJKReady=1;
+  }
+
+  return(YJKTab);
+}
+
 /** RefreshBorder() ******************************************/
 /** This function is called from RefreshLine#() to refresh  **/
 /** the screen border. It returns a pointer to the start of **/
 /** scanline Y in XBuf or 0 if scanline is beyond XBuf.     **/
+/** XBuf lines are XPitch pixels apart, XRows lines total.  **/
 /*************************************************************/
-uint16_t *RefreshBorder(uint8_t Y,uint16_t C)
+pixel *RefreshBorder(uint8_t Y,pixel C)
 {
-  uint16_t *P;
-  int H,L,A;
+  pixel *P;
+  int H,L,R;
 
   /* First line number in the buffer */
   if(!Y) FirstLine=(ScanLines212?0:10)+BORDER+VAdjust;
@@ -70,11 +448,18 @@ uint16_t *RefreshBorder(uint8_t Y,uint16_t C)
   /* Return 0 if we've run out of the screen buffer due to overscan */
   if(Y>(OverscanMode?MAX_SCANLINE:211)) return(0);
 
+  /* Buffer must take lines this wide */
+  XFit(WIDTH);
+
+  /* Buffer line to draw scanline Y into */
+  R=HiResMode? ((FirstLine+Y)<<1)+(OddPage? 0:1):FirstLine+Y;
+  if(R+(HiResMode&&OddPage)>=XRows) return(0);
+
   /* Set up the transparent color */
   XPal[0]=(!BGColor||SolidColor0)? XPal0:XPal[BGColor];
 
   /* Start of the buffer */
-  P=(uint16_t *)XBuf;
+  P=(pixel *)XBuf;
 
   if(HiResMode)
   {
@@ -82,55 +467,37 @@ uint16_t *RefreshBorder(uint8_t Y,uint16_t C)
       /* Paint top of the screen */
       for(L=FirstLine;L>0;L--)
       {
-        for(A=((WIDTH*L)<<1)-1,H=WIDTH;H>0;H--,A--)
+        if (InterlacedMode)
         {
-          if (InterlacedMode)
-          {
-            if (OddPage)
-            { // even lines are black
-              P[A]=0;
-              P[A-WIDTH]=C;
-            }
-            else
-            { // odd lines are black
-              P[A]=C;
-              P[A-WIDTH]=0;
-            }
+          if (OddPage)
+          { // even lines are black
+            FillLine(P+XPitch*((L<<1)-1),0,WIDTH);
+            FillLine(P+XPitch*((L<<1)-2),C,WIDTH);
           }
-          else // progressive: only touch this frame's lines
-          {
-            if (OddPage)
-              P[A-WIDTH]=C;
-            else
-              P[A]=C;
+          else
+          { // odd lines are black
+            FillLine(P+XPitch*((L<<1)-1),C,WIDTH);
+            FillLine(P+XPitch*((L<<1)-2),0,WIDTH);
           }
         }
+        else // progressive: only touch this frame's lines
+          FillLine(P+XPitch*((L<<1)-(OddPage? 2:1)),C,WIDTH);
       }
 
     /* Start of the line */
-    P+=(WIDTH*(FirstLine+Y))<<1;
+    P+=XPitch*R;
 
-    if (OddPage)
-    {
-      if (InterlacedMode)
-        // erase previous frame's line
-        for(A=(WIDTH<<1)-1,H=WIDTH;H>0;H--,A--) P[A]=0;
-    }
-    else
-    {
-      if (InterlacedMode)
-        // erase previous frame's line
-        for(H=WIDTH-1;H>=0;H--) P[H]=0;
-      P+=WIDTH; // interlace offset
-    }
+    if (InterlacedMode)
+      // erase previous frame's line
+      FillLine(OddPage? P+XPitch:P-XPitch,0,WIDTH);
   }
   else // standard mode
   {
     /* Paint top of the screen */
-    if(!Y) for(H=WIDTH*FirstLine-1;H>=0;H--) P[H]=C;
+    if(!Y) for(L=0;L<FirstLine;L++) FillLine(P+XPitch*L,C,WIDTH);
 
     /* Start of the line */
-    P+=WIDTH*(FirstLine+Y);
+    P+=XPitch*R;
   }
 
   /* Paint left/right borders */
@@ -145,17 +512,16 @@ uint16_t *RefreshBorder(uint8_t Y,uint16_t C)
     if(Y==H-1)
       for(L=MAX_HEIGHT-Y;L>0;L--)
       {
-        for(A=((WIDTH*L)<<1)-1,H=WIDTH;H>0;H--,A--)
-        {
-          if (InterlacedMode)
-            // erase previous frame's line
-            P[A]=0;
-          P[A+WIDTH]=C;
-        }
+        if (InterlacedMode && (R+(L<<1)-1<XRows))
+          // erase previous frame's line
+          FillLine(P+XPitch*((L<<1)-1),0,WIDTH);
+        if(R+(L<<1)<XRows) FillLine(P+XPitch*(L<<1),C,WIDTH);
       }
   }
   else // standard mode
-    if(Y==H-1) for(H=WIDTH*(HEIGHT-H-FirstLine+1)-1;H>=WIDTH;H--) P[H]=C;
+    if(Y==H-1)
+      for(L=HEIGHT-H-FirstLine;L>0;L--)
+        if(R+L<XRows) FillLine(P+XPitch*L,C,WIDTH);
 
   /* Return pointer to the scanline in XBuf */
   return(P+(WIDTH-256)/2+HAdjust);
@@ -165,148 +531,120 @@ uint16_t *RefreshBorder(uint8_t Y,uint16_t C)
 /** This function is called from RefreshLine#() to refresh  **/
 /** sprites in SCREENs 1-3.                                 **/
 /*************************************************************/
-void Sprites(uint8_t Y,uint16_t *Line)
+void Sprites(uint8_t Y,pixel *Line)
 {
   static const uint8_t SprHeights[4] = { 8,16,16,32 };
-  uint16_t *P,C;
-  uint8_t OH,IH,*PT,*AT;
-  unsigned int M;
+  pixel *P,C;
+  uint8_t OH,IH,N,*PT,*AT,*S;
   int L,K;
 
-  /* No extra sprites yet */
-  VDPStatus[0]&=~0x5F;
-
   /* Assign initial values before counting */
   OH = SprHeights[VDP[1]&0x03];
   IH = SprHeights[VDP[1]&0x02];
-  AT = SprTab-4;
-  Y += VScroll;
-  C  = MAXSPRITE1+1;
-  M  = 0;
+  Y  = SpriteLine((uint8_t)(Y-VScroll));
+
+  /* Sprites crossing this line, stop at MAXSPRITE1 unless */
+  /* all-sprites option enabled. SpriteStatus() has set    */
+  /* the 5thSprite flag already                            */
+  S = SprList[Y];
+  N = SprCount[Y];
+  if((N>MAXSPRITE1)&&!OPTION(MSX_ALLSPRITE)) N=MAXSPRITE1;
 
-  /* Count displayed sprites */
-  for(L=0;L<32;++L)
+  /* Draw sprites crossing this line, last to first */
+  while(N)
   {
-    M<<=1;AT+=4;        /* Iterating through SprTab      */
-    K=AT[0];            /* K = sprite Y coordinate       */
-    if(K==208) break;   /* Iteration terminates if Y=208 */
-    if(K>256-IH) K-=256; /* Y coordinate may be negative  */
+    AT=SprTab+((int)S[--N]<<2);
+    C=AT[3];                  /* C = sprite attributes */
+    L=C&0x80? AT[1]-32:AT[1]; /* Sprite may be shifted left by 32 */
+    C&=0x0F;                  /* C = sprite color */
 
-    /* Mark all valid sprites with 1s, break at MAXSPRITE1 sprites */
-    if((Y>K)&&(Y<=K+OH))
+    if((L<256)&&(L>-OH)&&C)
     {
-      /* If we exceed the maximum number of sprites per line... */
-      if(!--C)
-      {
-        /* Set 5thSprite flag in the VDP status register */
-        VDPStatus[0]|=0x40;
-        /* Stop drawing sprites, unless all-sprites option enabled */
-        if(!OPTION(MSX_ALLSPRITE)) break;
-      }
+      K=AT[0];                /* K = sprite Y coordinate */
+      if(K>256-IH) K-=256;      /* Y coordinate may be negative */
 
-      /* Mark sprite as ready to draw */
-      M|=1;
-    }
-  }
+      P=Line+L;
+      K  = Y-K-1;
+      PT = SprGen+((int)(IH>8? AT[2]&0xFC:AT[2])<<3)+(OH>IH? (K>>1):K);
+      C=XPal[C];
 
-  /* Mark last checked sprite (5th in line, Y=208, or sprite #31) */
-  VDPStatus[0]|=L<32? L:31;
+      /* Mask 1: clip left sprite boundary */
+      K=L>=0? 0xFFFF:(0x10000>>(OH>IH? (-L>>1):-L))-1;
 
-  /* Draw all marked sprites */
-  for(;M;M>>=1,AT-=4)
-    if(M&1)
-    {
-      C=AT[3];                  /* C = sprite attributes */
-      L=C&0x80? AT[1]-32:AT[1]; /* Sprite may be shifted left by 32 */
-      C&=0x0F;                  /* C = sprite color */
-
-      if((L<256)&&(L>-OH)&&C)
+      /* Mask 2: clip right sprite boundary */
+      L+=(int)OH-257;
+      if(L>=0)
       {
-        K=AT[0];                /* K = sprite Y coordinate */
-        if(K>256-IH) K-=256;      /* Y coordinate may be negative */
+        L=(IH>8? 0x0002:0x0200)<<(OH>IH? (L>>1):L);
+        K&=~(L-1);
+      }
 
-        P=Line+L;
-        K  = Y-K-1;
-        PT = SprGen+((int)(IH>8? AT[2]&0xFC:AT[2])<<3)+(OH>IH? (K>>1):K);
-        C=XPal[C];
+      /* Get and clip the sprite data */
+      K&=((int)PT[0]<<8)|(IH>8? PT[16]:0x00);
 
-        /* Mask 1: clip left sprite boundary */
-        K=L>=0? 0xFFFF:(0x10000>>(OH>IH? (-L>>1):-L))-1;
+      /* If output size is bigger than the input size... */
+      if(OH>IH)
+      {
+        /* Big (zoomed) sprite */
 
-        /* Mask 2: clip right sprite boundary */
-        L+=(int)OH-257;
-        if(L>=0)
+        /* Draw left 16 pixels of the sprite */
+        if(K&0xFF00)
         {
-          L=(IH>8? 0x0002:0x0200)<<(OH>IH? (L>>1):L);
-          K&=~(L-1);
+          if(K&0x8000) P[1]=P[0]=C;
+          if(K&0x4000) P[3]=P[2]=C;
+          if(K&0x2000) P[5]=P[4]=C;
+          if(K&0x1000) P[7]=P[6]=C;
+          if(K&0x0800) P[9]=P[8]=C;
+          if(K&0x0400) P[11]=P[10]=C;
+          if(K&0x0200) P[13]=P[12]=C;
+          if(K&0x0100) P[15]=P[14]=C;
         }
 
-        /* Get and clip the sprite data */
-        K&=((int)PT[0]<<8)|(IH>8? PT[16]:0x00);
-
-        /* If output size is bigger than the input size... */
-        if(OH>IH)
+        /* Draw right 16 pixels of the sprite */
+        if(K&0x00FF)
         {
-          /* Big (zoomed) sprite */
-
-          /* Draw left 16 uint16_ts of the sprite */
-          if(K&0xFF00)
-          {
-            if(K&0x8000) P[1]=P[0]=C;
-            if(K&0x4000) P[3]=P[2]=C;
-            if(K&0x2000) P[5]=P[4]=C;
-            if(K&0x1000) P[7]=P[6]=C;
-            if(K&0x0800) P[9]=P[8]=C;
-            if(K&0x0400) P[11]=P[10]=C;
-            if(K&0x0200) P[13]=P[12]=C;
-            if(K&0x0100) P[15]=P[14]=C;
-          }
-
-          /* Draw right 16 uint16_ts of the sprite */
-          if(K&0x00FF)
-          {
-            if(K&0x0080) P[17]=P[16]=C;
-            if(K&0x0040) P[19]=P[18]=C;
-            if(K&0x0020) P[21]=P[20]=C;
-            if(K&0x0010) P[23]=P[22]=C;
-            if(K&0x0008) P[25]=P[24]=C;
-            if(K&0x0004) P[27]=P[26]=C;
-            if(K&0x0002) P[29]=P[28]=C;
-            if(K&0x0001) P[31]=P[30]=C;
-          }
+          if(K&0x0080) P[17]=P[16]=C;
+          if(K&0x0040) P[19]=P[18]=C;
+          if(K&0x0020) P[21]=P[20]=C;
+          if(K&0x0010) P[23]=P[22]=C;
+          if(K&0x0008) P[25]=P[24]=C;
+          if(K&0x0004) P[27]=P[26]=C;
+          if(K&0x0002) P[29]=P[28]=C;
+          if(K&0x0001) P[31]=P[30]=C;
         }
-        else
-        {
-          /* Normal (unzoomed) sprite */
+      }
+      else
+      {
+        /* Normal (unzoomed) sprite */
 
-          /* Draw left 8 uint16_ts of the sprite */
-          if(K&0xFF00)
-          {
-            if(K&0x8000) P[0]=C;
-            if(K&0x4000) P[1]=C;
-            if(K&0x2000) P[2]=C;
-            if(K&0x1000) P[3]=C;
-            if(K&0x0800) P[4]=C;
-            if(K&0x0400) P[5]=C;
-            if(K&0x0200) P[6]=C;
-            if(K&0x0100) P[7]=C;
-          }
+        /* Draw left 8 pixels of the sprite */
+        if(K&0xFF00)
+        {
+          if(K&0x8000) P[0]=C;
+          if(K&0x4000) P[1]=C;
+          if(K&0x2000) P[2]=C;
+          if(K&0x1000) P[3]=C;
+          if(K&0x0800) P[4]=C;
+          if(K&0x0400) P[5]=C;
+          if(K&0x0200) P[6]=C;
+          if(K&0x0100) P[7]=C;
+        }
 
-          /* Draw right 8 uint16_ts of the sprite */
-          if(K&0x00FF)
-          {
-            if(K&0x0080) P[8]=C;
-            if(K&0x0040) P[9]=C;
-            if(K&0x0020) P[10]=C;
-            if(K&0x0010) P[11]=C;
-            if(K&0x0008) P[12]=C;
-            if(K&0x0004) P[13]=C;
-            if(K&0x0002) P[14]=C;
-            if(K&0x0001) P[15]=C;
-          }
+        /* Draw right 8 pixels of the sprite */
+        if(K&0x00FF)
+        {
+          if(K&0x0080) P[8]=C;
+          if(K&0x0040) P[9]=C;
+          if(K&0x0020) P[10]=C;
+          if(K&0x0010) P[11]=C;
+          if(K&0x0008) P[12]=C;
+          if(K&0x0004) P[13]=C;
+          if(K&0x0002) P[14]=C;
+          if(K&0x0001) P[15]=C;
         }
       }
     }
+  }
 }
 
 /** ColorSprites() *******************************************/
@@ -317,13 +655,9 @@ void Sprites(uint8_t Y,uint16_t *Line)
 void ColorSprites(uint8_t Y,uint8_t *ZBuf)
 {
   static const uint8_t SprHeights[4] = { 8,16,16,32 };
-  uint8_t C,IH,OH,J,OrThem;
-  uint8_t *P,*PT,*AT;
-  int L,K;
-  unsigned int M;
-
-  /* No extra sprites yet */
-  VDPStatus[0]&=~0x5F;
+  uint8_t C,IH,OH,J,N,OrThem;
+  uint8_t *P,*PT,*AT,*S;
+  int K;
 
   /* Clear ZBuffer and exit if sprites are off */
   memset(ZBuf+32,0,256);
@@ -333,161 +667,136 @@ void ColorSprites(uint8_t Y,uint8_t *ZBuf)
   OrThem = 0x00;
   OH = SprHeights[VDP[1]&0x03];
   IH = SprHeights[VDP[1]&0x02];
-  AT = SprTab-4;
-  C  = MAXSPRITE2+1;
-  M  = 0;
 
-  /* Count displayed sprites */
-  for(L=0;L<32;++L)
-  {
-    M<<=1;AT+=4;              /* Iterating through SprTab      */
-    K=AT[0];                  /* Read Y from SprTab            */
-    if(K==216) break;         /* Iteration terminates if Y=216 */
-    K=(uint8_t)(K-VScroll);      /* Sprite's actual Y coordinate  */
-    if(K>256-IH) K-=256;       /* Y coordinate may be negative  */
-
-    /* Mark all valid sprites with 1s, break at MAXSPRITE2 sprites */
-    if((Y>K)&&(Y<=K+OH))
-    {
-      /* If we exceed the maximum number of sprites per line... */
-      if(!--C)
-      {
-        /* Set 9thSprite flag in the VDP status register */
-        VDPStatus[0]|=0x40;
-        /* Stop drawing sprites, unless all-sprites option enabled */
-        if(!OPTION(MSX_ALLSPRITE)) break;
-      }
+  /* Sprites crossing this line, stop at MAXSPRITE2 unless */
+  /* all-sprites option enabled. SpriteStatus() has set    */
+  /* the 9thSprite flag already                            */
+  S = SprList[Y];
+  N = SprCount[Y];
+  if((N>MAXSPRITE2)&&!OPTION(MSX_ALLSPRITE)) N=MAXSPRITE2;
 
-      /* Mark sprite as ready to draw */
-      M|=1;
-    }
-  }
+  /* Draw sprites crossing this line, last to first */
+  while(N)
+  {
+    AT=SprTab+((int)S[--N]<<2);
+    K=(uint8_t)(AT[0]-VScroll); /* K = sprite Y coordinate */
+    if(K>256-IH) K-=256;        /* Y coordinate may be negative */
 
-  /* Mark last checked sprite (9th in line, Y=216, or sprite #31) */
-  VDPStatus[0]|=L<32? L:31;
+    J=Y-K-1;
+    J = OH>IH? (J>>1):J;
+    C=SprTab[-0x0200+((AT-SprTab)<<2)+J];
+    OrThem|=C&0x40;
 
-  /* Draw all marked sprites */
-  for(;M;M>>=1,AT-=4)
-    if(M&1)
+    if(C&0x0F)
     {
-      K=(uint8_t)(AT[0]-VScroll); /* K = sprite Y coordinate */
-      if(K>256-IH) K-=256;        /* Y coordinate may be negative */
-
-      J=Y-K-1;
-      J = OH>IH? (J>>1):J;
-      C=SprTab[-0x0200+((AT-SprTab)<<2)+J];
-      OrThem|=C&0x40;
+      PT = SprGen+((int)(IH>8? AT[2]&0xFC:AT[2])<<3)+J;
+      P=ZBuf+AT[1]+(C&0x80? 0:32);
+      C&=0x0F;
+      J=PT[0];
 
-      if(C&0x0F)
+      if(OrThem&0x20)
       {
-        PT = SprGen+((int)(IH>8? AT[2]&0xFC:AT[2])<<3)+J;
-        P=ZBuf+AT[1]+(C&0x80? 0:32);
-        C&=0x0F;
-        J=PT[0];
-
-        if(OrThem&0x20)
+        if(OH>IH)
         {
-          if(OH>IH)
+          if(J&0x80) { P[0]|=C;P[1]|=C; }
+          if(J&0x40) { P[2]|=C;P[3]|=C; }
+          if(J&0x20) { P[4]|=C;P[5]|=C; }
+          if(J&0x10) { P[6]|=C;P[7]|=C; }
+          if(J&0x08) { P[8]|=C;P[9]|=C; }
+          if(J&0x04) { P[10]|=C;P[11]|=C; }
+          if(J&0x02) { P[12]|=C;P[13]|=C; }
+          if(J&0x01) { P[14]|=C;P[15]|=C; }
+          if(IH>8)
           {
-            if(J&0x80) { P[0]|=C;P[1]|=C; }
-            if(J&0x40) { P[2]|=C;P[3]|=C; }
-            if(J&0x20) { P[4]|=C;P[5]|=C; }
-            if(J&0x10) { P[6]|=C;P[7]|=C; }
-            if(J&0x08) { P[8]|=C;P[9]|=C; }
-            if(J&0x04) { P[10]|=C;P[11]|=C; }
-            if(J&0x02) { P[12]|=C;P[13]|=C; }
-            if(J&0x01) { P[14]|=C;P[15]|=C; }
-            if(IH>8)
-            {
-              J=PT[16];
-              if(J&0x80) { P[16]|=C;P[17]|=C; }
-              if(J&0x40) { P[18]|=C;P[19]|=C; }
-              if(J&0x20) { P[20]|=C;P[21]|=C; }
-              if(J&0x10) { P[22]|=C;P[23]|=C; }
-              if(J&0x08) { P[24]|=C;P[25]|=C; }
-              if(J&0x04) { P[26]|=C;P[27]|=C; }
-              if(J&0x02) { P[28]|=C;P[29]|=C; }
-              if(J&0x01) { P[30]|=C;P[31]|=C; }
-            }
+            J=PT[16];
+            if(J&0x80) { P[16]|=C;P[17]|=C; }
+            if(J&0x40) { P[18]|=C;P[19]|=C; }
+            if(J&0x20) { P[20]|=C;P[21]|=C; }
+            if(J&0x10) { P[22]|=C;P[23]|=C; }
+            if(J&0x08) { P[24]|=C;P[25]|=C; }
+            if(J&0x04) { P[26]|=C;P[27]|=C; }
+            if(J&0x02) { P[28]|=C;P[29]|=C; }
+            if(J&0x01) { P[30]|=C;P[31]|=C; }
           }
-          else
+        }
+        else
+        {
+          if(J&0x80) P[0]|=C;
+          if(J&0x40) P[1]|=C;
+          if(J&0x20) P[2]|=C;
+          if(J&0x10) P[3]|=C;
+          if(J&0x08) P[4]|=C;
+          if(J&0x04) P[5]|=C;
+          if(J&0x02) P[6]|=C;
+          if(J&0x01) P[7]|=C;
+          if(IH>8)
           {
-            if(J&0x80) P[0]|=C;
-            if(J&0x40) P[1]|=C;
-            if(J&0x20) P[2]|=C;
-            if(J&0x10) P[3]|=C;
-            if(J&0x08) P[4]|=C;
-            if(J&0x04) P[5]|=C;
-            if(J&0x02) P[6]|=C;
-            if(J&0x01) P[7]|=C;
-            if(IH>8)
-            {
-              J=PT[16];
-              if(J&0x80) P[8]|=C;
-              if(J&0x40) P[9]|=C;
-              if(J&0x20) P[10]|=C;
-              if(J&0x10) P[11]|=C;
-              if(J&0x08) P[12]|=C;
-              if(J&0x04) P[13]|=C;
-              if(J&0x02) P[14]|=C;
-              if(J&0x01) P[15]|=C;
-            }
+            J=PT[16];
+            if(J&0x80) P[8]|=C;
+            if(J&0x40) P[9]|=C;
+            if(J&0x20) P[10]|=C;
+            if(J&0x10) P[11]|=C;
+            if(J&0x08) P[12]|=C;
+            if(J&0x04) P[13]|=C;
+            if(J&0x02) P[14]|=C;
+            if(J&0x01) P[15]|=C;
           }
         }
-        else
+      }
+      else
+      {
+        if(OH>IH)
         {
-          if(OH>IH)
+          if(J&0x80) P[0]=P[1]=C;
+          if(J&0x40) P[2]=P[3]=C;
+          if(J&0x20) P[4]=P[5]=C;
+          if(J&0x10) P[6]=P[7]=C;
+          if(J&0x08) P[8]=P[9]=C;
+          if(J&0x04) P[10]=P[11]=C;
+          if(J&0x02) P[12]=P[13]=C;
+          if(J&0x01) P[14]=P[15]=C;
+          if(IH>8)
           {
-            if(J&0x80) P[0]=P[1]=C;
-            if(J&0x40) P[2]=P[3]=C;
-            if(J&0x20) P[4]=P[5]=C;
-            if(J&0x10) P[6]=P[7]=C;
-            if(J&0x08) P[8]=P[9]=C;
-            if(J&0x04) P[10]=P[11]=C;
-            if(J&0x02) P[12]=P[13]=C;
-            if(J&0x01) P[14]=P[15]=C;
-            if(IH>8)
-            {
-              J=PT[16];
-              if(J&0x80) P[16]=P[17]=C;
-              if(J&0x40) P[18]=P[19]=C;
-              if(J&0x20) P[20]=P[21]=C;
-              if(J&0x10) P[22]=P[23]=C;
-              if(J&0x08) P[24]=P[25]=C;
-              if(J&0x04) P[26]=P[27]=C;
-              if(J&0x02) P[28]=P[29]=C;
-              if(J&0x01) P[30]=P[31]=C;
-            }
+            J=PT[16];
+            if(J&0x80) P[16]=P[17]=C;
+            if(J&0x40) P[18]=P[19]=C;
+            if(J&0x20) P[20]=P[21]=C;
+            if(J&0x10) P[22]=P[23]=C;
+            if(J&0x08) P[24]=P[25]=C;
+            if(J&0x04) P[26]=P[27]=C;
+            if(J&0x02) P[28]=P[29]=C;
+            if(J&0x01) P[30]=P[31]=C;
           }
-          else
+        }
+        else
+        {
+          if(J&0x80) P[0]=C;
+          if(J&0x40) P[1]=C;
+          if(J&0x20) P[2]=C;
+          if(J&0x10) P[3]=C;
+          if(J&0x08) P[4]=C;
+          if(J&0x04) P[5]=C;
+          if(J&0x02) P[6]=C;
+          if(J&0x01) P[7]=C;
+          if(IH>8)
           {
-            if(J&0x80) P[0]=C;
-            if(J&0x40) P[1]=C;
-            if(J&0x20) P[2]=C;
-            if(J&0x10) P[3]=C;
-            if(J&0x08) P[4]=C;
-            if(J&0x04) P[5]=C;
-            if(J&0x02) P[6]=C;
-            if(J&0x01) P[7]=C;
-            if(IH>8)
-            {
-              J=PT[16];
-              if(J&0x80) P[8]=C;
-              if(J&0x40) P[9]=C;
-              if(J&0x20) P[10]=C;
-              if(J&0x10) P[11]=C;
-              if(J&0x08) P[12]=C;
-              if(J&0x04) P[13]=C;
-              if(J&0x02) P[14]=C;
-              if(J&0x01) P[15]=C;
-            }
+            J=PT[16];
+            if(J&0x80) P[8]=C;
+            if(J&0x40) P[9]=C;
+            if(J&0x20) P[10]=C;
+            if(J&0x10) P[11]=C;
+            if(J&0x08) P[12]=C;
+            if(J&0x04) P[13]=C;
+            if(J&0x02) P[14]=C;
+            if(J&0x01) P[15]=C;
           }
         }
       }
-
-      /* Update overlapping flag */
-      OrThem>>=1;
     }
+
+    /* Update overlapping flag */
+    OrThem>>=1;
+  }
 }
 
 /** RefreshLineF() *******************************************/
@@ -495,7 +804,7 @@ void ColorSprites(uint8_t Y,uint8_t *ZBuf)
 /*************************************************************/
 void RefreshLineF(uint8_t Y)
 {
-  uint16_t *P=RefreshBorder(Y,XPal[BGColor]);
+  pixel *P=RefreshBorder(Y,XPal[BGColor]);
   if(P) ClearLine(P,XPal[BGColor]);
 }
 
@@ -504,10 +813,10 @@ void RefreshLineF(uint8_t Y)
 /*************************************************************/
 void RefreshLine0(uint8_t Y)
 {
-  uint16_t FC;
+  pixel FC;
   uint8_t X,*T,*G;
-  uint16_t BC=XPal[BGColor];
-  uint16_t *P=RefreshBorder(Y,BC);
+  pixel BC=XPal[BGColor];
+  pixel *P=RefreshBorder(Y,BC);
   if(!P) return;
 
   if(!ScreenON) ClearLine(P,BC);
@@ -521,13 +830,9 @@ void RefreshLine0(uint8_t Y)
     FC=XPal[FGColor];
     P+=9;
 
-    for(X=0;X<40;X++,T++,P+=6)
-    {
-      Y=G[(int)*T<<3];
-      P[0]=Y&0x80? FC:BC;P[1]=Y&0x40? FC:BC;
-      P[2]=Y&0x20? FC:BC;P[3]=Y&0x10? FC:BC;
-      P[4]=Y&0x08? FC:BC;P[5]=Y&0x04? FC:BC;
-    }
+    /* ExpandByte() spills 2 pixels into the next character */
+    /* and then into the right border, which is drawn last   */
+    for(X=0;X<40;X++,T++,P+=6) ExpandByte(P,G[(int)*T<<3],FC,BC);
 
     P[0]=P[1]=P[2]=P[3]=P[4]=P[5]=P[6]=BC;
   }
@@ -539,9 +844,9 @@ void RefreshLine0(uint8_t Y)
 /*************************************************************/
 void RefreshLine1(uint8_t Y)
 {
-  uint16_t FC,BC;
+  pixel FC,BC;
   uint8_t K,X,*T,*G;
-  uint16_t *P=RefreshBorder(Y,XPal[BGColor]);
+  pixel *P=RefreshBorder(Y,XPal[BGColor]);
   if(!P)
      return;
 
@@ -559,11 +864,7 @@ void RefreshLine1(uint8_t Y)
       K=ColTab[*T>>3];
       FC=XPal[K>>4];
       BC=XPal[K&0x0F];
-      K=G[(int)*T<<3];
-      P[0]=K&0x80? FC:BC;P[1]=K&0x40? FC:BC;
-      P[2]=K&0x20? FC:BC;P[3]=K&0x10? FC:BC;
-      P[4]=K&0x08? FC:BC;P[5]=K&0x04? FC:BC;
-      P[6]=K&0x02? FC:BC;P[7]=K&0x01? FC:BC;
+      ExpandByte(P,G[(int)*T<<3],FC,BC);
     }
 
     if(!SpritesOFF) Sprites(Y,P-256);
@@ -576,10 +877,10 @@ void RefreshLine1(uint8_t Y)
 /*************************************************************/
 void RefreshLine2(uint8_t Y)
 {
-  uint16_t FC,BC;
+  pixel FC,BC;
   uint8_t K,X,*T;
   int I,J;
-  uint16_t *P=RefreshBorder(Y,XPal[BGColor]);
+  pixel *P=RefreshBorder(Y,XPal[BGColor]);
   if(!P) return;
 
   if(!ScreenON) ClearLine(P,XPal[BGColor]);
@@ -596,11 +897,7 @@ void RefreshLine2(uint8_t Y)
       K=ColTab[(I+J)&ColTabM];
       FC=XPal[K>>4];
       BC=XPal[K&0x0F];
-      K=ChrGen[(I+J)&ChrGenM];
-      P[0]=K&0x80? FC:BC;P[1]=K&0x40? FC:BC;
-      P[2]=K&0x20? FC:BC;P[3]=K&0x10? FC:BC;
-      P[4]=K&0x08? FC:BC;P[5]=K&0x04? FC:BC;
-      P[6]=K&0x02? FC:BC;P[7]=K&0x01? FC:BC;
+      ExpandByte(P,ChrGen[(I+J)&ChrGenM],FC,BC);
     }
 
     if(!SpritesOFF) Sprites(Y,P-256);
@@ -614,7 +911,7 @@ void RefreshLine2(uint8_t Y)
 void RefreshLine3(uint8_t Y)
 {
   uint8_t X,K,*T,*G;
-  uint16_t *P=RefreshBorder(Y,XPal[BGColor]);
+  pixel *P=RefreshBorder(Y,XPal[BGColor]);
   if(!P) return;
 
   if(!ScreenON) ClearLine(P,XPal[BGColor]);
@@ -642,11 +939,12 @@ void RefreshLine3(uint8_t Y)
 /*************************************************************/
 void RefreshLine4(uint8_t Y)
 {
-  uint16_t FC,BC;
+  pixel FC,BC;
   uint8_t K,X,C,*T,*R;
   int I,J;
+  uint64_t Z;
   uint8_t ZBuf[320];
-  uint16_t *P=RefreshBorder(Y,XPal[BGColor]);
+  pixel *P=RefreshBorder(Y,XPal[BGColor]);
   if(!P) return;
 
   if(!ScreenON) ClearLine(P,XPal[BGColor]);
@@ -665,16 +963,13 @@ void RefreshLine4(uint8_t Y)
       K=ColTab[(I+J)&ColTabM];
       FC=XPal[K>>4];
       BC=XPal[K&0x0F];
-      K=ChrGen[(I+J)&ChrGenM];
-
-      C=R[0];P[0]=C? XPal[C]:(K&0x80)? FC:BC;
-      C=R[1];P[1]=C? XPal[C]:(K&0x40)? FC:BC;
-      C=R[2];P[2]=C? XPal[C]:(K&0x20)? FC:BC;
-      C=R[3];P[3]=C? XPal[C]:(K&0x10)? FC:BC;
-      C=R[4];P[4]=C? XPal[C]:(K&0x08)? FC:BC;
-      C=R[5];P[5]=C? XPal[C]:(K&0x04)? FC:BC;
-      C=R[6];P[6]=C? XPal[C]:(K&0x02)? FC:BC;
-      C=R[7];P[7]=C? XPal[C]:(K&0x01)? FC:BC;
+      ExpandByte(P,ChrGen[(I+J)&ChrGenM],FC,BC);
+
+      /* Sprites are sparse, only patch pixels they cover */
+      memcpy(&Z,R,8);
+      if(Z)
+        for(C=0;C<8;C++)
+          if(R[C]) P[C]=XPal[R[C]];
     }
   }
 }
@@ -685,9 +980,9 @@ void RefreshLine4(uint8_t Y)
 /*************************************************************/
 void RefreshLine5(uint8_t Y)
 {
-  uint8_t I,X,*T,*R;
+  uint8_t *T,*R;
   uint8_t ZBuf[320];
-  uint16_t *P=RefreshBorder(Y,XPal[BGColor]);
+  pixel *P=RefreshBorder(Y,XPal[BGColor]);
   if(!P) return;
 
   if(!ScreenON) ClearLine(P,XPal[BGColor]);
@@ -699,25 +994,7 @@ void RefreshLine5(uint8_t Y)
     T=ChrTab+(((int)(Y+VScroll)<<7)&ChrTabM&0x7FFF);
     if (FlipEvenOdd && OddPage && VRAM<=T-0x8000) T-=0x8000;
 
-    for(X=0;X<16;X++,R+=16,P+=16,T+=8)
-    {
-      I=R[0];P[0]=XPal[I? I:T[0]>>4];
-      I=R[1];P[1]=XPal[I? I:T[0]&0x0F];
-      I=R[2];P[2]=XPal[I? I:T[1]>>4];
-      I=R[3];P[3]=XPal[I? I:T[1]&0x0F];
-      I=R[4];P[4]=XPal[I? I:T[2]>>4];
-      I=R[5];P[5]=XPal[I? I:T[2]&0x0F];
-      I=R[6];P[6]=XPal[I? I:T[3]>>4];
-      I=R[7];P[7]=XPal[I? I:T[3]&0x0F];
-      I=R[8];P[8]=XPal[I? I:T[4]>>4];
-      I=R[9];P[9]=XPal[I? I:T[4]&0x0F];
-      I=R[10];P[10]=XPal[I? I:T[5]>>4];
-      I=R[11];P[11]=XPal[I? I:T[5]&0x0F];
-      I=R[12];P[12]=XPal[I? I:T[6]>>4];
-      I=R[13];P[13]=XPal[I? I:T[6]&0x0F];
-      I=R[14];P[14]=XPal[I? I:T[7]>>4];
-      I=R[15];P[15]=XPal[I? I:T[7]&0x0F];
-    }
+    NibbleRun(P,T,R,0,16);
   }
 }
 
@@ -733,8 +1010,9 @@ void RefreshLine8(uint8_t Y)
     0x49,0x4B,0x59,0x5B,0xC9,0xCB,0xD9,0xDB
   };
   uint8_t C,X,*T,*R;
+  uint64_t Z;
   uint8_t ZBuf[320];
-  uint16_t *P=RefreshBorder(Y,BPal[VDP[7]]);
+  pixel *P=RefreshBorder(Y,BPal[VDP[7]]);
   if(!P) return;
 
   if(!ScreenON) ClearLine(P,BPal[VDP[7]]);
@@ -748,6 +1026,14 @@ void RefreshLine8(uint8_t Y)
 
     for(X=0;X<32;X++,T+=8,R+=8,P+=8)
     {
+      /* Sprites are sparse, skip their checks when none are here */
+      memcpy(&Z,R,8);
+      if(!Z)
+      {
+        P[0]=BPal[T[0]];P[1]=BPal[T[1]];P[2]=BPal[T[2]];P[3]=BPal[T[3]];
+        P[4]=BPal[T[4]];P[5]=BPal[T[5]];P[6]=BPal[T[6]];P[7]=BPal[T[7]];
+        continue;
+      }
       C=R[0];P[0]=BPal[C? SprToScr[C]:T[0]];
       C=R[1];P[1]=BPal[C? SprToScr[C]:T[1]];
       C=R[2];P[2]=BPal[C? SprToScr[C]:T[2]];
@@ -767,9 +1053,9 @@ void RefreshLine8(uint8_t Y)
 void RefreshLine10(uint8_t Y)
 {
   uint8_t C,X,*T,*R;
-  int J,K;
+  const pixel *Tab,*JK;
   uint8_t ZBuf[320];
-  uint16_t *P=RefreshBorder(Y,BPal[VDP[7]]);
+  pixel *P=RefreshBorder(Y,BPal[VDP[7]]);
   if(!P) return;
 
   if(!ScreenON) ClearLine(P,BPal[VDP[7]]);
@@ -781,7 +1067,9 @@ void RefreshLine10(uint8_t Y)
     T=ChrTab+(((int)(Y+VScroll)<<8)&ChrTabM&0xFFFF);
     if (FlipEvenOdd && OddPage && VRAM<=T-0x10000) T-=0x10000;
 
-    /* Draw first 4 uint16_ts */
+    Tab=YJKTable();
+
+    /* Draw first 4 pixels */
     C=R[0];P[0]=C? XPal[C]:BPal[VDP[7]];
     C=R[1];P[1]=C? XPal[C]:BPal[VDP[7]];
     C=R[2];P[2]=C? XPal[C]:BPal[VDP[7]];
@@ -790,15 +1078,14 @@ void RefreshLine10(uint8_t Y)
 
     for(X=0;X<63;X++,T+=4,R+=4,P+=4)
     {
-      K=(T[0]&0x07)|((T[1]&0x07)<<3);
-      if(K&0x20) K-=64;
-      J=(T[2]&0x07)|((T[3]&0x07)<<3);
-      if(J&0x20) J-=64;
-
-      C=R[0];Y=T[0]>>3;P[0]=C? XPal[C]:Y&1? XPal[Y>>1]:YJKColor(Y,J,K);
-      C=R[1];Y=T[1]>>3;P[1]=C? XPal[C]:Y&1? XPal[Y>>1]:YJKColor(Y,J,K);
-      C=R[2];Y=T[2]>>3;P[2]=C? XPal[C]:Y&1? XPal[Y>>1]:YJKColor(Y,J,K);
-      C=R[3];Y=T[3]>>3;P[3]=C? XPal[C]:Y&1? XPal[Y>>1]:YJKColor(Y,J,K);
+      JK=Tab
+        + ((T[0]&0x07)|((T[1]&0x07)<<3))
+        + ((T[2]&0x07)<<6)+((T[3]&0x07)<<9);
+
+      C=R[0];Y=T[0]>>3;P[0]=C? XPal[C]:Y&1? XPal[Y>>1]:JK[(int)Y<<12];
+      C=R[1];Y=T[1]>>3;P[1]=C? XPal[C]:Y&1? XPal[Y>>1]:JK[(int)Y<<12];
+      C=R[2];Y=T[2]>>3;P[2]=C? XPal[C]:Y&1? XPal[Y>>1]:JK[(int)Y<<12];
+      C=R[3];Y=T[3]>>3;P[3]=C? XPal[C]:Y&1? XPal[Y>>1]:JK[(int)Y<<12];
     }
   }
 }
@@ -810,9 +1097,9 @@ void RefreshLine10(uint8_t Y)
 void RefreshLine12(uint8_t Y)
 {
   uint8_t C,X,*T,*R;
-  int J,K;
+  const pixel *Tab,*JK;
   uint8_t ZBuf[320];
-  uint16_t *P=RefreshBorder(Y,BPal[VDP[7]]);
+  pixel *P=RefreshBorder(Y,BPal[VDP[7]]);
   if(!P) return;
 
   if(!ScreenON) ClearLine(P,BPal[VDP[7]]);
@@ -827,7 +1114,9 @@ void RefreshLine12(uint8_t Y)
       + (HScroll&0xFC);
     if (FlipEvenOdd && OddPage && VRAM<=T-0x10000) T-=0x10000;
 
-    /* Draw first 4 uint16_ts */
+    Tab=YJKTable();
+
+    /* Draw first 4 pixels */
     C=R[0];P[0]=C? XPal[C]:BPal[VDP[7]];
     C=R[1];P[1]=C? XPal[C]:BPal[VDP[7]];
     C=R[2];P[2]=C? XPal[C]:BPal[VDP[7]];
@@ -836,15 +1125,14 @@ void RefreshLine12(uint8_t Y)
 
     for(X=1;X<64;X++,T+=4,R+=4,P+=4)
     {
-      K=(T[0]&0x07)|((T[1]&0x07)<<3);
-      if(K&0x20) K-=64;
-      J=(T[2]&0x07)|((T[3]&0x07)<<3);
-      if(J&0x20) J-=64;
-
-      C=R[0];P[0]=C? XPal[C]:YJKColor(T[0]>>3,J,K);
-      C=R[1];P[1]=C? XPal[C]:YJKColor(T[1]>>3,J,K);
-      C=R[2];P[2]=C? XPal[C]:YJKColor(T[2]>>3,J,K);
-      C=R[3];P[3]=C? XPal[C]:YJKColor(T[3]>>3,J,K);
+      JK=Tab
+        + ((T[0]&0x07)|((T[1]&0x07)<<3))
+        + ((T[2]&0x07)<<6)+((T[3]&0x07)<<9);
+
+      C=R[0];P[0]=C? XPal[C]:JK[(int)(T[0]>>3)<<12];
+      C=R[1];P[1]=C? XPal[C]:JK[(int)(T[1]>>3)<<12];
+      C=R[2];P[2]=C? XPal[C]:JK[(int)(T[2]>>3)<<12];
+      C=R[3];P[3]=C? XPal[C]:JK[(int)(T[3]>>3)<<12];
     }
   }
 }
@@ -859,7 +1147,7 @@ void RefreshLine6(uint8_t Y)
 {
   uint8_t X,*T,*R,C;
   uint8_t ZBuf[320];
-  uint16_t *P=RefreshBorder(Y,XPal[BGColor&0x03]);
+  pixel *P=RefreshBorder(Y,XPal[BGColor&0x03]);
   if(!P) return;
 
   if(!ScreenON) ClearLine(P,XPal[BGColor&0x03]);
@@ -894,7 +1182,7 @@ void RefreshLine7(uint8_t Y)
 {
   uint8_t C,X,*T,*R;
   uint8_t ZBuf[320];
-  uint16_t *P=RefreshBorder(Y,XPal[BGColor]);
+  pixel *P=RefreshBorder(Y,XPal[BGColor]);
   if(!P) return;
 
   if(!ScreenON) ClearLine(P,XPal[BGColor]);
@@ -926,10 +1214,10 @@ void RefreshLine7(uint8_t Y)
 /*************************************************************/
 void RefreshLineTx80(uint8_t Y)
 {
-  uint16_t FC;
+  pixel FC;
   uint8_t X,M,*T,*C,*G;
-  uint16_t BC=XPal[BGColor];
-  uint16_t *P=RefreshBorder(Y,BC);
+  pixel BC=XPal[BGColor];
+  pixel *P=RefreshBorder(Y,BC);
   if(!P) return;
 
   if(!ScreenON) ClearLine(P,BC);
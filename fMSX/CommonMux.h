@@ -14,12 +14,15 @@
 #ifndef COMMONMUX_H
 #define COMMONMUX_H
 
-#include "Common.h"
-#include "Wide.h"
-
 /** Screen Mode Handlers [number of screens + 1] *************/
 extern void (*RefreshLine[MAXSCREEN+2])(uint8_t Y);
 
+#define BPP16
+#define pixel            uint16_t
+#define PIXEL            PIXEL16
+#define XPal             XPal_16
+#define XPal0            XPal0_16
+#define BPal             BPal_16
 #define FirstLine        FirstLine_16
 #define Sprites          Sprites_16
 #define ColorSprites     ColorSprites_16
@@ -27,8 +30,23 @@ extern void (*RefreshLine[MAXSCREEN+2])(uint8_t Y);
 #define RefreshBorder512 RefreshBorder512_16
 #define ClearLine        ClearLine_16
 #define ClearLine512     ClearLine512_16
+#define FillLine         FillLine_16
+#define ExpandByte       ExpandByte_16
 #define YJKColor         YJKColor_16
-#define RefreshScreen    RefreshScreen_16
+#define YJKTab           YJKTab_16
+#define YJKFormat        YJKFormat_16
+#define YJKReady         YJKReady_16
+#define YJKTable         YJKTable_16
+#define PalTab           PalTab_16
+#define LoadPal          LoadPal_16
+#define PalStore         PalStore_16
+#define PalSprites       PalSprites_16
+#define PalNibbles       PalNibbles_16
+#define PalCrumbs        PalCrumbs_16
+#define PalNibbleRun     PalNibbleRun_16
+#define PalCrumbRun      PalCrumbRun_16
+#define NibbleRun        NibbleRun_16
+#define CrumbRun         CrumbRun_16
 #define RefreshLineF     RefreshLineF_16
 #define RefreshLine0     RefreshLine0_16
 #define RefreshLine1     RefreshLine1_16
@@ -42,5 +60,189 @@ extern void (*RefreshLine[MAXSCREEN+2])(uint8_t Y);
 #define RefreshLine10    RefreshLine10_16
 #define RefreshLine12    RefreshLine12_16
 #define RefreshLineTx80  RefreshLineTx80_16
+#include "Common.h"
+#include "Wide.h"
+#undef BPP16
+#undef pixel
+#undef PIXEL
+#undef XPal
+#undef XPal0
+#undef BPal
+#undef FirstLine
+#undef Sprites
+#undef ColorSprites
+#undef RefreshBorder
+#undef RefreshBorder512
+#undef ClearLine
+#undef ClearLine512
+#undef FillLine
+#undef ExpandByte
+#undef YJKColor
+#undef YJKTab
+#undef YJKFormat
+#undef YJKReady
+#undef YJKTable
+#undef PalTab
+#undef LoadPal
+#undef PalStore
+#undef PalSprites
+#undef PalNibbles
+#undef PalCrumbs
+#undef PalNibbleRun
+#undef PalCrumbRun
+#undef NibbleRun
+#undef CrumbRun
+#undef RefreshLineF
+#undef RefreshLine0
+#undef RefreshLine1
+#undef RefreshLine2
+#undef RefreshLine3
+#undef RefreshLine4
+#undef RefreshLine5
+#undef RefreshLine6
+#undef RefreshLine7
+#undef RefreshLine8
+#undef RefreshLine10
+#undef RefreshLine12
+#undef RefreshLineTx80
+
+#ifndef NO_BPP32
+#define BPP32
+#define pixel            uint32_t
+#define PIXEL            PIXEL32
+#define XPal             XPal_32
+#define XPal0            XPal0_32
+#define BPal             BPal_32
+#define FirstLine        FirstLine_32
+#define Sprites          Sprites_32
+#define ColorSprites     ColorSprites_32
+#define RefreshBorder    RefreshBorder_32
+#define RefreshBorder512 RefreshBorder512_32
+#define ClearLine        ClearLine_32
+#define ClearLine512     ClearLine512_32
+#define FillLine         FillLine_32
+#define ExpandByte       ExpandByte_32
+#define YJKColor         YJKColor_32
+#define YJKTab           YJKTab_32
+#define YJKFormat        YJKFormat_32
+#define YJKReady         YJKReady_32
+#define YJKTable         YJKTable_32
+#define PalTab           PalTab_32
+#define LoadPal          LoadPal_32
+#define PalStore         PalStore_32
+#define PalSprites       PalSprites_32
+#define PalNibbles       PalNibbles_32
+#define PalCrumbs        PalCrumbs_32
+#define PalNibbleRun     PalNibbleRun_32
+#define PalCrumbRun      PalCrumbRun_32
+#define NibbleRun        NibbleRun_32
+#define CrumbRun         CrumbRun_32
+#define RefreshLineF     RefreshLineF_32
+#define RefreshLine0     RefreshLine0_32
+#define RefreshLine1     RefreshLine1_32
+#define RefreshLine2     RefreshLine2_32
+#define RefreshLine3     RefreshLine3_32
+#define RefreshLine4     RefreshLine4_32
+#define RefreshLine5     RefreshLine5_32
+#define RefreshLine6     RefreshLine6_32
+#define RefreshLine7     RefreshLine7_32
+#define RefreshLine8     RefreshLine8_32
+#define RefreshLine10    RefreshLine10_32
+#define RefreshLine12    RefreshLine12_32
+#define RefreshLineTx80  RefreshLineTx80_32
+#include "Common.h"
+#include "Wide.h"
+#undef BPP32
+#undef pixel
+#undef PIXEL
+#undef XPal
+#undef XPal0
+#undef BPal
+#undef FirstLine
+#undef Sprites
+#undef ColorSprites
+#undef RefreshBorder
+#undef RefreshBorder512
+#undef ClearLine
+#undef ClearLine512
+#undef FillLine
+#undef ExpandByte
+#undef YJKColor
+#undef YJKTab
+#undef YJKFormat
+#undef YJKReady
+#undef YJKTable
+#undef PalTab
+#undef LoadPal
+#undef PalStore
+#undef PalSprites
+#undef PalNibbles
+#undef PalCrumbs
+#undef PalNibbleRun
+#undef PalCrumbRun
+#undef NibbleRun
+#undef CrumbRun
+#undef RefreshLineF
+#undef RefreshLine0
+#undef RefreshLine1
+#undef RefreshLine2
+#undef RefreshLine3
+#undef RefreshLine4
+#undef RefreshLine5
+#undef RefreshLine6
+#undef RefreshLine7
+#undef RefreshLine8
+#undef RefreshLine10
+#undef RefreshLine12
+#undef RefreshLineTx80
+#endif /* !NO_BPP32 */
+
+/** SetScreenDepth() *****************************************/
+/** Fill fMSX screen driver array with pointers matching    **/
+/** the given image depth. Returns the depth in bits per    **/
+/** pixel, or 0 if this depth is not supported.             **/
+/*************************************************************/
+static int SetScreenDepth(int Depth)
+{
+  if(Depth==16)
+  {
+    RefreshLine[0]  = RefreshLine0_16;
+    RefreshLine[1]  = RefreshLine1_16;
+    RefreshLine[2]  = RefreshLine2_16;
+    RefreshLine[3]  = RefreshLine3_16;
+    RefreshLine[4]  = RefreshLine4_16;
+    RefreshLine[5]  = RefreshLine5_16;
+    RefreshLine[6]  = RefreshLine6_16;
+    RefreshLine[7]  = RefreshLine7_16;
+    RefreshLine[8]  = RefreshLine8_16;
+    RefreshLine[9]  = 0;
+    RefreshLine[10] = RefreshLine10_16;
+    RefreshLine[11] = RefreshLine10_16;
+    RefreshLine[12] = RefreshLine12_16;
+    RefreshLine[13] = RefreshLineTx80_16;
+    return(16);
+  }
+#ifndef NO_BPP32
+  if(Depth==32)
+  {
+    RefreshLine[0]  = RefreshLine0_32;
+    RefreshLine[1]  = RefreshLine1_32;
+    RefreshLine[2]  = RefreshLine2_32;
+    RefreshLine[3]  = RefreshLine3_32;
+    RefreshLine[4]  = RefreshLine4_32;
+    RefreshLine[5]  = RefreshLine5_32;
+    RefreshLine[6]  = RefreshLine6_32;
+    RefreshLine[7]  = RefreshLine7_32;
+    RefreshLine[8]  = RefreshLine8_32;
+    RefreshLine[9]  = 0;
+    RefreshLine[10] = RefreshLine10_32;
+    RefreshLine[11] = RefreshLine10_32;
+    RefreshLine[12] = RefreshLine12_32;
+    RefreshLine[13] = RefreshLineTx80_32;
+    return(32);
+  }
+#endif
+  return(0);
+}
 
 #endif /* COMMONMUX_H */
@@ -29,6 +29,10 @@
 #endif
 #include <time.h>
 
+#ifdef WORKER_THREADS
+#include <pthread.h>
+#endif
+
 #include <compat/strl.h>
 #include <streams/file_stream_transforms.h>
 
@@ -57,6 +61,7 @@ extern retro_log_printf_t log_cb;
 /** User-defined parameters for fMSX *************************/
 int  Mode        = MSX_MSX2|MSX_NTSC|MSX_MSXDOS2|MSX_GUESSA|MSX_GUESSB;
 uint8_t UPeriod  = 75;             /* % of frames to draw    */
+uint8_t SkipFrame = 0;             /* 1: Don't draw frames   */
 int  VPeriod     = CPU_VPERIOD;    /* CPU cycles per VBlank  */
 int  HPeriod     = CPU_HPERIOD;    /* CPU cycles per HBlank  */
 int  RAMPages    = 4;              /* Number of RAM pages    */
@@ -84,6 +89,8 @@ uint8_t ROMMask[MAXSLOTS];            /* ROM Mapper masks       */
 uint8_t ROMType[MAXSLOTS];            /* ROM Mapper types       */
 
 uint8_t EnWrite[4];                   /* 1 if write enabled     */
+uint8_t RdMap[256];                   /* 1: RdZ80() slow path   */
+uint8_t WrMap[256];                   /* 1: WrZ80() slow path   */
 uint8_t PSL[4],SSL[4];                /* Lists of current slots */
 uint8_t PSLReg,SSLReg[4];   /* Storage for A8h port and (FFFFh) */
 
@@ -146,6 +153,7 @@ FDIDisk FDD[NUM_FDI_DRIVES];       /* Floppy disk images     */
 AY8910 PSG;                        /* PSG registers & state  */
 YM2413 OPLL;                /* OPLL registers & state (fMSX) */
 YM2413_NukeYKT OPLL_NukeYKT;/*OPLL registers & state(NukeYKT)*/
+FastOPLL OPLL_Fast;         /* OPLL registers & state (tables)*/
 SCC  SCChip;                       /* SCC registers & state  */
 uint8_t SCCOn[2];                  /* !=0: SCC page active   */
 uint8_t SCCIMode[2];               /* SCC-I mode register    */
@@ -169,10 +177,41 @@ uint8_t ScrMode;                      /* Current screen mode    */
 uint8_t VDP[64],VDPStatus[16];        /* VDP registers          */
 uint8_t IRQPending;                   /* Pending interrupts     */
 int  ScanLine;                     /* Current scanline       */
+unsigned int VDPGen = 1;           /* Bumped on display change */
+uint8_t SprDirty = 1;                 /* 1: Rebuild SprList[]   */
+uint8_t SprEnd;                       /* Sprite# ending the SAT */
+uint8_t SprCount[256];                /* Sprites in each line   */
+uint8_t SprList[256][32];             /* Sprite#s in each line  */
+uint64_t SkippedLines;             /* Unchanged lines kept   */
+int  DrawnLines;                   /* Lines redrawn in frame */
+static unsigned int LineGen[256];  /* VDPGen each line had   */
+static int  LineLast[256];         /* LastScanline per line  */
 uint8_t VDPData;                      /* VDP data buffer        */
 uint8_t PLatch;                       /* Palette buffer         */
 uint8_t ALatch;                       /* Address buffer         */
 int  Palette[16];                  /* Current palette        */
+static uint8_t Drawing;               /* 1: Drawing the screen  */
+static uint8_t BFlag,BCount;          /* TEXT80 blinking state  */
+static int  UCount;                /* Screen refresh counter */
+static uint8_t ACount;                /* Autofire counter       */
+
+/** Timeline *************************************************/
+/** Hardware events, sorted by the CPU cycle they are due   **/
+/** at. Events due at the same cycle run in EVT_* order.    **/
+/*************************************************************/
+#define EVT_ENGINE   0                /* V9938 engine slice     */
+#define EVT_HREFRESH 1                /* Scanline starts        */
+#define EVT_HBLANK   2                /* HBlank starts          */
+#define EVT_PSG      3                /* AY8910 update          */
+#define EVT_OPLL     4                /* NukeYKT/Fast OPLL sync */
+#define EVT_COUNT    5
+
+static unsigned int EvtNow;           /* CPU cycles run so far  */
+static unsigned int EvtTime[EVT_COUNT]; /* When events are due  */
+static uint8_t EvtList[EVT_COUNT];    /* Pending events, sorted */
+static uint8_t EvtMask;               /* Pending events, bits   */
+static int  EvtCount;              /* Number of events       */
+static uint8_t EvtQuit;               /* 1: Return INT_QUIT     */
 
 /** Cheat entries ********************************************/
 int MCFCount     = 0;              /* Size of MCFEntries[]   */
@@ -196,23 +235,10 @@ static const uint8_t CartMap[4][4] =
 { { 255,3,4,5 },{ 0,0,0,0 },{ 1,1,1,1 },{ 2,255,255,255 } };
 
 /** Screen Mode Handlers [number of screens + 1] *************/
-void (*RefreshLine[MAXSCREEN+2])(uint8_t Y) =
-{
-  RefreshLine0,   /* SCR 0:  TEXT 40x24  */
-  RefreshLine1,   /* SCR 1:  TEXT 32x24  */
-  RefreshLine2,   /* SCR 2:  BLK 256x192 */
-  RefreshLine3,   /* SCR 3:  64x48x16    */
-  RefreshLine4,   /* SCR 4:  BLK 256x192 */
-  RefreshLine5,   /* SCR 5:  256x192x16  */
-  RefreshLine6,   /* SCR 6:  512x192x4   */
-  RefreshLine7,   /* SCR 7:  512x192x16  */
-  RefreshLine8,   /* SCR 8:  256x192x256 */
-  0,              /* SCR 9:  NONE        */
-  RefreshLine10,  /* SCR 10: YAE 256x192 */
-  RefreshLine10,  /* SCR 11: YAE 256x192 */
-  RefreshLine12,  /* SCR 12: YJK 256x192 */
-  RefreshLineTx80 /* SCR 0:  TEXT 80x24  */
-};
+/** Filled by SetScreenDepth() with drivers for the current **/
+/** image depth. SCREEN 9 has no driver.                    **/
+/*************************************************************/
+void (*RefreshLine[MAXSCREEN+2])(uint8_t Y);
 
 /** VDP Address Register Masks *******************************/
 static const struct { uint8_t R2,R3,R4,R5,M2,M3,M4,M5; } MSK[MAXSCREEN+2] =
@@ -328,16 +354,23 @@ void SetMegaROM(int Slot,uint8_t P0,uint8_t P1,uint8_t P2,uint8_t P3);
 void MapROM(uint16_t A,uint8_t V);       /* Switch MegaROM banks            */
 void PSlot(uint8_t V);               /* Switch primary slots            */
 void SSlot(uint8_t V);               /* Switch secondary slots          */
+void SetSCC(uint8_t I,uint8_t V);       /* Turn SCC register window on/off */
+void SetMemHandlers(void);        /* Rebuild RdMap[]/WrMap[] tables  */
 void VDPOut(uint8_t R,uint8_t V);       /* Write value into a VDP register */
 void Printer(uint8_t V);             /* Send a character to a printer   */
 void PPIOut(uint8_t New,uint8_t Old);   /* Set PPI bits (key click, etc.)  */
-int  CheckSprites(void);          /* Check for sprite collisions     */
+void SpriteStatus(uint8_t Y);        /* Set 5th sprite status bits      */
+void CheckSprites(uint8_t Y);        /* Check for sprite collisions     */
 uint8_t RTCIn(uint8_t R);               /* Read RTC registers              */
 uint8_t SetScreen(void);             /* Change screen mode              */
 uint16_t SetIRQ(uint8_t IRQ);            /* Set/Reset IRQ                   */
 uint16_t StateID(void);               /* Compute emulation state ID      */
 int  ApplyCheats(void);           /* Apply RAM-based cheats          */
 
+static void SetEvent(int ID,unsigned int Time); /* Schedule event */
+static void ClrEvent(int ID);     /* Cancel scheduled event          */
+static void ResetTimeline(int PSGTime,int OPLLTime); /* Rebuild it   */
+
 static int hasext(const char *FileName,const char *Ext);
 static uint8_t *GetMemory(int Size); /* Get memory chunk                */
 static void FreeMemory(const void *Ptr); /* Free memory chunk        */
@@ -463,7 +496,7 @@ int StartMSX(int NewMode,int NewRAMPages,int NewVRAMPages)
   WorkDir     = 0;
   SaveCMOS    = 0;
   FMPACKey    = 0x0000;
-  ExitNow     = 1; // libretro-fmsx: exit LoopZ80() always at scanline 192 to process a.o. controller inputs
+  ExitNow     = 1; // libretro-fmsx: exit LoopZ80() at the end of each frame to process a.o. controller inputs
   NChunks     = 0;
   CheatsON    = 0;
   CheatCount  = 0;
@@ -615,6 +648,10 @@ void TrashMSX(void)
   RFILE *F;
   int J;
 
+  /* Stop the render and OPLL threads, if any */
+  SetRenderThread(0);
+  NukeYKT_SetThread2413(&OPLL_NukeYKT,0);
+
   /* CMOS.ROM is saved in the program directory */
   if(ProgDir && chdir(ProgDir)) { }
 
@@ -891,6 +928,7 @@ int ResetMSX(int NewMode,int NewRAMPages,int NewVRAMPages)
   ResetSCC(&SCChip,FIRST_SCC_CHANNEL);
   Reset2413(&OPLL,FIRST_YM2413_CHANNEL);
   NukeYKT_Reset2413(&OPLL_NukeYKT);
+  ResetOPLL(&OPLL_Fast);
   Sync8910(&PSG,AY8910_SYNC);
   SyncSCC(&SCChip,SCC_SYNC);
   Sync2413(&OPLL,YM2413_SYNC);
@@ -928,6 +966,7 @@ int ResetMSX(int NewMode,int NewRAMPages,int NewVRAMPages)
   IRQPending=0x00;                      /* No IRQs pending  */
   SCCOn[0]=SCCOn[1]=0;                  /* SCCs off for now */
   SCCIMode[0]=SCCIMode[1]=0;            /* bankselect/SCC   */
+  SetMemHandlers();                     /* RdZ80()/WrZ80()  */
   RTCReg=RTCMode=0;                     /* Clock registers  */
   KanCount=0;KanLetter=0;               /* Kanji extension  */
   ChrTab=ColTab=ChrGen=VRAM;            /* VDP tables       */
@@ -939,6 +978,9 @@ int ResetMSX(int NewMode,int NewRAMPages,int NewVRAMPages)
   VKey=PKey=1;                          /* VDP keys         */
   VAddr=0x0000;                         /* VRAM access addr */
   ScanLine=0;                           /* Current scanline */
+  SyncRender();                         /* Finish drawing   */
+  VDPGen++;                             /* Redraw all lines */
+  SprDirty=1;                           /* Sprite lists     */
   VDPData=NORAM;                        /* VDP data buffer  */
   JoyState=0;                           /* Joystick state   */
 
@@ -947,6 +989,7 @@ int ResetMSX(int NewMode,int NewRAMPages,int NewVRAMPages)
 
   /* Reset CPU */
   ResetZ80(&CPU);
+  ResetTimeline(0,0);
 
   /* Done */
   return(Mode);
@@ -961,6 +1004,9 @@ uint8_t RdZ80(uint16_t A)
 {
   uint8_t J,PS,SS,I;
 
+  /* Plain memory blocks need no further checks */
+  if(!RdMap[A>>8]) return(RAM[A>>13][A&0x1FFF]);
+
   /* Secondary slot selector */
   if(A==0xFFFF /*&& ((PSL[3]==0 && !MODEL(MSX_MSX1)) || PSL[3]==3)*/) return(~SSLReg[PSL[3]]); // might be wrong - should only read back inverse when the primary slot is expanded. Commented code would fix that.
 
@@ -981,8 +1027,10 @@ uint8_t RdZ80(uint16_t A)
       case 0x7FF9: case 0xBFF9: case 0x7F81: case 0x7FB9: /* TRACK  */
       case 0x7FFA: case 0xBFFA: case 0x7F82: case 0x7FBA: /* SECTOR */
       case 0x7FFB: case 0xBFFB: case 0x7F83: case 0x7FBB: /* DATA   */
+        BusyZ80();
         return(Read1793(&FDC,A&0x0003));
       case 0x7FFF: case 0xBFFF: case 0x7F84: case 0x7FBC: /* SYSTEM */
+        BusyZ80();
         return(Read1793(&FDC,WD1793_READY));
     }
 
@@ -1003,6 +1051,21 @@ uint8_t RdZ80(uint16_t A)
 /*************************************************************/
 void WrZ80(uint16_t A,uint8_t V)
 {
+  /* Plain RAM blocks need no further checks */
+  if(!WrMap[A>>8])
+  {
+    if(RAM[A>>13][A&0x1FFF]!=V)
+    {
+      ChangeZ80(A,RAM[A>>13][A&0x1FFF]);
+      RAM[A>>13][A&0x1FFF]=V;
+      TouchZ80(A);
+    }
+    return;
+  }
+
+  /* Anything else may change hardware state */
+  BusyZ80();
+
   /* Secondary slot selector */
   if(A==0xFFFF) { SSlot(V);return; }
 
@@ -1036,12 +1099,34 @@ void WrZ80(uint16_t A,uint8_t V)
     }
 
   /* Write to RAM, if enabled */
-  if(EnWrite[A>>14]) { RAM[A>>13][A&0x1FFF]=V;return; }
+  if(EnWrite[A>>14]) { RAM[A>>13][A&0x1FFF]=V;TouchZ80(A);return; }
 
   /* Switch MegaROM pages */
   if((A>0x3FFF)&&(A<0xC000)) MapROM(A,V);
 }
 
+#ifdef Z80_THREADED
+/** CodeZ80() ************************************************/
+/** Z80 emulation calls this function to check if opcode at **/
+/** address A is plain memory that can be decoded once, as  **/
+/** opposed to a hardware register read with RdZ80().       **/
+/*************************************************************/
+uint8_t CodeZ80(uint16_t A)
+{
+  /* Any block with special read handling is not plain */
+  return(!RdMap[A>>8]);
+}
+#endif /* Z80_THREADED */
+
+/** PlainZ80() ***********************************************/
+/** Z80 emulation calls this function to find 256 bytes of  **/
+/** plain RAM at A&FF00h for block transfers.               **/
+/*************************************************************/
+uint8_t *PlainZ80(uint16_t A,uint8_t Write)
+{
+  return((Write? WrMap[A>>8]:RdMap[A>>8])? 0:RAM[A>>13]+(A&0x1F00));
+}
+
 /** InZ80() **************************************************/
 /** Z80 emulation calls this function to read a uint8_t from   **/
 /** a given I/O port.                                       **/
@@ -1056,7 +1141,9 @@ uint8_t InZ80(uint16_t Port)
   {
 
 case 0x90: return(0xFD);                   /* Printer READY signal */
-case 0xB5: return(RTCIn(RTCReg));          /* RTC registers        */
+case 0xB5: /* RTC registers */
+  BusyZ80();
+  return(RTCIn(RTCReg));
 
 case 0xA8: /* Primary slot state   */
 case 0xA9: /* Keyboard port        */
@@ -1072,6 +1159,7 @@ case 0xFF: /* Mapper page at C000h */
   return(RAMMapper[Port-0xFC]|~RAMMask);
 
 case 0xD9: /* Kanji support */
+  BusyZ80();
   Port=Kanji? Kanji[KanLetter+KanCount]:NORAM;
   KanCount=(KanCount+1)&0x1F;
   return(Port);
@@ -1088,6 +1176,7 @@ case 0x87:
   /*return(Rd8251(&SIO,Port&0x07));*/
 
 case 0x98: /* VRAM read port */
+  BusyZ80();
   /* Read from VRAM data buffer */
   Port=VDPData;
   /* Reset VAddr latch sequencer */
@@ -1113,9 +1202,10 @@ case 0x99: /* VDP status registers */
   /* Update status register's contents */
   switch(VDP[15])
   {
-    case 0: VDPStatus[0]&=0x5F;SetIRQ(~INT_IE0);break;
-    case 1: VDPStatus[1]&=0xFE;SetIRQ(~INT_IE1);break;
-    case 7: VDPStatus[7]=VDP[44]=VDPRead();break;
+    case 0: if(Port&0xA0) BusyZ80();VDPStatus[0]&=0x5F;SetIRQ(~INT_IE0);break;
+    case 1: if(Port&0x01) BusyZ80();VDPStatus[1]&=0xFE;SetIRQ(~INT_IE1);break;
+    case 5: VDPStatus[3]=VDPStatus[4]=VDPStatus[5]=VDPStatus[6]=0;break;
+    case 7: VDPStatus[7]=VDP[44]=VDPRead();BusyZ80();break;
   }
   /* Return the status register value */
   return(Port);
@@ -1182,6 +1272,7 @@ case 0xD2: /* FDC sector  */
 case 0xD3: /* FDC data    */
 case 0xD4: /* FDC IRQ/DRQ */
   /* Brazilian DiskROM I/O ports */
+  BusyZ80();
   return(Read1793(&FDC,Port-0xD0));
 
   }
@@ -1205,11 +1296,13 @@ case 0x7C:
   /* OPLL Register# */
   WrCtrl2413(&OPLL,Value);
   NukeYKT_WritePort2413(&OPLL_NukeYKT,NUKEYKT_REGISTER_PORT,Value);
+  WrCtrlOPLL(&OPLL_Fast,Value);
   return;
 case 0x7D:
   /* OPLL Data      */
   WrData2413(&OPLL,Value);
   NukeYKT_WritePort2413(&OPLL_NukeYKT,NUKEYKT_DATA_PORT,Value);
+  WrDataOPLL(&OPLL_Fast,Value);
   return;
 case 0x91: Printer(Value);return;                 /* Printer Data   */
 case 0xA0: WrCtrl8910(&PSG,Value);return;         /* PSG Register#  */
@@ -1239,6 +1332,14 @@ case 0x87:
 
 case 0x98: /* VDP Data */
   VKey=1;
+  if(VPAGE[VAddr]!=Value)
+  {
+    SyncRender();
+    VDPGen++;
+    /* Sprite Y coordinates decide which lines show sprites */
+    if((VPAGE+VAddr>=SprTab)&&(VPAGE+VAddr<SprTab+128)&&!((VPAGE+VAddr-SprTab)&3))
+      SprDirty=1;
+  }
   VDPData=VPAGE[VAddr]=Value;
   VAddr=(VAddr+1)&0x3FFF;
   /* If VAddr rolled over, modify VRAM page# */
@@ -1386,6 +1487,7 @@ case 0xFF: /* Mapper page at C000h */
       EnWrite[J] = 1;
       RAM[I]     = MemMap[3][2][I];
       RAM[I+1]   = MemMap[3][2][I+1];
+      SetMemHandlers();
     }
   }
   return;
@@ -1395,6 +1497,43 @@ case 0xFF: /* Mapper page at C000h */
   /* Unknown port */
 }
 
+/** OutsZ80() ************************************************/
+/** Z80 emulation calls this function to write N bytes with **/
+/** OTIR. Only VRAM data port writes go at once, up to the  **/
+/** next VAddr rollover.                                    **/
+/*************************************************************/
+int OutsZ80(uint16_t Port,const uint8_t *Data,int N)
+{
+  uint8_t *P;
+  int J;
+
+  if((Port&0xFF)!=0x98) return(0);
+
+  N = N<0x4000-VAddr? N:0x4000-VAddr;
+  P = VPAGE+VAddr;
+  if(memcmp(P,Data,N))
+  {
+    SyncRender();
+    VDPGen++;
+    /* Sprite Y coordinates decide which lines show sprites */
+    for(J=0;J<N;++J)
+      if((P+J>=SprTab)&&(P+J<SprTab+128)&&!((P+J-SprTab)&3)&&(P[J]!=Data[J]))
+        SprDirty=1;
+    memcpy(P,Data,N);
+  }
+
+  VKey    = 1;
+  VDPData = Data[N-1];
+  VAddr   = (VAddr+N)&0x3FFF;
+  /* If VAddr rolled over, modify VRAM page# */
+  if(!VAddr&&(ScrMode>3))
+  {
+    VDP[14]=(VDP[14]+1)&VRAMPageMask;
+    VPAGE=VRAM+((int)VDP[14]<<14);
+  }
+  return(N);
+}
+
 /** MapROM() *************************************************/
 /** Switch ROM Mapper pages. This function is supposed to   **/
 /** be called when ROM page registers are written to.       **/
@@ -1424,6 +1563,7 @@ void MapROM(uint16_t A,uint8_t V)
     if (SCCIMode[I] & 0x10)
     {
       RAM[A>>13][A&0x1FFF]=V;
+      TouchZ80(A);
       return;
     }
 	if ((A & 0x1800) == 0x1000) {
@@ -1432,10 +1572,10 @@ void MapROM(uint16_t A,uint8_t V)
       switch (J)
       {
         case 2:
-          SCCOn[I]=(V&0x3F)==0x3F; // SCC enable - write xx111111 to 9000-97FF
+          SetSCC(I,(V&0x3F)==0x3F); // SCC enable - write xx111111 to 9000-97FF
           break;
         case 3:
-          SCCOn[I]=(V&0x80); // SCC-I a.k.a. SCC+ enable - write 1xxxxxxx to B000-B7FF
+          SetSCC(I,V&0x80); // SCC-I a.k.a. SCC+ enable - write 1xxxxxxx to B000-B7FF
           break;
       }
       V&=0x0F; // bitmask for 16 pages
@@ -1460,7 +1600,7 @@ void MapROM(uint16_t A,uint8_t V)
       /* When no MegaROM present, we allow the program */
       /* to write into SCC wave buffer using EmptyRAM  */
       /* as a scratch pad.                             */
-      if(!ROMData[I]&&(J<0xA0)) EmptyRAM[0x1800+J]=V;
+      if(!ROMData[I]&&(J<0xA0)) { EmptyRAM[0x1800+J]=V;TouchZ80((A&0xE000)|0x1800|J); }
 
       /* Output data to SCC chip */
       WriteSCCP(&SCChip,J,V);
@@ -1470,7 +1610,7 @@ void MapROM(uint16_t A,uint8_t V)
       /* When no MegaROM present, we allow the program */
       /* to write into SCC wave buffer using EmptyRAM  */
       /* as a scratch pad.                             */
-      if(!ROMData[I]&&(J<0x80)) EmptyRAM[0x1800+J]=V;
+      if(!ROMData[I]&&(J<0x80)) { EmptyRAM[0x1800+J]=V;TouchZ80((A&0xE000)|0x1800|J); }
 
       /* Output data to SCC chip */
       WriteSCC(&SCChip,J,V);
@@ -1490,9 +1630,9 @@ void MapROM(uint16_t A,uint8_t V)
       if((A<0x4000)||(A>0xBFFF)) break;
       J=(A-0x4000)>>13;
       /* Turn SCC on/off on writes to 9000-97FF */
-      if(J==2 && I<2 && (A&0x1800)==0x1000) SCCOn[I]=(V&0x3F)==0x3F;
+      if(J==2 && I<2 && (A&0x1800)==0x1000) SetSCC(I,(V&0x3F)==0x3F);
       /* Turn SCC-I on/off on writes to B000-B7FF */
-      else if(J==3 && I<2 && (A&0x1800)==0x1000) SCCOn[I]=(V&0x80);
+      else if(J==3 && I<2 && (A&0x1800)==0x1000) SetSCC(I,V&0x80);
       /* Switch ROM pages */
       V&=ROMMask[I];
       if(V!=ROMMapper[I][J])
@@ -1523,9 +1663,9 @@ void MapROM(uint16_t A,uint8_t V)
       J=(A-0x5000)>>13;
       /* Turn SCC on/off on writes to 9000-97FF */
       /* note that the 'if' above already filtered anything but 9000. That ignores the mirrors - see https://www.msx.org/wiki/MegaROM_Mappers#Konami.27s_MegaROMs_with_SCC */
-      if(J==2 && I<2 && (A&0x1800)==0x1000) SCCOn[I]=(V&0x3F)==0x3F;
+      if(J==2 && I<2 && (A&0x1800)==0x1000) SetSCC(I,(V&0x3F)==0x3F);
       /* Turn SCC-I on/off on writes to B000-B7FF */
-      else if(J==3 && I<2 && (A&0x1800)==0x1000) SCCOn[I]=(V&0x80);
+      else if(J==3 && I<2 && (A&0x1800)==0x1000) SetSCC(I,V&0x80);
       /* Switch ROM pages */
       V&=ROMMask[I];
       if(V!=ROMMapper[I][J])
@@ -1582,6 +1722,7 @@ void MapROM(uint16_t A,uint8_t V)
       if((A>=0x8000)&&(A<0xC000)&&(ROMMapper[I][((A>>13)&1)+2]==0xFF))
       {
         RAM[A>>13][A&0x1FFF]=V;
+        TouchZ80(A);
         SaveSRAM[I]=1;
         /* Done with SRAM write */
         return;
@@ -1634,6 +1775,7 @@ void MapROM(uint16_t A,uint8_t V)
         P[A+0x0800]=P[A+0x1000]=P[A+0x1800]=
         P[A+0x2000]=P[A+0x2800]=P[A+0x3000]=
         P[A+0x3800]=P[A]=V;
+        for(J=0;J<8;++J) TouchZ80((P==RAM[4]? 0x8000:0xA000)+A+((int)J<<11));
         SaveSRAM[I]=1;
         /* Done with SRAM write */
         return;
@@ -1672,6 +1814,8 @@ void MapROM(uint16_t A,uint8_t V)
       if((A>=0xB000)&&(A<0xC000)&&(ROMMapper[I][3]==0xFF))
       {
         RAM[5][(A&0x0FFF)|0x1000]=RAM[5][A&0x0FFF]=V;
+        TouchZ80(0xA000|(A&0x0FFF));
+        TouchZ80(0xB000|(A&0x0FFF));
         SaveSRAM[I]=1;
         /* Done with SRAM write */
         return;
@@ -1711,6 +1855,7 @@ void MapROM(uint16_t A,uint8_t V)
       if((A>=0x4000)&&(A<0x5FFE)&&(FMPACKey==FMPAC_MAGIC))
       {
         RAM[A>>13][A&0x1FFF]=V;
+        TouchZ80(A);
         SaveSRAM[I]=1;
         return;
       }
@@ -1720,6 +1865,23 @@ void MapROM(uint16_t A,uint8_t V)
   /* No MegaROM mapper or there is an incorrect write */
 }
 
+/** SetSCC() *************************************************/
+/** Turn SCC register window of cartridge I on or off. The  **/
+/** opcodes decoded from under the window are dropped.      **/
+/*************************************************************/
+void SetSCC(uint8_t I,uint8_t V)
+{
+#ifdef Z80_THREADED
+  uint16_t A;
+
+  if(!SCCOn[I]!=!V)
+    for(A=0x9800;A<0xA000;++A) { TouchZ80(A);TouchZ80(A|0x2000); }
+#endif
+
+  SCCOn[I]=V;
+  SetMemHandlers();
+}
+
 /** PSlot() **************************************************/
 /** Switch primary memory slots. This function is called    **/
 /** when value in port A8h changes.                         **/
@@ -1738,6 +1900,8 @@ void PSlot(uint8_t V)
       RAM[I+1]   = MemMap[PSL[J]][SSL[J]][I+1];
       EnWrite[J] = (PSL[J]==3)&&(SSL[J]==2)&&(MemMap[3][2][I]!=EmptyRAM);
     }
+
+  SetMemHandlers();
 }
 
 /** SSlot() **************************************************/
@@ -1765,6 +1929,32 @@ void SSlot(uint8_t V)
         EnWrite[J] = (PSL[J]==3)&&(SSL[J]==2)&&(MemMap[3][2][I]!=EmptyRAM);
       }
     }
+
+  SetMemHandlers();
+}
+
+/** SetMemHandlers() *****************************************/
+/** Mark 256-byte blocks of the address space that need the **/
+/** full RdZ80()/WrZ80() code: FFFFh, FDC registers, SCC    **/
+/** registers, and pages that can not be written to. Call   **/
+/** it whenever PSL[], SSL[], EnWrite[], or SCCOn[] change. **/
+/*************************************************************/
+void SetMemHandlers(void)
+{
+  uint8_t J,PS,SS,I,FDC;
+  int B;
+
+  for(B=0;B<256;++B)
+  {
+    J   = B>>6;                   /* 16kB page number 0-3 */
+    PS  = PSL[J];                 /* Primary slot number  */
+    SS  = SSL[J];                 /* Secondary slot number */
+    I   = CartMap[PS][SS];        /* Cartridge number     */
+    FDC = (PS==3)&&(SS==1)&&((B&0x3F)==0x3F);
+
+    RdMap[B] = (B==0xFF)||FDC||((I<2)&&SCCOn[I]&&((B&0xD8)==0x98));
+    WrMap[B] = (B==0xFF)||FDC||!EnWrite[J];
+  }
 }
 
 /** SetIRQ() *************************************************/
@@ -1854,6 +2044,9 @@ void SetMegaROM(int Slot,uint8_t P0,uint8_t P1,uint8_t P2,uint8_t P3)
   ROMMapper[Slot][1]=P1;
   ROMMapper[Slot][2]=P2;
   ROMMapper[Slot][3]=P3;
+
+  /* MegaROM may have been mapped in */
+  SetMemHandlers();
 }
 
 /** VDPOut() *************************************************/
@@ -1863,6 +2056,15 @@ void VDPOut(uint8_t R,uint8_t V)
 {
   uint8_t J;
 
+  /* Registers other than address, status, line interrupt, */
+  /* and command ones change the display                   */
+  if((VDP[R]!=V)&&(R<32)&&((R<14)||(R>17))&&(R!=19))
+  { SyncRender();VDPGen++; }
+
+  /* Modes, sprite sizes, SAT address, and scrolling change */
+  /* which lines show sprites                               */
+  if((VDP[R]!=V)&&((R<2)||(R==5)||(R==11)||(R==23))) SprDirty=1;
+
   switch(R)
   {
     case  0: /* Reset HBlank interrupt if disabled */
@@ -1909,7 +2111,11 @@ void VDPOut(uint8_t R,uint8_t V)
              SetScreen();
              break;
     case 44: VDPWrite(V);break;
-    case 46: VDPDraw(V);break;
+    case 46: VDPDraw(V);
+             /* Engine runs on HBlanks, start with the next one */
+             if((EvtMask&(1<<EVT_HBLANK))&&!IdleVDP())
+               SetEvent(EVT_ENGINE,EvtTime[EVT_HBLANK]);
+             break;
   }
 
   /* Write value into a register */
@@ -1984,119 +2190,346 @@ uint8_t RTCIn(uint8_t R)
   return(J|0xF0);
 }
 
-/** LoopZ80() ************************************************/
-/** Refresh screen, check keyboard and sprites. Call this   **/
-/** function on each interrupt.                             **/
+/** SetEvent() ***********************************************/
+/** Schedule event ID to happen at CPU cycle Time, replacing **/
+/** any earlier schedule for it. Events due at the same     **/
+/** cycle run in the order of their IDs.                    **/
 /*************************************************************/
-uint16_t LoopZ80(Z80 *R)
+static void SetEvent(int ID,unsigned int Time)
+{
+  int J,T;
+
+  /* Drop the old schedule */
+  ClrEvent(ID);
+
+  /* Insert event into the list sorted by time */
+  for(J=EvtCount;J>0;--J)
+  {
+    T=(int)(EvtTime[EvtList[J-1]]-Time);
+    if((T<0)||(!T&&(EvtList[J-1]<ID))) break;
+    EvtList[J]=EvtList[J-1];
+  }
+  EvtList[J]  = ID;
+  EvtTime[ID] = Time;
+  EvtMask    |= 1<<ID;
+  ++EvtCount;
+}
+
+/** ClrEvent() ***********************************************/
+/** Remove event ID from the timeline, if it is there.      **/
+/*************************************************************/
+static void ClrEvent(int ID)
 {
-  static uint8_t BFlag=0;
-  static uint8_t BCount=0;
-  static int  UCount=0;
-  static uint8_t ACount=0;
-  static uint8_t Drawing=0;
   int J;
 
-  /* Flip HRefresh bit */
-  VDPStatus[2]^=0x20;
+  if(EvtMask&(1<<ID))
+  {
+    for(J=0;EvtList[J]!=ID;++J);
+    for(--EvtCount;J<EvtCount;++J) EvtList[J]=EvtList[J+1];
+    EvtMask&=~(1<<ID);
+  }
+}
+
+/** ResetTimeline() ******************************************/
+/** Rebuild the timeline from the hardware state, when the  **/
+/** CPU is about to run for CPU.IPeriod cycles. PSGTime and **/
+/** OPLLTime are the cycles left to these events, or 0.     **/
+/*************************************************************/
+static void ResetTimeline(int PSGTime,int OPLLTime)
+{
+  EvtNow   = 0;
+  EvtCount = 0;
+  EvtMask  = 0;
+  EvtQuit  = 0;
 
-  /* If HRefresh is now in progress... */
-  if(!(VDPStatus[2]&0x20))
+  /* HRefresh bit tells which half of the scanline runs now */
+  if(VDPStatus[2]&0x20) SetEvent(EVT_HREFRESH,CPU.IPeriod);
+  else
   {
-    /* HRefresh takes most of the scanline */
-    R->IPeriod=!ScrMode||(ScrMode==MAXSCREEN+1)? CPU_H240:CPU_H256;
+    SetEvent(EVT_HBLANK,CPU.IPeriod);
+    if(!IdleVDP()) SetEvent(EVT_ENGINE,CPU.IPeriod);
+  }
 
-    /* New scanline */
-    ScanLine=ScanLine<(PALVideo? 312:261)? ScanLine+1:0;
+  /* Sound chips keep their own pace */
+  SetEvent(EVT_PSG,PSGTime>0? PSGTime:HPeriod<<3);
+  if(OPTION(MSX_NUKEYKT|MSX_FASTOPLL)) SetEvent(EVT_OPLL,OPLLTime>0? OPLLTime:HPeriod);
+}
 
-    /* If first scanline of the screen... */
-    if(!ScanLine)
-    {
-      /* Drawing now... */
-      Drawing=1;
+/** DrawLine() ***********************************************/
+/** Draw scanline given in the lower 8 bits of L, if bit 8  **/
+/** is set. Otherwise the line is kept from before, and     **/
+/** only LastScanline is updated as if it was drawn.        **/
+/*************************************************************/
+static void DrawLine(unsigned int L)
+{
+  uint8_t Y=L&0xFF;
+  int I,J;
 
-      /* Reset VRefresh bit */
-      VDPStatus[2]&=0xBF;
+  if(!(L&0x100))
+  {
+    if(LineLast[Y]>=0) LastScanline=LineLast[Y];
+    return;
+  }
 
-      /* Refresh display */
-      if(UCount>=100)
-      {
-        UCount-=100;
-        PutImage();
-      }
-      UCount+=UPeriod;
+  I=LastScanline;
+  LastScanline=-1;
+  J=!ModeYJK||(ScrMode<7)||(ScrMode>8)? ScrMode:ModeYAE? 10:12;
+#ifdef PERF_TEST
+  PerfLine(J,1);
+#endif
+  (RefreshLine[J])(Y);
+#ifdef PERF_TEST
+  PerfLine(J,0);
+#endif
+  LineLast[Y]=LastScanline;
+  if(LastScanline<0) LastScanline=I;
+}
+
+#ifdef WORKER_THREADS
+static pthread_t RenderTID;           /* Render thread          */
+static pthread_mutex_t RenderLock;    /* Guards the queue below */
+static pthread_cond_t RenderWake;     /* Signaled on new lines  */
+static pthread_cond_t RenderIdle;     /* Signaled on empty queue*/
+static uint16_t RenderQ[256];         /* DrawLine() arguments   */
+static unsigned int RenderHead;       /* Next line to queue     */
+static unsigned int RenderTail;       /* Next line to draw      */
+static uint8_t RenderON;              /* 1: Thread running      */
+static uint8_t RenderQuit;            /* 1: Thread must exit    */
+
+/** RenderLoop() *********************************************/
+/** Render thread: draw queued lines in order until told to **/
+/** quit, signaling RenderIdle whenever the queue empties.  **/
+/*************************************************************/
+static void *RenderLoop(void *Arg)
+{
+  unsigned int L;
+
+  pthread_mutex_lock(&RenderLock);
+  for(;;)
+  {
+    while((RenderTail==RenderHead)&&!RenderQuit)
+      pthread_cond_wait(&RenderWake,&RenderLock);
+    if(RenderTail==RenderHead) break;
+
+    L=RenderQ[RenderTail&0xFF];
+    pthread_mutex_unlock(&RenderLock);
+    DrawLine(L);
+    pthread_mutex_lock(&RenderLock);
+
+    if(++RenderTail==RenderHead) pthread_cond_signal(&RenderIdle);
+  }
+  pthread_mutex_unlock(&RenderLock);
+  return(0);
+}
+
+/** SyncRender() *********************************************/
+/** Wait until the render thread draws all queued lines.    **/
+/*************************************************************/
+void SyncRender(void)
+{
+  if(!RenderON) return;
+  pthread_mutex_lock(&RenderLock);
+  while(RenderTail!=RenderHead) pthread_cond_wait(&RenderIdle,&RenderLock);
+  pthread_mutex_unlock(&RenderLock);
+}
+
+/** SetRenderThread() ****************************************/
+/** Start (On=1) or stop (On=0) the render thread. Returns  **/
+/** 1 if the thread is running afterwards.                  **/
+/*************************************************************/
+int SetRenderThread(int On)
+{
+  if(!On==!RenderON) return(RenderON);
+
+  if(!On)
+  {
+    pthread_mutex_lock(&RenderLock);
+    RenderQuit=1;
+    pthread_cond_signal(&RenderWake);
+    pthread_mutex_unlock(&RenderLock);
+    pthread_join(RenderTID,0);
+    pthread_cond_destroy(&RenderIdle);
+    pthread_cond_destroy(&RenderWake);
+    pthread_mutex_destroy(&RenderLock);
+    RenderON=0;
+    return(0);
+  }
+
+  RenderHead=RenderTail=0;
+  RenderQuit=0;
+  pthread_mutex_init(&RenderLock,0);
+  pthread_cond_init(&RenderWake,0);
+  pthread_cond_init(&RenderIdle,0);
+  if(pthread_create(&RenderTID,0,RenderLoop,0))
+  {
+    pthread_cond_destroy(&RenderIdle);
+    pthread_cond_destroy(&RenderWake);
+    pthread_mutex_destroy(&RenderLock);
+    return(0);
+  }
+
+  RenderON=1;
+  return(1);
+}
+#endif /* WORKER_THREADS */
 
-      /* Blinking for TEXT80 */
-      if(BCount) BCount--;
+/** QueueLine() **********************************************/
+/** Pass L to DrawLine(), on the render thread if running.  **/
+/*************************************************************/
+static void QueueLine(unsigned int L)
+{
+#ifdef WORKER_THREADS
+  if(RenderON)
+  {
+    pthread_mutex_lock(&RenderLock);
+    RenderQ[RenderHead++&0xFF]=L;
+    pthread_cond_signal(&RenderWake);
+    pthread_mutex_unlock(&RenderLock);
+    return;
+  }
+#endif
+  DrawLine(L);
+}
+
+/** EndFrame() ***********************************************/
+/** Finish the frame once its last line has been drawn:     **/
+/** show the image, if it was drawn, and exit emulation if  **/
+/** requested, so that each frame is drawn and shown inside **/
+/** a single RunZ80() call.                                 **/
+/*************************************************************/
+static void EndFrame(void)
+{
+  Drawing=0;
+
+  /* Wait for queued lines to be drawn */
+  SyncRender();
+
+  /* Refresh display */
+  if(UCount>=100)
+  {
+    UCount-=100;
+    PutImage();
+  }
+
+  /* Exit emulation if requested */
+  if(ExitNow) EvtQuit=1;
+}
+
+/** HRefresh() ***********************************************/
+/** Start a new scanline: handle line interrupts and frame  **/
+/** start, then schedule HBlank.                            **/
+/*************************************************************/
+static void HRefresh(void)
+{
+  int J;
+
+  /* Clear HBlank bit */
+  VDPStatus[2]&=~0x20;
+
+  /* HRefresh takes most of the scanline */
+  J=!ScrMode||(ScrMode==MAXSCREEN+1)? CPU_H240:CPU_H256;
+  SetEvent(EVT_HBLANK,EvtNow+J);
+
+  /* V9938 engine runs on HBlanks while it has work */
+  if(!IdleVDP()) SetEvent(EVT_ENGINE,EvtNow+J);
+
+  /* New scanline */
+  ScanLine=ScanLine<(PALVideo? 312:261)? ScanLine+1:0;
+
+  /* If first scanline of the screen... */
+  if(!ScanLine)
+  {
+    /* Finish previous frame if its last line was missed */
+    if(Drawing) EndFrame();
+
+    /* Drawing now... */
+    Drawing=1;
+
+    /* Reset VRefresh bit */
+    VDPStatus[2]&=0xBF;
+
+    UCount+=UPeriod;
+
+    /* Drop this frame if asked to skip it */
+    if(SkipFrame&&(UCount>=100)) UCount-=100;
+
+    /* Blinking for TEXT80 */
+    J=(XFGColor<<4)|XBGColor;
+    if(BCount) BCount--;
+    else
+    {
+      BFlag=!BFlag;
+      if(!VDP[13]) { XFGColor=FGColor;XBGColor=BGColor; }
       else
       {
-        BFlag=!BFlag;
-        if(!VDP[13]) { XFGColor=FGColor;XBGColor=BGColor; }
-        else
+        BCount=(BFlag? VDP[13]&0x0F:VDP[13]>>4)*10;
+        if(BCount)
         {
-          BCount=(BFlag? VDP[13]&0x0F:VDP[13]>>4)*10;
-          if(BCount)
-          {
-            if(BFlag) { XFGColor=FGColor;XBGColor=BGColor; }
-            else      { XFGColor=VDP[12]>>4;XBGColor=VDP[12]&0x0F; }
-          }
+          if(BFlag) { XFGColor=FGColor;XBGColor=BGColor; }
+          else      { XFGColor=VDP[12]>>4;XBGColor=VDP[12]&0x0F; }
         }
       }
     }
+    if(J!=((XFGColor<<4)|XBGColor)) VDPGen++;
+  }
 
-    /* Line coincidence is active at 0..255 */
-    /* in PAL and 0..234/244 in NTSC        */
-    J=PALVideo? 256:ScanLines212? 245:235;
+  /* Line coincidence is active at 0..255 */
+  /* in PAL and 0..234/244 in NTSC        */
+  J=PALVideo? 256:ScanLines212? 245:235;
 
-    /* When reaching end of screen, reset line coincidence */
-    if(ScanLine==J)
+  /* When reaching end of screen, reset line coincidence */
+  if(ScanLine==J)
+  {
+    VDPStatus[1]&=0xFE;
+    SetIRQ(~INT_IE1);
+  }
+
+  /* When line coincidence is active... */
+  if(ScanLine<J)
+  {
+    /* Line coincidence processing */
+    J=(((ScanLine+VScroll)&0xFF)-VDP[19])&0xFF;
+    if(J==2)
     {
-      VDPStatus[1]&=0xFE;
-      SetIRQ(~INT_IE1);
+      /* Set HBlank flag on line coincidence */
+      VDPStatus[1]|=0x01;
+      /* Generate IE1 interrupt */
+      if(VDP[0]&0x10) SetIRQ(INT_IE1);
     }
-
-    /* When line coincidence is active... */
-    if(ScanLine<J)
+    else
     {
-      /* Line coincidence processing */
-      J=(((ScanLine+VScroll)&0xFF)-VDP[19])&0xFF;
-      if(J==2)
-      {
-        /* Set HBlank flag on line coincidence */
-        VDPStatus[1]|=0x01;
-        /* Generate IE1 interrupt */
-        if(VDP[0]&0x10) SetIRQ(INT_IE1);
-      }
-      else
-      {
-        /* Reset flag immediately if IE1 interrupt disabled */
-        if(!(VDP[0]&0x10)) VDPStatus[1]&=0xFE;
-      }
+      /* Reset flag immediately if IE1 interrupt disabled */
+      if(!(VDP[0]&0x10)) VDPStatus[1]&=0xFE;
     }
-
-    /* Return whatever interrupt is pending */
-    R->IRequest=IRQPending? INT_IRQ:INT_NONE;
-    return(R->IRequest);
   }
+}
+
+/** HBlank() *************************************************/
+/** Finish a scanline: handle VBlank, draw the line, run    **/
+/** once-a-frame tasks, then schedule the next scanline.    **/
+/*************************************************************/
+static void HBlank(void)
+{
+  int I,J;
 
-  /*********************************/
-  /* We come here for HBlanks only */
-  /*********************************/
+  /* Set HBlank bit */
+  VDPStatus[2]|=0x20;
 
   /* HBlank takes HPeriod-HRefresh */
-  R->IPeriod=!ScrMode||(ScrMode==MAXSCREEN+1)? CPU_H240:CPU_H256;
-  R->IPeriod=HPeriod-R->IPeriod;
+  I=!ScrMode||(ScrMode==MAXSCREEN+1)? CPU_H240:CPU_H256;
+  I=HPeriod-I;
 
   /* If last scanline of VBlank, see if we need to wait more */
   J=PALVideo? 313:262;
   if(ScanLine>=J-1)
   {
     J*=CPU_HPERIOD;
-    if(VPeriod>J) R->IPeriod+=VPeriod-J;
+    if(VPeriod>J) I+=VPeriod-J;
   }
+  SetEvent(EVT_HREFRESH,EvtNow+I);
 
-  /* If first scanline of the bottom border... */
-  if(ScanLine==(ScanLines212? 212:192)) Drawing=0;
+  /* If first scanline of the bottom border, show the image */
+  if(Drawing&&(ScanLine==(ScanLines212? 212:192))) EndFrame();
 
   /* If first scanline of VBlank... */
   J=PALVideo? (ScanLines212? 212+42:192+52):(ScanLines212? 212+18:192+28);
@@ -2110,36 +2543,33 @@ uint16_t LoopZ80(Z80 *R)
     if(VDP[1]&0x20) SetIRQ(INT_IE0);
   }
 
-  /* Run V9938 engine */
-  LoopVDP();
+  /* Sprite lists and status are updated on every line, drawn */
+  /* or not, so that RefreshLine[] only reads emulation state  */
+  if(Drawing&&(ScanLine<256)) { SpriteLists();SpriteStatus(ScanLine); }
 
   /* Refresh scanline, possibly with the overscan */
   if((UCount>=100)&&Drawing&&(ScanLine<256))
   {
-    if(!ModeYJK||(ScrMode<7)||(ScrMode>8))
-      (RefreshLine[ScrMode])(ScanLine);
-    else
-      if(ModeYAE) RefreshLine10(ScanLine);
-      else RefreshLine12(ScanLine);
-  }
-
-  /* Every few scanlines, update sound */
-  if(!(ScanLine&0x07))
-  {
-    /* Compute number of microseconds */
-    J = (int)(1000000L*(CPU_HPERIOD<<3)/CPU_CLOCK);
+    /* Get the image ready before drawing the first line */
+    if(!ScanLine) { DrawnLines=0;StartImage(); }
 
-    /* Update AY8910 state */
-    Loop8910(&PSG,J);
-
-    /* Flush changes to sound channels */
-    Sync8910(&PSG,AY8910_FLUSH);
-
-    // fmsx-libretro: do not sync SCC & FM-PAC every 8 scanlines; causes interference
+    /* Keep the line in XBuf if nothing changed since it was drawn, */
+    /* unless even/odd frames show different pages or fields        */
+    if((LineGen[ScanLine]==VDPGen)&&!InterlaceON&&!FlipEvenOdd)
+    {
+      SkippedLines++;
+      QueueLine(ScanLine);
+    }
+    else
+    {
+      DrawnLines++;
+      LineGen[ScanLine]=VDPGen;
+      QueueLine(ScanLine|0x100);
+    }
   }
 
-  if(OPTION(MSX_NUKEYKT))
-    NukeYKT_Sync2413(&OPLL_NukeYKT, CPU_HPERIOD);
+  /* Check sprite collisions on every line, drawn or skipped */
+  if(Drawing&&(ScanLine<256)) CheckSprites(ScanLine);
 
   /* Keyboard, sound, and other stuff always runs at line 192    */
   /* This way, it can't be shut off by overscan tricks (Maarten) */
@@ -2148,12 +2578,9 @@ uint16_t LoopZ80(Z80 *R)
     /* Clear 5th Sprite fields (wrong place to do it?) */
     VDPStatus[0]=(VDPStatus[0]&~0x40)|0x1F;
 
-    /* Check sprites and set Collision bit */
-    if(!(VDPStatus[0]&0x20)&&CheckSprites()) VDPStatus[0]|=0x20;
-
     // fmsx-libretro: keep sync SCC & FM-PAC at scanline 192 (version 4.9 & earlier)
     SyncSCC(&SCChip,SCC_FLUSH);
-    if(!OPTION(MSX_NUKEYKT))
+    if(!OPTION(MSX_NUKEYKT|MSX_FASTOPLL))
       Sync2413(&OPLL,YM2413_FLUSH);
 
     /* Apply RAM-based cheats */
@@ -2211,91 +2638,216 @@ uint16_t LoopZ80(Z80 *R)
         /* Autofire FIRE-B if needed */
         if(OPTION(MSX_AUTOFIREB)) JoyState&=~(JST_FIREB|(JST_FIREB<<8));
       }
+  }
+}
 
-    /* Exit emulation if requested */
-    if(ExitNow) return(INT_QUIT);
+/** LoopZ80() ************************************************/
+/** Run hardware events that are due and return pending     **/
+/** interrupt. The CPU runs uninterrupted till next event.  **/
+/*************************************************************/
+uint16_t LoopZ80(Z80 *R)
+{
+  int ID;
+
+  /* CPU has just run the cycles it was given */
+  EvtNow+=R->IPeriod;
+
+  /* Run all events that are due */
+  while(EvtCount&&((int)(EvtTime[EvtList[0]]-EvtNow)<=0))
+  {
+    ID=EvtList[0];
+    ClrEvent(ID);
+    switch(ID)
+    {
+      case EVT_ENGINE:
+        /* Run V9938 engine */
+        LoopVDP();
+        break;
+      case EVT_HREFRESH: HRefresh();break;
+      case EVT_HBLANK:   HBlank();break;
+      case EVT_PSG:
+        /* Update AY8910 state */
+        Loop8910(&PSG,(int)(1000000L*(CPU_HPERIOD<<3)/CPU_CLOCK));
+        /* Flush changes to sound channels */
+        Sync8910(&PSG,AY8910_FLUSH);
+        // fmsx-libretro: do not sync SCC & FM-PAC every 8 scanlines; causes interference
+        SetEvent(EVT_PSG,EvtNow+(HPeriod<<3));
+        break;
+      case EVT_OPLL:
+        if(OPTION(MSX_NUKEYKT)) NukeYKT_Sync2413(&OPLL_NukeYKT,CPU_HPERIOD);
+        else SyncOPLL(&OPLL_Fast,HPeriod,VPeriod);
+        if(OPTION(MSX_NUKEYKT|MSX_FASTOPLL)) SetEvent(EVT_OPLL,EvtNow+HPeriod);
+        break;
+    }
   }
 
+  /* Run CPU until the next event */
+  R->IPeriod=EvtTime[EvtList[0]]-EvtNow;
+
+  /* Exit emulation if requested */
+  if(EvtQuit) { EvtQuit=0;return(INT_QUIT); }
+
   /* Return whatever interrupt is pending */
   R->IRequest=IRQPending? INT_IRQ:INT_NONE;
   return(R->IRequest);
 }
 
-/** CheckSprites() *******************************************/
-/** Check for sprite collisions.                            **/
+/** SpriteLists() ********************************************/
+/** Rebuild SprCount[] and SprList[] if SprDirty is set.    **/
+/** Each line gets all sprites crossing it in SAT order, up **/
+/** to the one with Y=208/216. Lines are numbered as seen   **/
+/** by Sprites() in SCREENs 1-3, i.e. with VScroll added,   **/
+/** and as seen by ColorSprites() otherwise.                **/
 /*************************************************************/
-int CheckSprites(void)
+void SpriteLists(void)
 {
-  unsigned int I,J,LS,LD;
-  uint8_t DH,DV,*S,*D,*PS,*PD,*T;
+  static const uint8_t SprHeights[4] = { 8,16,16,32 };
+  uint8_t IH,OH,EndY,*AT;
+  int J,K,L;
+
+  if(!SprDirty) return;
+  SprDirty=0;
 
-  /* Must be showing sprites */
-  if(SpritesOFF||!ScrMode||(ScrMode>=MAXSCREEN+1)) return(0);
+  memset(SprCount,0,sizeof(SprCount));
+  OH   = SprHeights[VDP[1]&0x03];
+  IH   = SprHeights[VDP[1]&0x02];
+  EndY = ScrMode>3? 216:208;
 
-  /* Find bottom/top scanlines */
-  DH = ScrMode>3? 216:208;
-  LD = 255-(Sprites16x16? 16:8);
-  LS = ScanLines212? 211:191;
+  for(L=0,AT=SprTab;L<32;++L,AT+=4)
+  {
+    K=AT[0];
+    if(K==EndY) break;
+    if(ScrMode>3) K=(uint8_t)(K-VScroll);
+    if(K>256-IH) K-=256;
+    for(J=K<0? 0:K+1;(J<=K+OH)&&(J<256);++J)
+      SprList[J][SprCount[J]++]=L;
+  }
+
+  SprEnd=L;
+}
+
+/** SpriteStatus() *******************************************/
+/** Set 5th/9th sprite flag and number in VDP status reg. 0 **/
+/** as the VDP finds them on display line Y. Called for     **/
+/** each displayed line, whether it is drawn or not.        **/
+/*************************************************************/
+void SpriteStatus(uint8_t Y)
+{
+  uint8_t L,M;
 
-  /* Find valid, displayed sprites */
-  for(I=J=0,S=SprTab;(I<32)&&(S[0]!=DH);++I,S+=4)
-    if((S[0]<LS)||(S[0]>LD)) J|=1<<I;
+  /* Only graphic modes show sprites */
+  if(!ScreenON||!ScrMode||(ScrMode>MAXSCREEN)) return;
 
-  if(Sprites16x16)
+  /* SCREENs 1-3 leave status alone with sprites off */
+  if(ScrMode<4)
   {
-    for(S=SprTab;J;J>>=1,S+=4)
-      if(J&1)
-        for(I=J>>1,D=S+4;I;I>>=1,D+=4)
-          if(I&1)
-          {
-            DV=S[0]-D[0];
-            if((DV<16)||(DV>240))
-	    {
-              DH=S[1]-D[1];
-              if((DH<16)||(DH>240))
-	      {
-                PS=SprGen+((int)(S[2]&0xFC)<<3);
-                PD=SprGen+((int)(D[2]&0xFC)<<3);
-                if(DV<16) PD+=DV; else { DV=256-DV;PS+=DV; }
-                if(DH>240) { DH=256-DH;T=PS;PS=PD;PD=T; }
-                while(DV<16)
-                {
-                  LS=((unsigned int)*PS<<8)+*(PS+16);
-                  LD=((unsigned int)*PD<<8)+*(PD+16);
-                  if(LD&(LS>>DH)) break;
-                  else { ++DV;++PS;++PD; }
-                }
-                if(DV<16) return(1);
-              }
-            }
-          }
+    if(SpritesOFF) return;
+    M=MAXSPRITE1;
   }
-  else
+  else M=MAXSPRITE2;
+
+  /* No extra sprites yet */
+  VDPStatus[0]&=~0x5F;
+  if(SpritesOFF) return;
+
+  /* Set 5th/9thSprite flag if too many sprites in line */
+  Y=SpriteLine(Y);
+  L=SprEnd;
+  if(SprCount[Y]>M)
   {
-    for(S=SprTab;J;J>>=1,S+=4)
-      if(J&1)
-        for(I=J>>1,D=S+4;I;I>>=1,D+=4)
-          if(I&1) 
-          {
-            DV=S[0]-D[0];
-            if((DV<8)||(DV>248))
-            {
-              DH=S[1]-D[1];
-              if((DH<8)||(DH>248))
-              {
-                PS=SprGen+((int)S[2]<<3);
-                PD=SprGen+((int)D[2]<<3);
-                if(DV<8) PD+=DV; else { DV=256-DV;PS+=DV; }
-                if(DH>248) { DH=256-DH;T=PS;PS=PD;PD=T; }
-                while((DV<8)&&!(*PD&(*PS>>DH))) { ++DV;++PS;++PD; }
-                if(DV<8) return(1);
-              }
-            }
-          }
+    VDPStatus[0]|=0x40;
+    if(!OPTION(MSX_ALLSPRITE)) L=SprList[Y][M];
   }
 
-  /* No collisions */
-  return(0);
+  /* Mark last checked sprite (5th/9th in line, Y=208/216, or #31) */
+  VDPStatus[0]|=L<32? L:31;
+}
+
+/** CheckSprites() *******************************************/
+/** Check sprites crossing display line Y for collisions,   **/
+/** marking their pixels in a bitmask and testing each new  **/
+/** sprite against it. Only sprites the VDP would show on   **/
+/** this line are checked. On a hit, set the collision bit  **/
+/** and its coordinates in status registers 3-6.            **/
+/*************************************************************/
+void CheckSprites(uint8_t Y)
+{
+  static const uint8_t SprHeights[4] = { 8,16,16,32 };
+  uint32_t Occ[10],W,M;
+  uint8_t OH,IH,N,C,L,*S,*AT,*PT;
+  int I,J,K,X;
+
+  /* Must be showing sprites, collision not flagged yet */
+  if(VDPStatus[0]&0x20) return;
+  if(SpritesOFF||!ScreenON||!ScrMode||(ScrMode>=MAXSCREEN+1)) return;
+
+  /* Sprites crossing this line, up to the per-line limit */
+  SpriteLists();
+  L = SpriteLine(Y);
+  N = SprCount[L];
+  if(N<2) return;
+  S = SprList[L];
+  I = ScrMode>3? MAXSPRITE2:MAXSPRITE1;
+  if(N>I) N=I;
+
+  OH = SprHeights[VDP[1]&0x03];
+  IH = SprHeights[VDP[1]&0x02];
+  memset(Occ,0,sizeof(Occ));
+
+  /* Pixel X is bit 31-((X+32)&31) of Occ[(X+32)>>5] */
+  for(I=0;I<N;++I)
+  {
+    AT = SprTab+((int)S[I]<<2);
+    K  = ScrMode>3? (uint8_t)(AT[0]-VScroll):AT[0];
+    if(K>256-IH) K-=256;
+    J  = L-K-1;
+    if(OH>IH) J>>=1;
+
+    if(ScrMode>3)
+    {
+      /* CC and IC sprite lines never collide */
+      C = SprTab[-0x0200+((int)S[I]<<4)+J];
+      if(C&0x60) continue;
+      X = C&0x80? AT[1]-32:AT[1];
+    }
+    else X = AT[3]&0x80? AT[1]-32:AT[1];
+
+    /* Sprite pixels, leftmost in bit 31 */
+    PT = SprGen+((int)(IH>8? AT[2]&0xFC:AT[2])<<3)+J;
+    W  = ((uint32_t)PT[0]<<8)|(IH>8? PT[16]:0x00);
+    if(OH>IH)
+    {
+      W = (W|(W<<8))&0x00FF00FF;
+      W = (W|(W<<4))&0x0F0F0F0F;
+      W = (W|(W<<2))&0x33333333;
+      W = (W|(W<<1))&0x55555555;
+      W|= W<<1;
+    }
+    else W<<=16;
+
+    /* Test and mark both words the sprite covers. Words 0 */
+    /* and 9 are off-screen, so collisions there don't count */
+    X+= 32;
+    K = X&31;
+    X>>=5;
+    for(J=0;J<2;++J,++X)
+    {
+      M = J? (K? W<<(32-K):0):W>>K;
+      if((X>0)&&(X<9)&&(Occ[X]&M)) { M&=Occ[X];break; }
+      Occ[X]|=M;
+    }
+
+    if(J<2)
+    {
+      for(X=(X<<5)-32;!(M&0x80000000);M<<=1,++X);
+      VDPStatus[0]|=0x20;
+      VDPStatus[3]=(X+12)&0xFF;
+      VDPStatus[4]=(X+12)>>8;
+      VDPStatus[5]=(Y+8)&0xFF;
+      VDPStatus[6]=(Y+8)>>8;
+      return;
+    }
+  }
 }
 
 /** StateID() ************************************************/
@@ -2672,6 +3224,7 @@ int Cheats(int Switch)
 
     /* Done toggling cheats */
     CheatsON = Switch;
+    FlushZ80();
   }
 
   /* Done */
@@ -3288,6 +3841,9 @@ unsigned int SaveState(unsigned char *Buf,unsigned int MaxSize)
   /* No data written yet */
   Size = 0;
 
+  /* Let the OPLL thread catch up */
+  NukeYKT_Wait2413(&OPLL_NukeYKT);
+
   /* Fill out hardware state */
   J=0;
   memset(State,0,sizeof(State));
@@ -3334,6 +3890,10 @@ unsigned int SaveState(unsigned char *Buf,unsigned int MaxSize)
     State[J++] = SCCIMode[1];
   }
 
+  /* Timeline setup */
+  State[J++] = EvtTime[EVT_PSG]-EvtNow;
+  State[J++] = EvtMask&(1<<EVT_OPLL)? EvtTime[EVT_OPLL]-EvtNow:0;
+
   /* Write out data structures */
   SaveSTRUCT(CPU);
   SaveSTRUCT(PPI);
@@ -3349,6 +3909,7 @@ unsigned int SaveState(unsigned char *Buf,unsigned int MaxSize)
   if (!(Mode&MSX_NO_MEGARAM) && SCCIRAM)
     SaveDATA(SCCIRAM,16*0x2000);
   SaveSTRUCT(OPLL_NukeYKT);
+  SaveSTRUCT(OPLL_Fast);
 
   /* Return amount of data written */
   return(Size);
@@ -3366,6 +3927,9 @@ unsigned int LoadState(unsigned char *Buf,unsigned int MaxSize)
   /* No data read yet */
   Size = 0;
 
+  /* Let the OPLL thread finish before overwriting its state */
+  NukeYKT_Wait2413(&OPLL_NukeYKT);
+
   /* Load hardware state */
   LoadSTRUCT(CPU);
   LoadSTRUCT(PPI);
@@ -3381,6 +3945,7 @@ unsigned int LoadState(unsigned char *Buf,unsigned int MaxSize)
   if (!(Mode&MSX_NO_MEGARAM) && SCCIRAM)
     LoadDATA(SCCIRAM,16*0x2000);
   LoadSTRUCT(OPLL_NukeYKT);
+  LoadSTRUCT(OPLL_Fast);
 
   /* Parse hardware state */
   J=0;
@@ -3436,6 +4001,11 @@ unsigned int LoadState(unsigned char *Buf,unsigned int MaxSize)
     SCCIMode[1] = State[J++];
   }
 
+  /* Timeline setup, zeros in older states */
+  I = State[J++];
+  K = State[J++];
+  ResetTimeline(I,K);
+
   /* Set RAM mapper pages */
   if(RAMMask)
     for(I=0;I<4;++I)
@@ -3457,12 +4027,18 @@ unsigned int LoadState(unsigned char *Buf,unsigned int MaxSize)
     RAM[2*I+1] = MemMap[PSL[I]][SSL[I]][2*I+1];
   }
 
+  /* Memory contents have changed, drop decoded code */
+  SetMemHandlers();
+  FlushZ80();
+
   /* Set palette */
   for(I=0;I<16;++I)
     SetColor(I,(Palette[I]>>16)&0xFF,(Palette[I]>>8)&0xFF,Palette[I]&0xFF);
 
   /* Set screen mode and VRAM table addresses */
   SetScreen();
+  VDPGen++;
+  SprDirty=1;
 
   /* Set some other variables */
   VPAGE    = VRAM+((int)VDP[14]<<14);
@@ -19,6 +19,7 @@
 #include "AY8910.h"       /* AY8910 PSG emulation            */
 #include "YM2413.h"       /* YM2413 OPLL emulation (simple)  */
 #include "../NukeYKT/WrapNukeYKT.h" /* YM2413 OPLL emulation (NukeYKT) */
+#include "FastOPLL.h"       /* YM2413 OPLL emulation (tables)  */
 #include "SCC.h"          /* Konami SCC chip emulation       */
 #include "I8255.h"        /* Intel 8255 PPI emulation        */
 #include "WD1793.h"       /* WD1793 FDC emulation            */
@@ -156,6 +157,7 @@ extern "C" {
 #define MSX_GUESSB    0x00020000 /* Guess ROM mapper type B  */
 
 #define MSX_OPTIONS    0x7FFC0000 /* Miscellaneous Options:   */
+#define MSX_FASTOPLL   0x00100000 /* YM2413 table-driven (FastOPLL)    */
 #define MSX_NUKEYKT    0x00200000 /* YM2413 simple (0) or NukeYKT (1)  */
 #define MSX_GMASTER    0x00400000 /* Load Game Master 1/2     */
 #define MSX_ALLSPRITE  0x00800000 /* Show ALL sprites         */
@@ -262,12 +264,56 @@ extern int  Mode;                     /* ORed MSX_* bits     */
 extern int  RAMPages,VRAMPages;    /* Number of (V)RAM pages */
 extern int  VRAMPageMask;                  /* VRAM page mask */
 extern uint8_t UPeriod;                  /* % of frames to draw */
+extern uint8_t SkipFrame;            /* 1: Don't draw frames*/
 /*************************************************************/
 
 /** Screen Mode Handlers [number of screens + 1] *************/
 extern void (*RefreshLine[MAXSCREEN+2])(uint8_t Y);
 /*************************************************************/
 
+/** SpriteLists() ********************************************/
+/** Rebuild per-line sprite lists in SprList[] if SprDirty  **/
+/** is set. Called before drawing each line, so Sprites()   **/
+/** and ColorSprites() find the lists ready.                **/
+/*************************************************************/
+void SpriteLists(void);
+
+/** SpriteLine() *********************************************/
+/** SprCount[]/SprList[] index of display line Y. SCREENs   **/
+/** 1-3 call Sprites() with Y+VScroll and Sprites() adds    **/
+/** VScroll again, so their lists are indexed with VScroll  **/
+/** added twice. SpriteStatus(), CheckSprites(), and        **/
+/** Sprites() all use this macro to stay in agreement.      **/
+/*************************************************************/
+#define SpriteLine(Y) \
+  (ScrMode>3? (uint8_t)(Y):(uint8_t)((Y)+(VScroll<<1)))
+
+/** Render Thread ********************************************/
+/** When WORKER_THREADS is #defined, SetRenderThread(1)     **/
+/** makes a worker thread run RefreshLine[] on queued lines **/
+/** while CPU emulation goes on. SyncRender() waits for the **/
+/** lines and must be called before changing anything that  **/
+/** RefreshLine[] reads, i.e. wherever VDPGen gets bumped.  **/
+/** All lines are synced before PutImage(), so images are   **/
+/** the same as when drawing inline.                        **/
+/*************************************************************/
+#ifdef WORKER_THREADS
+int  SetRenderThread(int On);
+void SyncRender(void);
+#else
+INLINE int SetRenderThread(int On) { (void)On;return(0); }
+#define SyncRender() ((void)0)
+#endif
+
+/** PerfLine() ***********************************************/
+/** When PERF_TEST is #defined, MSX.c calls this function   **/
+/** with Start=1 before and Start=0 after drawing a line in **/
+/** RefreshLine[M](), to time each screen mode separately.  **/
+/*************************************************************/
+#ifdef PERF_TEST
+void PerfLine(int M,int Start);
+#endif
+
 extern Z80  CPU;                      /* CPU state/registers */
 extern uint8_t *VRAM;                 /* Video RAM           */
 extern uint8_t VDP[64];               /* VDP control reg-ers */
@@ -280,6 +326,14 @@ extern uint8_t FGColor,BGColor;       /* Colors              */
 extern uint8_t XFGColor,XBGColor;     /* Alternative colors  */
 extern uint8_t ScrMode;               /* Current screen mode */
 extern int  ScanLine;                 /* Current scanline    */
+extern unsigned int VDPGen;           /* Display generation  */
+extern uint8_t SprDirty;              /* 1: Rebuild SprList[]*/
+extern uint8_t SprEnd;                /* Sprite# ending SAT  */
+extern uint8_t SprCount[256];         /* Sprites per line    */
+extern uint8_t SprList[256][32];      /* Sprite#s per line   */
+extern uint64_t SkippedLines;         /* Unchanged lines kept*/
+extern int  DrawnLines;               /* Lines redrawn now   */
+extern int  LastScanline;             /* Last drawn XBuf line*/
 extern uint8_t *FontBuf;              /* Optional fixed font */
 
 extern uint8_t ExitNow;               /* 1: Exit emulator    */
@@ -458,24 +512,14 @@ void PlayAllSound(int uSec);
 /************************************ TO BE WRITTEN BY USER **/
 void SetColor(uint8_t N,uint8_t R,uint8_t G,uint8_t B);
 
-void PutImage(void);
-
-/** RefreshLine#() *******************************************/
-/** Refresh line Y (0..191/211), on an appropriate SCREEN#, **/
-/** including sprites in this line.                         **/
+/** StartImage() *********************************************/
+/** Called when the VDP is about to draw a new frame into   **/
+/** XBuf, i.e. to point XBuf to the frontend's framebuffer. **/
+/** PutImage() is called once the frame has been drawn.     **/
 /************************************ TO BE WRITTEN BY USER **/
-void RefreshLineTx80(uint8_t Y);
-void RefreshLine0(uint8_t Y);
-void RefreshLine1(uint8_t Y);
-void RefreshLine2(uint8_t Y);
-void RefreshLine3(uint8_t Y);
-void RefreshLine4(uint8_t Y);
-void RefreshLine5(uint8_t Y);
-void RefreshLine6(uint8_t Y);
-void RefreshLine7(uint8_t Y);
-void RefreshLine8(uint8_t Y);
-void RefreshLine10(uint8_t Y);
-void RefreshLine12(uint8_t Y);
+void StartImage(void);
+
+void PutImage(void);
 
 #ifdef __cplusplus
 }
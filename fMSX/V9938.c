@@ -146,6 +146,7 @@ static void VDPpset(uint8_t SM,
                     uint8_t CL, uint8_t OP);
 
 static int GetVdpTimingValue(int *);
+static void RowEngine(int delta);
 
 static void SrchEngine(void);
 static void LineEngine(void);
@@ -166,6 +167,12 @@ static int  PPB[4]  = { 2,4,2,1 };
 static int  PPL[4]  = { 256,512,512,256 };
 static int  VdpOpsCnt=1;
 static void (*VdpEngine)(void)=0;
+static uint8_t SATHit=0;  /* 1: Command writes into sprite Y coords */
+
+/*************************************************************/
+/** Variables visible to other modules                      **/
+/*************************************************************/
+int FastVDP=1;            /* 0: By pixel, 1: By row, 2: Instant */
 
                       /*  SprOn SprOn SprOf SprOf */
                       /*  ScrOf ScrOn ScrOf ScrOn */
@@ -339,6 +346,168 @@ static int GetVdpTimingValue(int *timing_values)
   return(timing_values[((VDP[1]>>6)&1)|(VDP[8]&2)|((VDP[9]<<1)&4)]);
 }
 
+/** RowSteps() ***********************************************/
+/** Number of steps from X in TX direction until X leaves   **/
+/** 0..MX-1, or 1 if it does not start there.               **/
+/*************************************************************/
+INLINE int RowSteps(int X, int TX, int MX)
+{
+  if ((X<0) || (X>=MX))
+    return(1);
+  return(TX>0? (MX-X+TX-1)/TX : X/(-TX)+1);
+}
+
+/** CopyRun() ************************************************/
+/** Copy N bytes one by one from S to D, going up when      **/
+/** Dir>0 and down otherwise. Use memmove() unless the      **/
+/** overlap makes the byte order matter.                    **/
+/*************************************************************/
+static void CopyRun(uint8_t *D, const uint8_t *S, int N, int Dir)
+{
+  if (Dir>0) {
+    if ((D<=S) || (D>=S+N)) memmove(D, S, N);
+    else while (N--) *D++=*S++;
+  }
+  else {
+    if ((D>=S) || (D<=S-N)) memmove(D-N+1, S-N+1, N);
+    else while (N--) *D--=*S--;
+  }
+}
+
+/* Run N steps of a logical operation, with MMC.LO turned */
+/* into a constant so that the compiler inlines each case */
+#define lrow(PSET, C) \
+  switch (MMC.LO) { \
+    case 0:  for (;N;--N,X+=TX,SX+=TX) PSET(X, DY, C, 0);  break; \
+    case 1:  for (;N;--N,X+=TX,SX+=TX) PSET(X, DY, C, 1);  break; \
+    case 2:  for (;N;--N,X+=TX,SX+=TX) PSET(X, DY, C, 2);  break; \
+    case 3:  for (;N;--N,X+=TX,SX+=TX) PSET(X, DY, C, 3);  break; \
+    case 4:  for (;N;--N,X+=TX,SX+=TX) PSET(X, DY, C, 4);  break; \
+    case 8:  for (;N;--N,X+=TX,SX+=TX) PSET(X, DY, C, 8);  break; \
+    case 9:  for (;N;--N,X+=TX,SX+=TX) PSET(X, DY, C, 9);  break; \
+    case 10: for (;N;--N,X+=TX,SX+=TX) PSET(X, DY, C, 10); break; \
+    case 11: for (;N;--N,X+=TX,SX+=TX) PSET(X, DY, C, 11); break; \
+    case 12: for (;N;--N,X+=TX,SX+=TX) PSET(X, DY, C, 12); break; \
+  }
+
+/** RowKernel() **********************************************/
+/** Run N steps of the current command along one row. Byte **/
+/** commands touch N adjacent bytes then.                   **/
+/*************************************************************/
+static void RowKernel(int SM, int N)
+{
+  int X=MMC.ADX;
+  int SX=MMC.CM==CM_YMMM? MMC.ADX:MMC.ASX;
+  int DY=MMC.DY;
+  int SY=MMC.SY;
+  int TX=MMC.TX;
+  uint8_t *P;
+
+  switch (MMC.CM) {
+    case CM_HMMV:
+      P=VDP_VRMP(SM, X, DY);
+      memset(TX>0? P:P-N+1, MMC.CL, N);
+      break;
+    case CM_HMMM:
+    case CM_YMMM:
+      CopyRun(VDP_VRMP(SM, X, DY), VDP_VRMP(SM, SX, SY), N, TX);
+      break;
+    case CM_LMMV:
+      switch (SM) {
+        case 0: lrow(VDPpset5, MMC.CL) break;
+        case 1: lrow(VDPpset6, MMC.CL) break;
+        case 2: lrow(VDPpset7, MMC.CL) break;
+        case 3: lrow(VDPpset8, MMC.CL) break;
+      }
+      break;
+    case CM_LMMM:
+      switch (SM) {
+        case 0: lrow(VDPpset5, VDPpoint5(SX, SY)) break;
+        case 1: lrow(VDPpset6, VDPpoint6(SX, SY)) break;
+        case 2: lrow(VDPpset7, VDPpoint7(SX, SY)) break;
+        case 3: lrow(VDPpset8, VDPpoint8(SX, SY)) break;
+      }
+      break;
+  }
+}
+
+/** RowEngine() **********************************************/
+/** Run HMMV, HMMM, YMMM, LMMV, or LMMM a row at a time,    **/
+/** with the same results and the same timing as the pixel  **/
+/** loops, or all at once when FastVDP=2.                   **/
+/*************************************************************/
+static void RowEngine(int delta)
+{
+  int SM=ScrMode-5;
+  int TX=MMC.TX;
+  int MX=MMC.MX;
+  int HasSX=(MMC.CM==CM_HMMM)||(MMC.CM==CM_LMMM);
+  int HasSY=(MMC.CM!=CM_HMMV)&&(MMC.CM!=CM_LMMV);
+  int HasNX=MMC.CM!=CM_YMMM;
+  int cnt=VdpOpsCnt;
+  int P=FastVDP>1? 0x7FFFFFFF:(cnt-1)/delta;
+  int S=0;
+  int L,N;
+
+  for (;;) {
+    /* Steps until the row ends or may end */
+    L=RowSteps(MMC.ADX, TX, MX);
+    if (HasSX && (N=RowSteps(MMC.ASX, TX, MX))<L)
+      L=N;
+    if (HasNX && (MMC.ANX>0) && (MMC.ANX<L))
+      L=MMC.ANX;
+
+    /* Steps that fit into the time slice */
+    N=L<P? L:P;
+    if (N) {
+      RowKernel(SM, N);
+      MMC.ADX+=N*TX;
+      MMC.ASX+=N*TX;
+      MMC.ANX-=N;
+      P-=N;
+      S+=N;
+    }
+
+    /* Out of time in mid-row */
+    if (N<L) {
+      VdpOpsCnt=cnt-(S+1)*delta;
+      return;
+    }
+
+    /* End of row, same checks as in post_xxyy() */
+    if ((HasNX && !MMC.ANX) || (HasSX && (MMC.ASX&MX)) || (MMC.ADX&MX)) {
+      if (!(--MMC.NY&1023) ||
+          (HasSY && ((MMC.SY+=MMC.TY)==-1)) ||
+          ((MMC.DY+=MMC.TY)==-1))
+        break;
+      MMC.ASX=MMC.SX;
+      MMC.ADX=MMC.DX;
+      MMC.ANX=MMC.NX;
+    }
+  }
+
+  /* Command execution done */
+  VdpOpsCnt=FastVDP>1? cnt:cnt-S*delta;
+  VDPStatus[2]&=0xFE;
+  VdpEngine=0;
+  if (!MMC.NY) {
+    if (HasSY)
+      MMC.SY+=MMC.TY;
+    MMC.DY+=MMC.TY;
+  }
+  else
+    if (HasSY && (MMC.SY==-1))
+      MMC.DY+=MMC.TY;
+  VDP[42]=MMC.NY & 0xFF;
+  VDP[43]=(MMC.NY>>8) & 0x03;
+  if (HasSY) {
+    VDP[34]=MMC.SY & 0xFF;
+    VDP[35]=(MMC.SY>>8) & 0x03;
+  }
+  VDP[38]=MMC.DY & 0xFF;
+  VDP[39]=(MMC.DY>>8) & 0x03;
+}
+
 /** SrchEgine()** ********************************************/
 /** Search a dot                                            **/
 /*************************************************************/
@@ -487,6 +656,11 @@ void LmmvEngine(void)
   int delta = GetVdpTimingValue(lmmv_timing);
   int cnt = VdpOpsCnt;
 
+  if (FastVDP) {
+    RowEngine(delta);
+    return;
+  }
+
   switch (ScrMode) {
     case 5: pre_loop VDPpset5(ADX, DY, CL, LO); post__x_y(256)
             break;
@@ -537,6 +711,11 @@ void LmmmEngine(void)
   int delta = GetVdpTimingValue(lmmm_timing);
   int cnt = VdpOpsCnt;
 
+  if (FastVDP) {
+    RowEngine(delta);
+    return;
+  }
+
   switch (ScrMode) {
     case 5: pre_loop VDPpset5(ADX, DY, VDPpoint5(ASX, SY), LO); post_xxyy(256)
             break;
@@ -655,6 +834,11 @@ void HmmvEngine(void)
   int delta = GetVdpTimingValue(hmmv_timing);
   int cnt = VdpOpsCnt;
 
+  if (FastVDP) {
+    RowEngine(delta);
+    return;
+  }
+
   switch (ScrMode) {
     case 5: pre_loop *VDP_VRMP5(ADX, DY) = CL; post__x_y(256)
             break;
@@ -704,6 +888,11 @@ void HmmmEngine(void)
   int delta = GetVdpTimingValue(hmmm_timing);
   int cnt = VdpOpsCnt;
 
+  if (FastVDP) {
+    RowEngine(delta);
+    return;
+  }
+
   switch (ScrMode) {
     case 5: pre_loop *VDP_VRMP5(ADX, DY) = *VDP_VRMP5(ASX, SY); post_xxyy(256)
             break;
@@ -758,6 +947,11 @@ void YmmmEngine(void)
   int delta = GetVdpTimingValue(ymmm_timing);
   int cnt = VdpOpsCnt;
 
+  if (FastVDP) {
+    RowEngine(delta);
+    return;
+  }
+
   switch (ScrMode) {
     case 5: pre_loop *VDP_VRMP5(ADX, DY) = *VDP_VRMP5(ADX, SY); post__xyy(256)
             break;
@@ -825,6 +1019,19 @@ void HmmcEngine(void)
   }
 }
 
+/** HitsSAT() ************************************************/
+/** Return 1 if a command writing N lines from DY in TY     **/
+/** direction may change sprite Y coordinates.              **/
+/*************************************************************/
+static int HitsSAT(int SM,int DY,int TY,int N)
+{
+  int Shift = SM>1? 8:7;
+  int Mask  = SM>1? 511:1023;
+  int Row   = (int)((SprTab-VRAM)>>Shift);
+
+  return(!N||(N>Mask)||((((Row-DY)*TY)&Mask)<N));
+}
+
 /** VDPWrite() ***********************************************/
 /** Use this function to transfer pixel(s) from CPU to VDP. **/
 /*************************************************************/
@@ -832,7 +1039,7 @@ void VDPWrite(uint8_t V)
 {
   VDPStatus[2]&=0x7F;
   VDPStatus[7]=VDP[44]=V;
-  if(VdpEngine&&(VdpOpsCnt>0)) VdpEngine();
+  if(VdpEngine&&(VdpOpsCnt>0)) { SyncRender();VdpEngine();VDPGen++;SprDirty|=SATHit; }
 }
 
 /** VDPRead() ************************************************/
@@ -841,7 +1048,7 @@ void VDPWrite(uint8_t V)
 uint8_t VDPRead(void)
 {
   VDPStatus[2]&=0x7F;
-  if(VdpEngine&&(VdpOpsCnt>0)) VdpEngine();
+  if(VdpEngine&&(VdpOpsCnt>0)) { SyncRender();VdpEngine(); }
   return(VDP[44]);
 }
 
@@ -857,6 +1064,8 @@ uint8_t VDPDraw(uint8_t Op)
     return(0);
 
   SM = ScrMode-5;         /* Screen mode index 0..3  */
+  SyncRender();           /* Ops may change VRAM     */
+  VDPGen++;
 
   MMC.CM = Op>>4;
   if ((MMC.CM & 0x0C) != 0x0C && MMC.CM != 0)
@@ -878,6 +1087,7 @@ uint8_t VDPDraw(uint8_t Op)
     case CM_PSET:
       VDPStatus[2]&=0xFE;
       VdpEngine=0;  
+      SprDirty|=HitsSAT(SM,VDP[38]+((int)VDP[39]<<8),1,1);
       VDP_PSET(SM, 
                VDP[36]+((int)VDP[37]<<8),
                VDP[38]+((int)VDP[39]<<8),
@@ -955,11 +1165,15 @@ uint8_t VDPDraw(uint8_t Op)
   else
     MMC.ANX = MMC.NX;
 
+  /* Commands writing VRAM may overwrite sprite Y coordinates */
+  SATHit = (MMC.CM!=CM_SRCH)&&(MMC.CM!=CM_LMCM)&&HitsSAT(SM,MMC.DY,MMC.TY,
+             MMC.CM!=CM_LINE? MMC.NY:(MMC.NX>MMC.NY? MMC.NX:MMC.NY)+1);
+
   /* Command execution started */
   VDPStatus[2]|=0x01;
 
   /* Start execution if we still have time slices */
-  if(VdpEngine&&(VdpOpsCnt>0)) VdpEngine();
+  if(VdpEngine&&(VdpOpsCnt>0)) { VdpEngine();SprDirty|=SATHit; }
 
   /* Operation successfull initiated */
   return(1);
@@ -973,12 +1187,20 @@ void LoopVDP(void)
   if(VdpOpsCnt<=0)
   {
     VdpOpsCnt+=12500;
-    if(VdpEngine&&(VdpOpsCnt>0)) VdpEngine();
+    if(VdpEngine&&(VdpOpsCnt>0)) { SyncRender();VdpEngine();VDPGen++;SprDirty|=SATHit; }
   }
   else
   {
     VdpOpsCnt=12500;
-    if(VdpEngine) VdpEngine();
+    if(VdpEngine) { SyncRender();VdpEngine();VDPGen++;SprDirty|=SATHit; }
   }
 }
 
+/** IdleVDP() ************************************************/
+/** Returns 1 if LoopVDP() would do nothing, i.e. no active **/
+/** command and a full time slice.                          **/
+/*************************************************************/
+int IdleVDP(void)
+{
+  return(!VdpEngine&&(VdpOpsCnt==12500));
+}
@@ -15,6 +15,13 @@
 
 #include "MSX.h"
 
+/** FastVDP **************************************************/
+/** How HMMV, HMMM, YMMM, LMMV, and LMMM commands run:      **/
+/** 0 - pixel by pixel, 1 - row by row with the same timing **/
+/** and results, 2 - row by row, completing instantly.      **/
+/*************************************************************/
+extern int FastVDP;
+
 /** VDPWrite() ***********************************************/
 /** Use this function to transfer pixel(s) from CPU to VDP. **/
 /*************************************************************/
@@ -35,4 +42,9 @@ uint8_t VDPDraw(uint8_t Op);
 /*************************************************************/
 void LoopVDP(void);
 
+/** IdleVDP() ************************************************/
+/** Returns 1 if LoopVDP() has nothing to do.               **/
+/*************************************************************/
+int IdleVDP(void);
+
 #endif /* V9938_H */
@@ -17,7 +17,7 @@
 /** ClearLine512() *******************************************/
 /** Clear 512 pixels from P with color C.                   **/
 /*************************************************************/
-static void ClearLine512(uint16_t *P,uint16_t C)
+static void ClearLine512(pixel *P,pixel C)
 {
   int J;
 
@@ -29,10 +29,10 @@ static void ClearLine512(uint16_t *P,uint16_t C)
 /** the screen border. It returns a pointer to the start of **/
 /** scanline Y in XBuf or 0 if scanline is beyond XBuf.     **/
 /*************************************************************/
-uint16_t *RefreshBorder512(uint8_t Y,uint16_t C)
+pixel *RefreshBorder512(uint8_t Y,pixel C)
 {
-  uint16_t *P;
-  int H,L,A;
+  pixel *P;
+  int H,L,R;
 
   /* First line number in the buffer */
   if(!Y) FirstLine=(ScanLines212?0:10)+BORDER+VAdjust;
@@ -40,11 +40,18 @@ uint16_t *RefreshBorder512(uint8_t Y,uint16_t C)
   /* Return 0 if we've run out of the screen buffer due to overscan */
   if(Y>(OverscanMode?MAX_SCANLINE:211)) return(0);
 
+  /* Buffer must take lines this wide */
+  XFit(WIDTH<<1);
+
+  /* Buffer line to draw scanline Y into */
+  R=HiResMode? ((FirstLine+Y)<<1)+(OddPage? 0:1):FirstLine+Y;
+  if(R+(HiResMode&&OddPage)>=XRows) return(0);
+
   /* Set up the transparent color */
   XPal[0]=(!BGColor||SolidColor0)? XPal0:XPal[BGColor];
 
   /* Start of the buffer */
-  P=(uint16_t *)WBuf;
+  P=(pixel *)WBuf;
 
   if(HiResMode)
   {
@@ -52,55 +59,37 @@ uint16_t *RefreshBorder512(uint8_t Y,uint16_t C)
       /* Paint top of the screen */
       for(L=FirstLine;L>0;L--)
       {
-        for(A=((WIDTH*L)<<2)-1,H=WIDTH<<1;H>0;H--,A--)
+        if (InterlacedMode)
         {
-          if (InterlacedMode)
-          {
-            if (OddPage)
-            { // even lines are black
-              P[A]=0;
-              P[A-(WIDTH<<1)]=C;
-            }
-            else
-            { // odd lines are black
-              P[A]=C;
-              P[A-(WIDTH<<1)]=0;
-            }
+          if (OddPage)
+          { // even lines are black
+            FillLine(P+XPitch*((L<<1)-1),0,WIDTH<<1);
+            FillLine(P+XPitch*((L<<1)-2),C,WIDTH<<1);
           }
-          else // progressive: only touch this frame's lines
-          {
-            if (OddPage)
-              P[A-(WIDTH<<1)]=C;
-            else
-              P[A]=C;
+          else
+          { // odd lines are black
+            FillLine(P+XPitch*((L<<1)-1),C,WIDTH<<1);
+            FillLine(P+XPitch*((L<<1)-2),0,WIDTH<<1);
           }
         }
+        else // progressive: only touch this frame's lines
+          FillLine(P+XPitch*((L<<1)-(OddPage? 2:1)),C,WIDTH<<1);
       }
 
     /* Start of the line */
-    P+=(WIDTH*(FirstLine+Y))<<2;
+    P+=XPitch*R;
 
-    if (OddPage)
-    {
-      if (InterlacedMode)
-        // erase previous frame's line
-        for(A=(WIDTH<<2)-1,H=WIDTH<<1;H>0;H--,A--) P[A]=0;
-    }
-    else
-    {
-      if (InterlacedMode)
-        // erase previous frame's line
-        for(H=(WIDTH<<2)-1;H>=0;H--) P[H]=0;
-      P+=WIDTH<<1; // interlace offset
-    }
+    if (InterlacedMode)
+      // erase previous frame's line
+      FillLine(OddPage? P+XPitch:P-XPitch,0,WIDTH<<1);
   }
   else // standard mode
   {
     /* Paint top of the screen */
-    if(!Y) for(H=2*WIDTH*FirstLine-1;H>=0;H--) P[H]=C;
+    if(!Y) for(L=0;L<FirstLine;L++) FillLine(P+XPitch*L,C,WIDTH<<1);
 
     /* Start of the line */
-    P+=2*WIDTH*(FirstLine+Y);
+    P+=XPitch*R;
   }
 
   /* Paint left/right borders */
@@ -113,21 +102,18 @@ uint16_t *RefreshBorder512(uint8_t Y,uint16_t C)
   if(HiResMode)
   {
     if(Y==H-1)
-    {
       for(L=MAX_HEIGHT-Y;L>0;L--)
       {
-        for(A=((WIDTH*L)<<2)-1,H=WIDTH<<1;H>0;H--,A--)
-        {
-          if (InterlacedMode)
-            // erase previous frame's line
-            P[A]=0;
-          P[A+(WIDTH<<1)]=C;
-        }
+        if (InterlacedMode && (R+(L<<1)-1<XRows))
+          // erase previous frame's line
+          FillLine(P+XPitch*((L<<1)-1),0,WIDTH<<1);
+        if(R+(L<<1)<XRows) FillLine(P+XPitch*(L<<1),C,WIDTH<<1);
       }
-    }
   }
   else // standard mode
-    if(Y==H-1) for(H=2*WIDTH*(HEIGHT-H-FirstLine+1)-1;H>=2*WIDTH;H--) P[H]=C;
+    if(Y==H-1)
+      for(L=HEIGHT-H-FirstLine;L>0;L--)
+        if(R+L<XRows) FillLine(P+XPitch*L,C,WIDTH<<1);
 
   /* Return pointer to the scanline in XBuf */
   return(P+WIDTH-256+2*HAdjust);
@@ -138,9 +124,9 @@ uint16_t *RefreshBorder512(uint8_t Y,uint16_t C)
 /*************************************************************/
 void RefreshLine6(uint8_t Y)
 {
-  uint8_t X,*T,*R,C;
+  uint8_t *T,*R;
   uint8_t ZBuf[304];
-  uint16_t *P=RefreshBorder512(Y,XPal[BGColor&0x03]);
+  pixel *P=RefreshBorder512(Y,XPal[BGColor&0x03]);
   if(!P) return;
 
   if(!ScreenON) ClearLine512(P,XPal[BGColor&0x03]);
@@ -152,18 +138,7 @@ void RefreshLine6(uint8_t Y)
     T=ChrTab+(((int)(Y+VScroll)<<7)&ChrTabM&0x7FFF);
     if (FlipEvenOdd && OddPage && VRAM<=T-0x8000) T-=0x8000;
 
-    for(X=0;X<64;X++)
-    {
-      C=R[0];P[0]=XPal[C? C:T[0]>>6];
-      C=R[0];P[1]=XPal[C? C:(T[0]>>4)&0x03];
-      C=R[1];P[2]=XPal[C? C:(T[0]>>2)&0x03];
-      C=R[1];P[3]=XPal[C? C:T[0]&0x03];
-      C=R[2];P[4]=XPal[C? C:T[1]>>6];
-      C=R[2];P[5]=XPal[C? C:(T[1]>>4)&0x03];
-      C=R[3];P[6]=XPal[C? C:(T[1]>>2)&0x03];
-      C=R[3];P[7]=XPal[C? C:T[1]&0x03];
-      R+=4;P+=8;T+=2;
-    }
+    CrumbRun(P,T,R,32);
   }
 }
   
@@ -172,9 +147,9 @@ void RefreshLine6(uint8_t Y)
 /*************************************************************/
 void RefreshLine7(uint8_t Y)
 {
-  uint8_t C,X,*T,*R;
+  uint8_t *T,*R;
   uint8_t ZBuf[304];
-  uint16_t *P=RefreshBorder512(Y,XPal[BGColor]);
+  pixel *P=RefreshBorder512(Y,XPal[BGColor]);
   if(!P) return;
 
   if(!ScreenON) ClearLine512(P,XPal[BGColor]);
@@ -186,18 +161,7 @@ void RefreshLine7(uint8_t Y)
     T=ChrTab+(((int)(Y+VScroll)<<8)&ChrTabM&0xFFFF);
     if (FlipEvenOdd && OddPage && VRAM<=T-0x10000) T-=0x10000;
 
-    for(X=0;X<64;X++)
-    {
-      C=R[0];P[0]=XPal[C? C:T[0]>>4];
-      C=R[0];P[1]=XPal[C? C:T[0]&0x0F];
-      C=R[1];P[2]=XPal[C? C:T[1]>>4];
-      C=R[1];P[3]=XPal[C? C:T[1]&0x0F];
-      C=R[2];P[4]=XPal[C? C:T[2]>>4];
-      C=R[2];P[5]=XPal[C? C:T[2]&0x0F];
-      C=R[3];P[6]=XPal[C? C:T[3]>>4];
-      C=R[3];P[7]=XPal[C? C:T[3]&0x0F];
-      R+=4;P+=8;T+=4;
-    }
+    NibbleRun(P,T,R,1,32);
   }
 }
 
@@ -206,10 +170,10 @@ void RefreshLine7(uint8_t Y)
 /*************************************************************/
 void RefreshLineTx80(uint8_t Y)
 {
-  uint16_t FC;
+  pixel FC;
   uint8_t X,M,*T,*C,*G;
-  uint16_t BC=XPal[BGColor];
-  uint16_t *P=RefreshBorder512(Y,BC);
+  pixel BC=XPal[BGColor];
+  pixel *P=RefreshBorder512(Y,BC);
   if(!P) return;
 
   if(!ScreenON) ClearLine512(P,BC);
@@ -231,13 +195,8 @@ void RefreshLineTx80(uint8_t Y)
       if(M&0x80) { FC=XPal[XFGColor];BC=XPal[XBGColor]; }
       else       { FC=XPal[FGColor];BC=XPal[BGColor]; }
       M<<=1;
-      Y=*(G+((int)*T<<3));
-      P[0]=Y&0x80? FC:BC;
-      P[1]=Y&0x40? FC:BC;
-      P[2]=Y&0x20? FC:BC;
-      P[3]=Y&0x10? FC:BC;
-      P[4]=Y&0x08? FC:BC;
-      P[5]=Y&0x04? FC:BC;
+      /* Spills 2 pixels, overwritten by the next character */
+      ExpandByte(P,*(G+((int)*T<<3)),FC,BC);
     }
 
     P[0]=P[1]=P[2]=P[3]=P[4]=P[5]=P[6]=P[7]=P[8]=
@@ -18,6 +18,7 @@
 #endif
 
 #include "MSX.h"
+#include "V9938.h"
 #include "EMULib.h"
 #include "Sound.h"
 #include "FDIDisk.h"
@@ -25,15 +26,50 @@
 static bool video_mode_dynamic=false;
 static unsigned frame_number=0;
 static unsigned fps;
-static uint16_t* image_buffer;
+// audio samples owed to the frontend, in 1/CPU_CLOCK units
+static uint64_t audio_remainder=0;
+static bool fps_changed=false;
+static void* image_buffer;
 static unsigned image_buffer_width;
 static unsigned image_buffer_height;
-
-static uint16_t XPal[80];
-static uint16_t BPal[256];
-static uint16_t XPal0;
+static unsigned image_buffer_bpp;
+
+// image_buffer or the frontend's framebuffer, pitch and rows in pixels
+static void* frame_buffer;
+static void* last_frame_buffer;
+static int frame_pitch;
+static int frame_rows;
+static bool in_retro_run=false;
+
+// set once RETRO_MEMORY_SYSTEM_RAM is handed out: the frontend may then
+// write code behind WrZ80()'s back, so decoded opcodes are dropped each frame
+static bool system_ram_exposed=false;
+
+// last frame shown, to hand the frontend a NULL frame when nothing changed
+static unsigned shown_gen;
+static unsigned shown_width;
+static unsigned shown_height;
+
+static uint16_t XPal_16[80];
+static uint16_t BPal_16[256];
+static uint16_t XPal0_16;
+static uint32_t XPal_32[80];
+static uint32_t BPal_32[256];
+static uint32_t XPal0_32;
 static bool PaletteFrozen=false;
 
+static struct retro_perf_callback perf_cb;
+#ifdef PERF_TEST
+static struct retro_perf_counter perf_lines[MAXSCREEN+2] =
+{
+   { "RefreshLine0" }, { "RefreshLine1" }, { "RefreshLine2" },
+   { "RefreshLine3" }, { "RefreshLine4" }, { "RefreshLine5" },
+   { "RefreshLine6" }, { "RefreshLine7" }, { "RefreshLine8" },
+   { "RefreshLine9" }, { "RefreshLine10" }, { "RefreshLine11" },
+   { "RefreshLine12" }, { "RefreshLineTx80" }
+};
+#endif
+
 #ifndef PATH_MAX
 #define PATH_MAX  4096
 #endif
@@ -80,6 +116,7 @@ extern uint8_t *VRAM;
 extern int RAMPages;
 extern int VRAMPages;
 extern uint8_t RTC[4][13];
+extern YM2413_NukeYKT OPLL_NukeYKT;
 
 extern int VPeriod;
 
@@ -96,11 +133,18 @@ bool require_disk_rom = false;
 #define MAX_SCANLINE    (PALVideo?255:242)
 
 #ifdef PSP
-#define PIXEL(R,G,B)    (uint16_t)(((31*(B)/255)<<11)|((63*(G)/255)<<5)|(31*(R)/255))
+#define PIXEL16(R,G,B)  (uint16_t)(((31*(B)/255)<<11)|((63*(G)/255)<<5)|(31*(R)/255))
 #elif defined(PS2)
-#define PIXEL(R,G,B)    (uint16_t)(((31*(B)/255)<<10)|((31*(G)/255)<<5)|(31*(R)/255))
+#define PIXEL16(R,G,B)  (uint16_t)(((31*(B)/255)<<10)|((31*(G)/255)<<5)|(31*(R)/255))
 #else
-#define PIXEL(R,G,B)    (uint16_t)(((31*(R)/255)<<11)|((63*(G)/255)<<5)|(31*(B)/255))
+#define PIXEL16(R,G,B)  (uint16_t)(((31*(R)/255)<<11)|((63*(G)/255)<<5)|(31*(B)/255))
+#endif
+#define PIXEL32(R,G,B)  (uint32_t)(((R)<<16)|((G)<<8)|(B))
+
+// handhelds and consoles only get the 16bpp drivers: PSP and PS2 here,
+// the others through NO_BPP32=1 in their Makefile platform blocks
+#if defined(PSP) || defined(PS2)
+#define NO_BPP32
 #endif
 
 int fmsx_log_level = RETRO_LOG_WARN;
@@ -121,14 +165,49 @@ static bool overscan = false;
 #define OverscanMode        (overscan)
 #define OddPage             (frame_number&1)
 
-#define XBuf image_buffer
-#define WBuf image_buffer
+#define XBuf   frame_buffer
+#define WBuf   frame_buffer
+#define XPitch frame_pitch
+#define XRows  frame_rows
+#define XFit   fit_frame
 int LastScanline;
+
+static void use_image_buffer(void);
+
+// a line of the given width is about to be drawn; when the screen mode
+// has changed width since StartImage(), the frontend framebuffer sized
+// for the old width is dropped and the frame finished in image_buffer
+static void fit_frame(unsigned width)
+{
+   unsigned bytes = image_buffer_bpp>>3;
+   unsigned y;
+
+   if (frame_buffer == image_buffer || width == image_buffer_width)
+      return;
+
+   for (y = 0; y < image_buffer_height; y++)
+      memcpy((uint8_t*)image_buffer + y*(WIDTH<<1)*bytes,
+            (const uint8_t*)frame_buffer + y*frame_pitch*bytes, image_buffer_width*bytes);
+
+   use_image_buffer();
+}
+
 #include "CommonMux.h"
 
 static bool libretro_supports_bitmasks = false;
+static bool libretro_can_dupe = false;
 
+// auto frameskip: skip drawing while retro_run() takes longer than a
+// frame (max_frame_ticks, in microseconds) or audio is about to underrun
+#define MAX_FRAMESKIP 4
 static retro_perf_tick_t max_frame_ticks = 0;
+static retro_time_t frame_time = 0;
+static bool auto_frameskip = false;
+static bool audio_buffer_active = false;
+static bool audio_underrun_likely = false;
+static bool update_audio_latency = false;
+static unsigned frames_skipped = 0;
+static bool frame_shown = false;
 
 static unsigned port0_device;
 
@@ -672,6 +751,13 @@ static void show_message(const char* msg, unsigned number_of_frames)
    environ_cb(RETRO_ENVIRONMENT_SET_MESSAGE, &message);
 }
 
+// CPU cycles in an emulated frame; the real frame rate is CPU_CLOCK
+// divided by this, i.e. 59.92Hz (NTSC) or 50.16Hz (PAL), not 60/50Hz
+static unsigned frame_cycles(void)
+{
+   return (VIDEO(MSX_PAL)? VPERIOD_PAL:VPERIOD_NTSC)/6;
+}
+
 static void update_fps(void)
 {
    int freq;
@@ -688,10 +774,46 @@ static void update_fps(void)
       {
          snprintf(temp_buffer, sizeof(temp_buffer), "switched to %dHz", freq);
          show_message(temp_buffer, fps);
+         fps_changed = fps != 0;
       }
    }
 
    fps = VIDEO(MSX_PAL) ? 50 : 60;
+   max_frame_ticks = (retro_perf_tick_t)1000000 * frame_cycles() / CPU_CLOCK;
+}
+
+static void audio_buffer_status(bool active, unsigned occupancy, bool underrun_likely)
+{
+   // underrun_likely already accounts for occupancy
+   (void)occupancy;
+   audio_buffer_active   = active;
+   audio_underrun_likely = underrun_likely;
+}
+
+static void set_auto_frameskip(bool enable)
+{
+   struct retro_audio_buffer_status_callback buf_status_cb;
+
+   // skipped frames are shown as dupes
+   if (enable && !libretro_can_dupe)
+   {
+      if (log_cb)
+         log_cb(RETRO_LOG_WARN, "Frontend cannot dupe frames, auto frameskip disabled\n");
+      enable = false;
+   }
+
+   if (enable == auto_frameskip)
+      return;
+
+   buf_status_cb.callback = enable ? audio_buffer_status : NULL;
+   if (!environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK, &buf_status_cb))
+      audio_buffer_active = false;
+
+   auto_frameskip       = enable;
+   frames_skipped       = 0;
+   frame_time           = 0;
+   update_audio_latency = true;
+   SkipFrame            = 0;
 }
 
 static void cleanup_sram(void)
@@ -716,6 +838,37 @@ static void set_image_buffer_size(uint8_t screen_mode)
       image_buffer_height <<= 1;
 }
 
+static void use_image_buffer(void)
+{
+   frame_buffer = image_buffer;
+   frame_pitch  = WIDTH<<1;
+   frame_rows   = 640*480/frame_pitch;
+}
+
+static void set_panning(const char *key, int first, int count)
+{
+   struct retro_variable var;
+   int pan = 0;
+
+   var.key = key;
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "Half left") == 0)
+         pan = -128;
+      else if (strcmp(var.value, "Half right") == 0)
+         pan = 128;
+      else if (strcmp(var.value, "Left") == 0)
+         pan = -256;
+      else if (strcmp(var.value, "Right") == 0)
+         pan = 256;
+   }
+
+   while (count--)
+      SetPanning(first++, pan);
+}
+
 static void check_variables(void)
 {
    bool reset_sfx = false;
@@ -880,11 +1033,81 @@ static void check_variables(void)
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value && strcmp(var.value, "Yes") == 0)
       Mode |= MSX_ALLSPRITE;
 
+   var.key = "fmsx_frameskip";
+   var.value = NULL;
+
+   set_auto_frameskip(environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value && strcmp(var.value, "Auto") == 0);
+
+   var.key = "fmsx_vdp_engine";
+   var.value = NULL;
+
+   FastVDP = 1;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "Instant") == 0)
+         FastVDP = 2;
+      else if (strcmp(var.value, "Pixels") == 0)
+         FastVDP = 0;
+   }
+
    var.key = "fmsx_ym2413_core";
    var.value = NULL;
 
-   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value && strcmp(var.value, "NukeYKT") == 0)
-      Mode |= MSX_NUKEYKT;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (strcmp(var.value, "NukeYKT") == 0)
+         Mode |= MSX_NUKEYKT;
+      else if (strcmp(var.value, "Fast") == 0)
+         Mode |= MSX_FASTOPLL;
+   }
+
+   set_panning("fmsx_pan_psg", FIRST_AY8910_CHANNEL, AY8910_CHANNELS);
+   set_panning("fmsx_pan_scc", FIRST_SCC_CHANNEL, SCC_CHANNELS);
+   set_panning("fmsx_pan_fm", FIRST_YM2413_CHANNEL, YM2413_CHANNELS);
+
+#ifdef Z80_THREADED
+   var.key = "fmsx_cpu_core";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      int engine = 1;
+
+      if (strcmp(var.value, "Classic") == 0)
+         engine = 0;
+      else if (strcmp(var.value, "Translated") == 0)
+         engine = 2;
+
+      /* drop translated blocks when switching engines */
+      if (engine != ThreadedZ80)
+         FlushZ80();
+      ThreadedZ80 = engine;
+   }
+#endif
+
+#ifdef WORKER_THREADS
+   var.key = "fmsx_render_thread";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value && strcmp(var.value, "Yes") == 0)
+   {
+      if (!SetRenderThread(1) && log_cb)
+         log_cb(RETRO_LOG_WARN, "Could not start render thread, drawing inline\n");
+   }
+   else
+      SetRenderThread(0);
+
+   var.key = "fmsx_ym2413_thread";
+   var.value = NULL;
+
+   if ((Mode & MSX_NUKEYKT) && environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value && strcmp(var.value, "Yes") == 0)
+   {
+      if (!NukeYKT_SetThread2413(&OPLL_NukeYKT, 1) && log_cb)
+         log_cb(RETRO_LOG_WARN, "Could not start NukeYKT thread, synthesizing inline\n");
+   }
+   else
+      NukeYKT_SetThread2413(&OPLL_NukeYKT, 0);
+#endif
 
    var.key = "fmsx_ram_pages";
    var.value = NULL;
@@ -995,6 +1218,9 @@ static void check_variables(void)
    var.key = "fmsx_custom_keyboard_r3"; var.value = NULL;
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value) keybemu2_map[15].fmsx = custom_keyboard_name_to_fmsx(var.value);
 
+   // options may change how lines are drawn; redraw all of them
+   VDPGen++;
+
    update_fps();
 }
 
@@ -1172,15 +1398,26 @@ bool retro_load_game(const struct retro_game_info *info)
    static char ROMName_buffer[PATH_MAX];
    static char CasName_buffer[PATH_MAX];
    struct retro_keyboard_callback keyboard_event_callback;
-   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_RGB565;
+   enum retro_pixel_format fmt;
    bool have_image = false;
    char *dot;
    size_t len;
 
-   if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
-      return false;
+#ifndef NO_BPP32
+   fmt = RETRO_PIXEL_FORMAT_XRGB8888;
+   if (environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
+      image_buffer_bpp = SetScreenDepth(32);
+   else
+#endif
+   {
+      fmt = RETRO_PIXEL_FORMAT_RGB565;
+      if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
+         return false;
+      image_buffer_bpp = SetScreenDepth(16);
+   }
 
-   image_buffer = (uint16_t*)malloc(640*480*sizeof(uint16_t));
+   image_buffer = malloc(640*480*(image_buffer_bpp>>3));
+   use_image_buffer();
 
    environ_cb(RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY, &ProgDir);
 
@@ -1284,7 +1521,13 @@ bool retro_load_game(const struct retro_game_info *info)
 
    // setup fixed SCREEN 8 palette: RGB332
    for(i = 0; i < 256; i++)
-      BPal[i]=PIXEL(((i>>2)&0x07)*255/7,((i>>5)&0x07)*255/7,(i&0x03)*255/3);
+   {
+      uint8_t R = ((i>>2)&0x07)*255/7;
+      uint8_t G = ((i>>5)&0x07)*255/7;
+      uint8_t B = (i&0x03)*255/3;
+      BPal_16[i]=PIXEL16(R,G,B);
+      BPal_32[i]=PIXEL32(R,G,B);
+   }
 
    InitSound(SND_RATE);
    SetChannels(255/MAXCHANNELS, (1<<MAXCHANNELS)-1);
@@ -1315,26 +1558,27 @@ bool retro_load_game_special(unsigned a, const struct retro_game_info *b, size_t
 
 void SetColor(uint8_t N,uint8_t R,uint8_t G,uint8_t B)
 {
+  uint16_t P=PIXEL16(R,G,B);
+  uint32_t Q=PIXEL32(R,G,B);
   if(PaletteFrozen && N<16) return;
   if(N)
-     XPal[N]=PIXEL(R,G,B);
+  {
+     if(XPal_32[N]!=Q) { SyncRender();VDPGen++; }
+     XPal_16[N]=P;
+     XPal_32[N]=Q;
+  }
   else
-     XPal0=PIXEL(R,G,B);
+  {
+     if(XPal0_32!=Q) { SyncRender();VDPGen++; }
+     XPal0_16=P;
+     XPal0_32=Q;
+  }
 }
 
 unsigned int WriteAudio(int16_t *Data,unsigned int Length)
 {
-   static uint16_t audio_buf[AUDIO_BUFFER_SIZE * 2];
-   int i;
-   if (Length > AUDIO_BUFFER_SIZE)
-      Length = AUDIO_BUFFER_SIZE;
-   for (i=0; i < Length; i++)
-   {
-      audio_buf[i << 1]       = Data[i];
-      audio_buf[(i << 1) + 1] = Data[i];
-   }
-
-   return audio_batch_cb((const int16_t*)audio_buf, Length);
+   // Data is already interleaved stereo, one call per frame
+   return audio_batch_cb(Data, Length);
 }
 
 unsigned int Joystick(void)
@@ -1348,31 +1592,95 @@ unsigned int Mouse(uint8_t N)
    return 0;
 }
 
-void PutImage(void)
+// even/odd page flipping shows another page on every other frame
+// without any VDPGen change, so such frames are never dupes
+static bool can_dupe_frame(void)
+{
+   return libretro_can_dupe && !FlipEvenOdd;
+}
+
+void StartImage(void)
 {
+#ifndef PSP
+   struct retro_framebuffer fb = {0};
+#endif
+
+   use_image_buffer();
    set_image_buffer_size(ScrMode);
 
+#ifndef PSP
+   // StartMSX() runs the first frame from retro_load_game()
+   if (!in_retro_run)
+      return;
+
+   // progressive hi-res keeps the other field from the previous frame;
+   // an unchanged screen is kept in image_buffer and shown as a dupe
+   if ((!HiResMode || InterlacedMode) && !(can_dupe_frame() && VDPGen == shown_gen))
+   {
+      fb.width        = image_buffer_width;
+      fb.height       = image_buffer_height;
+      fb.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+      if (environ_cb(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &fb)
+            && fb.data && fb.pitch % (image_buffer_bpp>>3) == 0
+            && fb.format == (image_buffer_bpp==32 ? RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565))
+      {
+         frame_buffer = fb.data;
+         frame_pitch  = fb.pitch / (image_buffer_bpp>>3);
+         frame_rows   = fb.height;
+      }
+   }
+#endif
+
+   // frontend framebuffer contents are unspecified; redraw all lines
+   if (frame_buffer != image_buffer || last_frame_buffer != image_buffer)
+      VDPGen++;
+   last_frame_buffer = frame_buffer;
+}
+
+void PutImage(void)
+{
+   if (!in_retro_run)
+      return;
+
+   // frontend framebuffer was sized in StartImage()
+   if (frame_buffer == image_buffer)
+      set_image_buffer_size(ScrMode);
+
+   // no line redrawn: let the frontend show the previous frame again
+   if (can_dupe_frame() && !DrawnLines && frame_buffer == image_buffer
+         && image_buffer_width == shown_width && image_buffer_height == shown_height)
+      video_cb(NULL, image_buffer_width, image_buffer_height, frame_pitch * (image_buffer_bpp>>3));
+   else
+   {
 #ifdef PSP
-   static unsigned int __attribute__((aligned(16))) d_list[32];
-   void* const texture_vram_p = (void*) (0x44200000 - (640 * 480)); // max VRAM address - frame size
+      static unsigned int __attribute__((aligned(16))) d_list[32];
+      void* const texture_vram_p = (void*) (0x44200000 - (640 * 480)); // max VRAM address - frame size
 
-   sceKernelDcacheWritebackRange(XBuf, 256*240 );
-   sceGuStart(GU_DIRECT, d_list);
-   sceGuCopyImage(GU_PSM_5650, 0, 0, image_buffer_width, image_buffer_height, image_buffer_width, image_buffer, 0, 0, image_buffer_width, texture_vram_p);
+      sceKernelDcacheWritebackRange(XBuf, 256*240 );
+      sceGuStart(GU_DIRECT, d_list);
+      sceGuCopyImage(GU_PSM_5650, 0, 0, image_buffer_width, image_buffer_height, frame_pitch, image_buffer, 0, 0, image_buffer_width, texture_vram_p);
 
-   sceGuTexSync();
-   sceGuTexImage(0, 512, 256, image_buffer_width, texture_vram_p);
-   sceGuTexMode(GU_PSM_5650, 0, 0, GU_FALSE);
-   sceGuTexFunc(GU_TFX_REPLACE, GU_TCC_RGB);
-   sceGuDisable(GU_BLEND);
-   sceGuFinish();
+      sceGuTexSync();
+      sceGuTexImage(0, 512, 256, image_buffer_width, texture_vram_p);
+      sceGuTexMode(GU_PSM_5650, 0, 0, GU_FALSE);
+      sceGuTexFunc(GU_TFX_REPLACE, GU_TCC_RGB);
+      sceGuDisable(GU_BLEND);
+      sceGuFinish();
 
-   video_cb(texture_vram_p, image_buffer_width, image_buffer_height, image_buffer_width * sizeof(uint16_t));
+      video_cb(texture_vram_p, image_buffer_width, image_buffer_height, image_buffer_width * sizeof(uint16_t));
 #else
-   video_cb(image_buffer, image_buffer_width, image_buffer_height, image_buffer_width * sizeof(uint16_t));
+      video_cb(frame_buffer, image_buffer_width, image_buffer_height, frame_pitch * (image_buffer_bpp>>3));
 #endif
+      shown_width  = image_buffer_width;
+      shown_height = image_buffer_height;
+   }
+   shown_gen = VDPGen;
+   frame_shown = true;
    frame_number++;
 
+   // frontend framebuffer is not ours anymore
+   use_image_buffer();
+
    update_fps();
 }
 
@@ -1416,6 +1724,9 @@ void retro_unload_game(void)
       free(image_buffer);
 
    image_buffer = NULL;
+   system_ram_exposed = false;
+   frame_buffer = NULL;
+   last_frame_buffer = NULL;
    image_buffer_width = 0;
    image_buffer_height = 0;
 
@@ -1423,6 +1734,18 @@ void retro_unload_game(void)
    cleanup_sram();
    num_disk_images = 0;
 
+#ifdef Z80_IDLE
+   if (log_cb && fmsx_log_level <= RETRO_LOG_INFO)
+      log_cb(RETRO_LOG_INFO, "Z80 idle loops skipped: %llu cycles\n", (unsigned long long)IdleCycles);
+#endif
+   if (log_cb && fmsx_log_level <= RETRO_LOG_INFO)
+      log_cb(RETRO_LOG_INFO, "Unchanged scanlines kept: %llu\n", (unsigned long long)SkippedLines);
+   NukeYKT_Wait2413(&OPLL_NukeYKT);
+   if (log_cb && fmsx_log_level <= RETRO_LOG_INFO && NukeYKT_IdleSamples)
+      log_cb(RETRO_LOG_INFO, "Silent NukeYKT OPLL samples skipped: %llu (%llu clocks, %u s)\n",
+            (unsigned long long)NukeYKT_IdleSamples, (unsigned long long)NukeYKT_IdleSamples*CYCLE_COUNT,
+            (unsigned)(NukeYKT_IdleSamples*Z80_CYCLES_PER_SAMPLE/CPU_CLOCK));
+
    TrashMSX();
 }
 
@@ -1442,6 +1765,7 @@ void *retro_get_memory_data(unsigned id)
    case RETRO_MEMORY_RTC:
       return RTC;
    case RETRO_MEMORY_SYSTEM_RAM:
+      system_ram_exposed = true;
       return RAMData;
    case RETRO_MEMORY_VIDEO_RAM:
       return VRAM;
@@ -1537,7 +1861,19 @@ void retro_set_environment(retro_environment_t cb)
       { "fmsx_ram_pages", "MSX Main Memory; Auto|64KB|128KB|256KB|512KB|4MB" },
       { "fmsx_vram_pages", "MSX Video Memory; Auto|32KB|64KB|128KB|192KB" },
       { "fmsx_scci_megaram", "Enable SCC-I 128kB MegaRAM; Yes|No" },
-      { "fmsx_ym2413_core", "YM2413 (FM-PAC / MSX-MUSIC) core; fMSX|NukeYKT" },
+      { "fmsx_frameskip", "Frameskip; Off|Auto" },
+      { "fmsx_vdp_engine", "V9938 command engine; Rows|Instant|Pixels" },
+      { "fmsx_ym2413_core", "YM2413 (FM-PAC / MSX-MUSIC) core; fMSX|NukeYKT|Fast" },
+      { "fmsx_pan_psg", "PSG stereo panning; Center|Half left|Half right|Left|Right" },
+      { "fmsx_pan_scc", "SCC stereo panning; Center|Half left|Half right|Left|Right" },
+      { "fmsx_pan_fm", "YM2413 (FM-PAC / MSX-MUSIC) stereo panning; Center|Half left|Half right|Left|Right" },
+#ifdef Z80_THREADED
+      { "fmsx_cpu_core", "Z80 CPU core; Threaded|Translated|Classic" },
+#endif
+#ifdef WORKER_THREADS
+      { "fmsx_render_thread", "Draw scanlines on a separate thread; No|Yes" },
+      { "fmsx_ym2413_thread", "Run NukeYKT YM2413 on a separate thread; No|Yes" },
+#endif
       { "fmsx_log_level", "fMSX logging; Off|Info|Debug|Spam" },
       { "fmsx_game_master", "Support Game Master; No|Yes" },
       { "fmsx_simbdos", "Simulate DiskROM disk access calls; No|Yes" },
@@ -1688,8 +2024,61 @@ void retro_run(void)
 
    handle_tape_autotype();
 
-   RunZ80(&CPU);
-   RenderAndPlayAudio(SND_RATE / fps);
+   // ask for a few frames of audio latency, so skipping can catch up
+   if (update_audio_latency)
+   {
+      unsigned latency = auto_frameskip ? (MAX_FRAMESKIP + 2) * 1000 / fps : 0;
+      environ_cb(RETRO_ENVIRONMENT_SET_MINIMUM_AUDIO_LATENCY, &latency);
+      update_audio_latency = false;
+   }
+
+   // RAM may have been poked since the last frame (cheats, achievements)
+   if (system_ram_exposed)
+      FlushZ80();
+
+   // skip drawing when the last drawn frame was too slow or audio is
+   // running out, but draw at least every MAX_FRAMESKIP+1 frames
+   if (auto_frameskip)
+   {
+      bool behind = (audio_buffer_active && audio_underrun_likely)
+            || (frame_time > (retro_time_t)max_frame_ticks);
+      SkipFrame = behind && frames_skipped < MAX_FRAMESKIP;
+      frames_skipped = SkipFrame ? frames_skipped + 1 : 0;
+   }
+
+   frame_shown = false;
+   in_retro_run = true;
+   if (auto_frameskip && !SkipFrame && perf_cb.get_time_usec)
+   {
+      retro_time_t start = perf_cb.get_time_usec();
+      RunZ80(&CPU);
+      frame_time = perf_cb.get_time_usec() - start;
+   }
+   else
+      RunZ80(&CPU);
+   in_retro_run = false;
+
+   // skipped frame: show the previous one again
+   if (!frame_shown && libretro_can_dupe)
+   {
+      video_cb(NULL, shown_width, shown_height, frame_pitch * (image_buffer_bpp>>3));
+      frame_number++;
+      update_fps();
+   }
+   // exact number of samples for this frame, carrying the remainder,
+   // so that audio stays locked to emulated time
+   audio_remainder += (uint64_t)SND_RATE * frame_cycles();
+   RenderAndPlayAudio((unsigned)(audio_remainder / CPU_CLOCK));
+   audio_remainder %= CPU_CLOCK;
+
+   // tell the frontend about the new exact frame rate
+   if (fps_changed)
+   {
+      struct retro_system_av_info av_info;
+      retro_get_system_av_info(&av_info);
+      environ_cb(RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO, &av_info);
+      fps_changed = false;
+   }
 
    fflush(stdout);
 
@@ -1720,7 +2109,7 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
    info->geometry.max_width    = 640;
    info->geometry.max_height   = 480;
    info->geometry.aspect_ratio = 0;
-   info->timing.fps            = fps;
+   info->timing.fps            = (double)CPU_CLOCK / frame_cycles();
    info->timing.sample_rate    = SND_RATE;
 }
 
@@ -1736,9 +2125,38 @@ void retro_init(void)
 
    if (environ_cb(RETRO_ENVIRONMENT_GET_INPUT_BITMASKS, NULL))
       libretro_supports_bitmasks = true;
+
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &libretro_can_dupe))
+      libretro_can_dupe = false;
+
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_PERF_INTERFACE, &perf_cb))
+      memset(&perf_cb, 0, sizeof(perf_cb));
 }
 
+#ifdef PERF_TEST
+// per-mode scanline timing; the frontend logs counters with perf_log()
+void PerfLine(int M, int Start)
+{
+   struct retro_perf_counter *counter = &perf_lines[M];
+   if (!perf_cb.perf_register)
+      return;
+   if (!counter->registered)
+      perf_cb.perf_register(counter);
+   if (Start)
+      perf_cb.perf_start(counter);
+   else
+      perf_cb.perf_stop(counter);
+}
+#endif
+
 void retro_deinit(void)
 {
+#ifdef PERF_TEST
+   if (perf_cb.perf_log)
+      perf_cb.perf_log();
+#endif
    libretro_supports_bitmasks = false;
+   libretro_can_dupe = false;
+   auto_frameskip = false;
+   SkipFrame = 0;
 }
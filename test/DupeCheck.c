@@ -0,0 +1,322 @@
+/** fMSX: portable MSX emulator ******************************/
+/**                                                         **/
+/**                        DupeCheck.c                      **/
+/**                                                         **/
+/** This file contains a test for frame dupes in the core.  **/
+/** A BASIC program is typed into the MSX2 emulation, which **/
+/** shows a still screen and then flips between even and    **/
+/** odd pages. Every frame is hashed as the frontend shows  **/
+/** it, and hashes must be the same with and without dupes, **/
+/** the render thread, and frontend framebuffers. These are **/
+/** filled with junk, so lines left undrawn show up.        **/
+/**                                                         **/
+/*************************************************************/
+#include "libretro.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define FRAMES   2100             /* Frames to run                */
+#define TYPE_AT  600              /* Frame to start typing at     */
+#define FLIPS    60               /* Page flips checked at end    */
+
+/** Program typed into BASIC: page 1 shows a box, page 0 is **/
+/** filled, then R#9 bit 2 flips between them each frame.   **/
+static const char *Program =
+  "10 screen 5:set page 1,1:cls:line(20,20)-(200,150),4,bf\n"
+  "20 set page 0,0:cls:line(0,0)-(255,211),8,bf\n"
+  "30 for w=0 to 1000:next:set page 1,0:vdp(10)=vdp(10) or 4\n"
+  "40 goto 40\n"
+  "run\n";
+
+/** Settings for each run, the first one is the reference. **/
+static const struct { int Dupe,Thread,FB; } Runs[] =
+{
+  { 0,0,1 },{ 1,0,1 },{ 1,1,1 },{ 0,0,0 },{ 1,0,0 }
+};
+
+#define RUNS (int)(sizeof(Runs)/sizeof(Runs[0]))
+
+typedef struct
+{
+  uint64_t Hash[FRAMES];          /* Hash of each frame shown     */
+  int Dupes;                      /* Frames sent as dupes         */
+} Result;
+
+static const char *ROMDir;
+static int Run,Frame,Format;
+static uint8_t *Last,*FB;
+static unsigned int LastW,LastH;
+static Result Res;
+static int16_t Keys[RETROK_LAST];
+
+/** Hash() ***************************************************/
+/** FNV-1a hash of N bytes.                                 **/
+/*************************************************************/
+static uint64_t Hash(uint64_t H,const void *Data,size_t N)
+{
+  const uint8_t *P = (const uint8_t *)Data;
+  while(N--) { H^=*P++;H*=1099511628211ULL; }
+  return(H);
+}
+
+/** KeyFor() *************************************************/
+/** Find a key and shift state typing character C.          **/
+/*************************************************************/
+static int KeyFor(char C,int *Shift)
+{
+  static const char Shifted[] = ")!@#$%^&*(";
+
+  *Shift = 0;
+  if((C>='a')&&(C<='z')) return(RETROK_a+C-'a');
+  if((C>='0')&&(C<='9')) return(RETROK_0+C-'0');
+  if(C&&strchr(Shifted,C)) { *Shift=1;return(RETROK_0+(strchr(Shifted,C)-Shifted)); }
+  switch(C)
+  {
+    case ' ':  return(RETROK_SPACE);
+    case '\n': return(RETROK_RETURN);
+    case ',':  return(RETROK_COMMA);
+    case '-':  return(RETROK_MINUS);
+    case '=':  return(RETROK_EQUALS);
+    case ':':  *Shift=1;return(RETROK_SEMICOLON);
+  }
+  fprintf(stderr,"Cannot type '%c'\n",C);
+  exit(2);
+}
+
+/** Frontend Callbacks ***************************************/
+/** Just enough of a libretro frontend to run the core.     **/
+/*************************************************************/
+static bool Environment(unsigned int Cmd,void *Data)
+{
+  struct retro_variable *V;
+  struct retro_framebuffer *F;
+  unsigned int J,Bpp;
+
+  switch(Cmd)
+  {
+    case RETRO_ENVIRONMENT_GET_VARIABLE:
+      V = (struct retro_variable *)Data;
+      V->value =
+        !strcmp(V->key,"fmsx_mode")?          "MSX2":
+        !strcmp(V->key,"fmsx_render_thread")? (Runs[Run].Thread? "Yes":"No"):
+        0;
+      return(V->value!=0);
+    case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
+      *(bool *)Data = false;
+      return(true);
+    case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+      *(const char **)Data = ROMDir;
+      return(true);
+    case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+      Format = *(enum retro_pixel_format *)Data;
+      return(true);
+    case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+      *(bool *)Data = Runs[Run].Dupe;
+      return(true);
+    case RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER:
+      /* New buffer each frame, odd pitch, filled with junk */
+      if(!Runs[Run].FB) return(false);
+      F   = (struct retro_framebuffer *)Data;
+      Bpp = Format==RETRO_PIXEL_FORMAT_XRGB8888? 4:2;
+      F->pitch = (F->width+7+(Frame%5)*3)*Bpp;
+      free(FB);
+      if(!(FB=malloc(F->pitch*F->height))) return(false);
+      for(J=0;J<F->pitch*F->height;++J) FB[J]=J*7+Frame;
+      F->data         = FB;
+      F->format       = Format;
+      F->memory_flags = 0;
+      return(true);
+    case RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO:
+    case RETRO_ENVIRONMENT_SET_GEOMETRY:
+      return(true);
+  }
+  return(false);
+}
+
+static void Video(const void *Data,unsigned int W,unsigned int H,size_t Pitch)
+{
+  unsigned int Bpp = Format==RETRO_PIXEL_FORMAT_XRGB8888? 4:2;
+  unsigned int Y,X;
+  uint64_t S;
+  uint32_t P;
+
+  if(Frame>=FRAMES) return;
+
+  if(!Data)
+  {
+    /* Dupe: the frontend shows the last frame again */
+    if(!Last||(W!=LastW)||(H!=LastH)) { fprintf(stderr,"Bad dupe at frame %d\n",Frame);exit(2); }
+    ++Res.Dupes;
+  }
+  else
+  {
+    free(Last);
+    if(!(Last=malloc(W*H*Bpp))) exit(2);
+    for(Y=0;Y<H;++Y) memcpy(Last+Y*W*Bpp,(const uint8_t *)Data+Y*Pitch,W*Bpp);
+    LastW = W;
+    LastH = H;
+  }
+
+  /* Hash what is shown, ignoring XRGB8888 unused bits */
+  S = Hash(1469598103934665603ULL,&LastW,sizeof(LastW));
+  S = Hash(S,&LastH,sizeof(LastH));
+  if(Bpp==2) S=Hash(S,Last,LastW*LastH*2);
+  else
+    for(Y=0;Y<LastH;++Y)
+      for(X=0;X<LastW;++X)
+      {
+        memcpy(&P,Last+(Y*LastW+X)*4,4);
+        P&= 0xFFFFFF;
+        S = Hash(S,&P,4);
+      }
+  Res.Hash[Frame] = S;
+}
+
+static size_t AudioBatch(const int16_t *Data,size_t Frames) { (void)Data;return(Frames); }
+static void Audio(int16_t L,int16_t R) { (void)L;(void)R; }
+static void Poll(void) { }
+
+static int16_t Input(unsigned int Port,unsigned int Device,unsigned int Index,unsigned int ID)
+{
+  (void)Index;
+  return((Port==0)&&(Device==RETRO_DEVICE_KEYBOARD)&&(ID<RETROK_LAST)? Keys[ID]:0);
+}
+
+/** RunCore() ************************************************/
+/** Load the core and run the program, sending the result   **/
+/** to Fd. Runs in its own process, so that each run starts **/
+/** with a fresh core.                                      **/
+/*************************************************************/
+static void RunCore(const char *Core,int Fd)
+{
+  const char *P;
+  void *H;
+  int K,Shift,Start;
+
+  if(!(H=dlopen(Core,RTLD_NOW|RTLD_LOCAL))) { fprintf(stderr,"%s\n",dlerror());return; }
+
+#define CORE(Name) Name##_t Name = (Name##_t)dlsym(H,#Name)
+  typedef void (*retro_set_environment_t)(retro_environment_t);
+  typedef void (*retro_set_video_refresh_t)(retro_video_refresh_t);
+  typedef void (*retro_set_audio_sample_t)(retro_audio_sample_t);
+  typedef void (*retro_set_audio_sample_batch_t)(retro_audio_sample_batch_t);
+  typedef void (*retro_set_input_poll_t)(retro_input_poll_t);
+  typedef void (*retro_set_input_state_t)(retro_input_state_t);
+  typedef void (*retro_set_controller_port_device_t)(unsigned,unsigned);
+  typedef void (*retro_init_t)(void);
+  typedef bool (*retro_load_game_t)(const struct retro_game_info *);
+  typedef void (*retro_run_t)(void);
+  CORE(retro_set_environment);CORE(retro_set_video_refresh);
+  CORE(retro_set_audio_sample);CORE(retro_set_audio_sample_batch);
+  CORE(retro_set_input_poll);CORE(retro_set_input_state);
+  CORE(retro_set_controller_port_device);
+  CORE(retro_init);CORE(retro_load_game);CORE(retro_run);
+#undef CORE
+
+  retro_set_environment(Environment);
+  retro_set_video_refresh(Video);
+  retro_set_audio_sample(Audio);
+  retro_set_audio_sample_batch(AudioBatch);
+  retro_set_input_poll(Poll);
+  retro_set_input_state(Input);
+  retro_init();
+  if(!retro_load_game(0)) { fprintf(stderr,"Could not start the core\n");return; }
+  retro_set_controller_port_device(0,RETRO_DEVICE_KEYBOARD);
+
+  /* Each character is held for 2 frames, typed every 4 */
+  for(Frame=0,P=Program,Start=TYPE_AT;Frame<FRAMES;++Frame)
+  {
+    memset(Keys,0,sizeof(Keys));
+    if(*P&&(Frame>=Start))
+    {
+      K = KeyFor(*P,&Shift);
+      Keys[K] = 1;
+      Keys[RETROK_LSHIFT] = Shift;
+      if(Frame>=Start+1) { Start+=*P=='\n'? 8:4;++P; }
+    }
+    retro_run();
+  }
+
+  if(write(Fd,&Res,sizeof(Res))!=sizeof(Res)) _exit(1);
+}
+
+/** GetResult() **********************************************/
+/** Run the core in a child process with Runs[N] settings.  **/
+/** Returns 0 on failure.                                   **/
+/*************************************************************/
+static int GetResult(const char *Core,int N,Result *R)
+{
+  int Fd[2],Status;
+  size_t Got;
+  ssize_t J;
+  pid_t Pid;
+
+  if(pipe(Fd)<0) { perror("pipe");return(0); }
+  Run = N;
+  if(!(Pid=fork())) { close(Fd[0]);RunCore(Core,Fd[1]);_exit(0); }
+  close(Fd[1]);
+  if(Pid<0) { perror("fork");close(Fd[0]);return(0); }
+
+  for(Got=0;Got<sizeof(*R);Got+=J)
+    if((J=read(Fd[0],(uint8_t *)R+Got,sizeof(*R)-Got))<=0) break;
+  close(Fd[0]);
+  waitpid(Pid,&Status,0);
+  return(Got==sizeof(*R));
+}
+
+int main(int argc,char *argv[])
+{
+  static Result R[RUNS];
+  int J,K;
+
+  if(argc<3)
+  {
+    fprintf(stderr,"Usage: %s <core> <ROM directory>\n",argv[0]);
+    return(1);
+  }
+  ROMDir = argv[2];
+
+  for(J=0;J<RUNS;++J)
+    if(!GetResult(argv[1],J,&R[J]))
+    {
+      fprintf(stderr,"Core run %d failed\n",J);
+      return(1);
+    }
+
+  for(J=0;J<RUNS;++J)
+  {
+    /* The still screen must be sent as dupes */
+    if(Runs[J].Dupe&&!R[J].Dupes)
+    {
+      printf("Run %d: no frames were sent as dupes\n",J);
+      return(1);
+    }
+
+    /* Every run must show the same frames */
+    for(K=0;K<FRAMES;++K)
+      if(R[J].Hash[K]!=R[0].Hash[K])
+      {
+        printf(
+          "Run %d (dupes %s, render thread %s, frontend framebuffer %s): frame %d differs\n",
+          J,Runs[J].Dupe? "on":"off",Runs[J].Thread? "on":"off",Runs[J].FB? "on":"off",K
+        );
+        return(1);
+      }
+  }
+
+  /* Pages must flip on every frame at the end */
+  for(K=FRAMES-FLIPS;K<FRAMES;++K)
+    if((R[0].Hash[K]==R[0].Hash[K-1])||(R[0].Hash[K]!=R[0].Hash[K-2]))
+    {
+      printf("Even/odd pages do not flip at frame %d\n",K);
+      return(1);
+    }
+
+  printf("%d runs of %d frames, %d dupes in run 1: all runs match\n",RUNS,FRAMES,R[1].Dupes);
+  return(0);
+}
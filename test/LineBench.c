@@ -0,0 +1,217 @@
+/** fMSX: portable MSX emulator ******************************/
+/**                                                         **/
+/**                        LineBench.c                      **/
+/**                                                         **/
+/** This file contains a benchmark for the bitmap screen    **/
+/** line drivers, RefreshLine5..8/10/12 from Common.h and   **/
+/** Wide.h. Each mode draws fixed pseudo-random VRAM with   **/
+/** 16x16 sprites, at 16bpp and 32bpp, once with palette    **/
+/** shuffles (PalSIMD=1) and once with the scalar code      **/
+/** (PalSIMD=0). The two frames must match. Only SCREEN5-7  **/
+/** have SIMD code, other modes are timed for reference.    **/
+/**                                                         **/
+/*************************************************************/
+#include "MSX.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BORDER 8
+#define WIDTH  (256+(BORDER<<1))
+#define HEIGHT (212+(BORDER<<1))
+#define MAX_HEIGHT   (256+BORDER)
+#define MAX_SCANLINE 242
+
+#define PIXEL16(R,G,B)  (uint16_t)(((31*(R)/255)<<11)|((63*(G)/255)<<5)|(31*(B)/255))
+#define PIXEL32(R,G,B)  (uint32_t)(((R)<<16)|((G)<<8)|(B))
+
+#define HiResMode       0
+#define OverscanMode    0
+#define InterlacedMode  0
+#define OddPage         0
+
+#define REPS    100                 /* Default frames per run     */
+#define LINES   212                 /* Lines drawn per frame      */
+#define SPRITES 8                   /* Sprites on screen          */
+
+/** Screen Driver State **************************************/
+/** What libretro.c and MSX.c provide to CommonMux.h.       **/
+/*************************************************************/
+static uint32_t Frame[640*480];     /* Frame being drawn          */
+static uint32_t Ref[640*480];       /* Frame drawn with PalSIMD=1 */
+static void *frame_buffer = Frame;
+static int frame_pitch    = WIDTH<<1;
+static int frame_rows     = 640*480/(WIDTH<<1);
+
+static uint16_t XPal_16[80];
+static uint16_t BPal_16[256];
+static uint16_t XPal0_16;
+static uint32_t XPal_32[80];
+static uint32_t BPal_32[256];
+static uint32_t XPal0_32;
+
+static void fit_frame(unsigned Width) { (void)Width; }
+
+#define XBuf   frame_buffer
+#define WBuf   frame_buffer
+#define XPitch frame_pitch
+#define XRows  frame_rows
+#define XFit   fit_frame
+
+int Mode;
+int LastScanline;
+uint8_t *VRAM;
+uint8_t VDP[64];
+uint8_t *ChrGen,*ChrTab,*ColTab;
+uint8_t *SprGen,*SprTab;
+int ChrGenM,ChrTabM,ColTabM;
+int SprTabM;
+uint8_t FGColor,BGColor;
+uint8_t XFGColor,XBGColor;
+uint8_t ScrMode;
+uint8_t SprCount[256];
+uint8_t SprList[256][32];
+uint8_t *FontBuf;
+void (*RefreshLine[MAXSCREEN+2])(uint8_t Y);
+
+void PutImage(void) {}
+
+#include "CommonMux.h"
+
+static const struct { const char *Name;int Screen; } Modes[] =
+{
+  { "SCREEN5",5 },{ "SCREEN6",6 },{ "SCREEN7",7 },
+  { "SCREEN8",8 },{ "SCREEN10",10 },{ "SCREEN12",12 }
+};
+
+/** Random() *************************************************/
+/** Fixed pseudo-random sequence, same on every run.        **/
+/*************************************************************/
+static uint32_t Seed = 1;
+static uint8_t Random(void)
+{
+  Seed = Seed*1103515245+12345;
+  return(Seed>>16);
+}
+
+/** SetupVDP() ***********************************************/
+/** Fill VRAM and palettes, place sprites, and list those   **/
+/** crossing each line as SpriteStatus() in MSX.c does.     **/
+/*************************************************************/
+static void SetupVDP(void)
+{
+  uint8_t *AT;
+  int J,K,Y;
+
+  VRAM = malloc(0x20000);
+  for(J=0;J<0x20000;++J) VRAM[J]=Random();
+
+  for(J=0;J<80;++J)
+  {
+    XPal_16[J] = PIXEL16(Random(),Random(),Random());
+    XPal_32[J] = PIXEL32(Random(),Random(),Random());
+  }
+  for(J=0;J<256;++J)
+  {
+    BPal_16[J] = PIXEL16(Random(),Random(),Random());
+    BPal_32[J] = PIXEL32(Random(),Random(),Random());
+  }
+
+  /* Screen on, 16x16 sprites, 212 lines */
+  VDP[1]  = 0x42;
+  VDP[8]  = 0x08;
+  VDP[9]  = 0x80;
+  BGColor = 4;
+  ChrTab  = VRAM;
+  ChrTabM = ~0;
+  SprTab  = VRAM+0xFA00;
+  SprGen  = VRAM+0xF000;
+
+  /* Sprites spread over the screen, crossing each other */
+  for(J=0;J<SPRITES;++J)
+  {
+    AT    = SprTab+(J<<2);
+    AT[0] = 24*J+Random()%16;
+    AT[1] = 28*J+Random()%32;
+    AT[2] = Random();
+  }
+
+  for(Y=0;Y<256;++Y)
+    for(J=SprCount[Y]=0;J<SPRITES;++J)
+    {
+      K = (uint8_t)(SprTab[J<<2]-VScroll);
+      if(K>256-16) K-=256;
+      if((Y>K)&&(Y<=K+16)) SprList[Y][SprCount[Y]++]=J;
+    }
+}
+
+/** Draw() ***************************************************/
+/** Draw N frames with a line driver. Returns CPU seconds.  **/
+/*************************************************************/
+static double Draw(void (*Line)(uint8_t Y),int N)
+{
+  clock_t T;
+  int Y;
+
+  T = clock();
+  while(N--)
+    for(Y=0;Y<LINES;++Y) Line(Y);
+  return((double)(clock()-T)/CLOCKS_PER_SEC);
+}
+
+int main(int argc,char *argv[])
+{
+  double TSimd,TScalar;
+  void (*Line)(uint8_t Y);
+  int J,Depth,Reps,Fails,Simd;
+
+  Reps = argc>1? atoi(argv[1]):REPS;
+  if(Reps<1) Reps=1;
+
+  SetupVDP();
+
+  /* Palette shuffles, when built in and the CPU has them */
+#ifdef PAL_SIMD
+  Simd = !!PAL_CPU;
+#else
+  Simd = 0;
+#endif
+
+  printf("%-9s %5s %12s %12s %7s %s\n","Mode","Depth","SIMD","Scalar","Speedup","Result");
+
+  for(J=Fails=0;J<(int)(sizeof(Modes)/sizeof(Modes[0]));++J)
+    for(Depth=16;Depth<=32;Depth+=16)
+    {
+      SetScreenDepth(Depth);
+      ScrMode = Modes[J].Screen;
+      Line    = RefreshLine[ScrMode];
+
+      TSimd   = 0.0;
+      memset(Frame,0,sizeof(Frame));
+#ifdef PAL_SIMD
+      if(Simd)
+      {
+        PalSIMD = 1;
+        TSimd   = Draw(Line,Reps);
+        memcpy(Ref,Frame,sizeof(Ref));
+        memset(Frame,0,sizeof(Frame));
+      }
+      PalSIMD = 0;
+#endif
+      TScalar = Draw(Line,Reps);
+      if(!Simd) memcpy(Ref,Frame,sizeof(Ref));
+
+      printf("%-9s %4dbpp %9.1fus %9.1fus %6.2fx %s\n",
+        Modes[J].Name,Depth,1e6*TSimd/Reps,1e6*TScalar/Reps,
+        TSimd>0.0? TScalar/TSimd:0.0,
+        memcmp(Ref,Frame,sizeof(Ref))? "MISMATCH":"ok"
+      );
+      Fails += !!memcmp(Ref,Frame,sizeof(Ref));
+    }
+
+  if(!Simd) printf("No palette shuffles in this build or CPU, scalar code only\n");
+  if(Fails) { printf("%d runs differ from the scalar code\n",Fails);return(1); }
+  return(0);
+}
@@ -0,0 +1,211 @@
+/** EMULib Emulation Library *********************************/
+/**                                                         **/
+/**                        NukeIdle.c                       **/
+/**                                                         **/
+/** This file contains a check for the NukeYKT idle skip.   **/
+/** WrapNukeYKT.c stops clocking a silent OPLL and later    **/
+/** advances its counters in NukeYKT_CatchUp(), which must  **/
+/** match opll.c bit for bit. Here one chip runs through    **/
+/** the wrapper, synced once per scanline as MSX.c does,    **/
+/** and another is clocked for every sample with plain      **/
+/** OPLL_Clock(). Each seed plays notes with vibrato and AM **/
+/** and rhythm with noise, keys them off, idles, and plays  **/
+/** again. Both chips must give the same samples.           **/
+/**                                                         **/
+/*************************************************************/
+#include "WrapNukeYKT.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_TICKS  228           /* Z80 cycles per scanline      */
+#define FRAME_LINES 262           /* Scanlines per NTSC frame     */
+#define SEEDS       12            /* Scenarios played             */
+
+/* Mixes one OPLL cycle into a sample, from WrapNukeYKT.c */
+void NukeYKT_generate_one_channel(YM2413_NukeYKT *opll,int16_t *out);
+
+static YM2413_NukeYKT Nuke;       /* Chip run by the wrapper      */
+static YM2413_NukeYKT Ref;        /* Chip clocked for every sample*/
+static uint32_t RefTicks;         /* Ref ticks left from syncs    */
+static Write Queue[MAX_WRITES];   /* Ref port writes not done yet */
+static int Queued;                /* Number of writes in Queue[]  */
+static int16_t RefOut[NUM_SAMPLES_PER_FRAME];
+static int RefCount;              /* Samples in RefOut[]          */
+
+static uint32_t Scene;            /* Scenario seed, for messages  */
+static uint32_t Seed;             /* Random() state               */
+static int Frame;                 /* Frame number, for messages   */
+static int Line;                  /* Scanline in current frame    */
+
+/** Random() *************************************************/
+/** Return a pseudo-random number in 0..N-1.                **/
+/*************************************************************/
+static int Random(int N)
+{
+  Seed = Seed*1103515245+12345;
+  return((Seed>>16)%N);
+}
+
+/** WrReg() **************************************************/
+/** Write value V to OPLL register R on both chips.         **/
+/*************************************************************/
+static void WrReg(uint8_t R,uint8_t V)
+{
+  NukeYKT_WritePort2413(&Nuke,NUKEYKT_REGISTER_PORT,R);
+  NukeYKT_WritePort2413(&Nuke,NUKEYKT_DATA_PORT,V);
+  Queue[Queued].port    = NUKEYKT_REGISTER_PORT;
+  Queue[Queued++].value = R;
+  Queue[Queued].port    = NUKEYKT_DATA_PORT;
+  Queue[Queued++].value = V;
+}
+
+/** RefSync() ************************************************/
+/** Clock Ref for Ticks Z80 cycles the way the wrapper does **/
+/** without idle skip: one port write before each sample,  **/
+/** then 18 OPLL cycles mixed into the sample.             **/
+/*************************************************************/
+static void RefSync(uint32_t Ticks)
+{
+  int J,K,N;
+  int16_t S;
+
+  RefTicks+= Ticks;
+  N        = RefTicks/Z80_CYCLES_PER_SAMPLE;
+  RefTicks%= Z80_CYCLES_PER_SAMPLE;
+
+  for(J=0;J<N;++J)
+  {
+    if(J<Queued) OPLL_Write(&Ref.opll,Queue[J].port,Queue[J].value);
+    for(K=S=0;K<CYCLE_COUNT;++K) NukeYKT_generate_one_channel(&Ref,&S);
+    RefOut[RefCount++] = S;
+  }
+
+  /* Writes not done yet wait for the next sync */
+  if(N<Queued) memmove(Queue,Queue+N,(Queued-N)*sizeof(Write));
+  Queued = N<Queued? Queued-N:0;
+}
+
+/** Play() ***************************************************/
+/** Sync both chips for N scanlines and compare samples at  **/
+/** the end of each frame. Returns 0 on mismatch.           **/
+/*************************************************************/
+static int Play(int N)
+{
+  int J,Count;
+
+  for(;N;--N)
+  {
+    NukeYKT_Sync2413(&Nuke,LINE_TICKS);
+    RefSync(LINE_TICKS);
+    if(++Line<FRAME_LINES) continue;
+
+    /* End of frame, compare and start new sample buffers */
+    Count = Nuke.sample_write_index-1;
+    if(Count!=RefCount)
+    {
+      printf("Seed %u, frame %d: %d samples, expected %d\n",Scene,Frame,Count,RefCount);
+      return(0);
+    }
+    for(J=0;J<Count;++J)
+      if(Nuke.samples[J+1]!=RefOut[J])
+      {
+        printf("Seed %u, frame %d, sample %d: %d, expected %d\n",Scene,Frame,J,Nuke.samples[J+1],RefOut[J]);
+        return(0);
+      }
+
+    Nuke.samples[0]         = Nuke.samples[Count];
+    Nuke.sample_write_index = 1;
+    RefCount = Line = 0;
+    ++Frame;
+  }
+
+  return(1);
+}
+
+/** Scenario() ***********************************************/
+/** Play one seed. Returns 0 on mismatch.                   **/
+/*************************************************************/
+static int Scenario(uint32_t S)
+{
+  int J,K,Ch;
+
+  NukeYKT_Reset2413(&Nuke);
+  OPLL_Reset(&Ref.opll,opll_type_ym2413b);
+  RefTicks = Nuke.ticksPending = 0;
+  Queued   = RefCount = Frame = Line = 0;
+  Seed     = Scene = S;
+
+  /* Custom instrument with AM and vibrato, fast release */
+  WrReg(0x00,0xC0|Random(16));
+  WrReg(0x01,0xC0|Random(16));
+  WrReg(0x02,Random(64));
+  WrReg(0x03,Random(256));
+  if(!Play(1)) return(0);
+  WrReg(0x04,0xF0|Random(16));
+  WrReg(0x05,0xF0|Random(16));
+  WrReg(0x06,(Random(16)<<4)|0x0F);
+  WrReg(0x07,(Random(16)<<4)|0x0F);
+  if(!Play(1+Random(FRAME_LINES))) return(0);
+
+  for(K=0;K<2;++K)
+  {
+    /* Notes on two channels, rhythm on. ROM instruments  */
+    /* never release some modulators, so none go idle.    */
+    for(J=0;J<2;++J)
+    {
+      Ch = J*3+Random(3);
+      WrReg(0x30+Ch,Random(8));
+      WrReg(0x10+Ch,Random(256));
+      WrReg(0x20+Ch,0x10|Random(16));
+      if(!Play(1)) return(0);
+    }
+    WrReg(0x16,Random(256));WrReg(0x26,Random(16));
+    WrReg(0x17,Random(256));WrReg(0x27,Random(16));
+    WrReg(0x18,Random(256));WrReg(0x28,Random(16));
+    if(!Play(1)) return(0);
+    WrReg(0x36,Random(16));WrReg(0x37,Random(256));WrReg(0x38,Random(256));
+    WrReg(0x0E,0x20|0x01|Random(32));
+    if(!Play(FRAME_LINES*(10+Random(20))+Random(FRAME_LINES))) return(0);
+
+    /* Key off, leave rhythm mode on for the noise LFSR */
+    for(Ch=0;Ch<9;++Ch)
+    {
+      WrReg(0x20+Ch,Random(16));
+      if(!Play(1)) return(0);
+    }
+    WrReg(0x0E,0x20);
+
+    /* Long idle, odd length to land on any counter phase */
+    if(!Play(FRAME_LINES*(20+Random(60))+Random(FRAME_LINES))) return(0);
+  }
+
+  /* Resume with vibrato, AM, and rhythm noise */
+  WrReg(0x30,Random(8));
+  WrReg(0x10,Random(256));
+  WrReg(0x20,0x10|Random(16));
+  WrReg(0x0E,0x20|0x01|0x08|Random(32));
+  return(Play(FRAME_LINES*(10+Random(20))));
+}
+
+int main(void)
+{
+  uint64_t Idle;
+  uint32_t S;
+
+  for(S=1;S<=SEEDS;++S)
+  {
+    Idle = NukeYKT_IdleSamples;
+    if(!Scenario(S)) return(1);
+    if(NukeYKT_IdleSamples==Idle)
+    {
+      printf("Seed %u: the OPLL never went idle\n",S);
+      return(1);
+    }
+  }
+
+  printf("%d seeds, %llu idle samples skipped: output matches OPLL_Clock()\n",
+    SEEDS,(unsigned long long)NukeYKT_IdleSamples);
+  return(0);
+}
@@ -0,0 +1,219 @@
+/** EMULib Emulation Library *********************************/
+/**                                                         **/
+/**                        OPLLBench.c                      **/
+/**                                                         **/
+/** This file contains a benchmark comparing FastOPLL with  **/
+/** NukeYKT. OPLL register logs recorded from fMSX are fed  **/
+/** to both cores, synced once per scanline as MSX.c does,  **/
+/** and CPU time and the FastOPLL waveform error against    **/
+/** NukeYKT are reported for each log.                      **/
+/**                                                         **/
+/** Log lines hold an OPLL sample number (72 Z80 cycles),   **/
+/** a register, and a value, all but the first in hex.      **/
+/** Lines starting with '#' are comments, see opll/ logs.   **/
+/**                                                         **/
+/*************************************************************/
+#include "WrapNukeYKT.h"
+#include "FastOPLL.h"
+#include "Resample.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define LINE_TICKS  228           /* Z80 cycles per scanline      */
+#define FRAME_LINES 262           /* Scanlines per NTSC frame     */
+#define OUT_RATE    48000         /* Emulator output rate, Hz     */
+#define OUT_FRAME   (OUT_RATE/60) /* Output samples per frame     */
+#define MAX_LAG     40            /* Max alignment shift, samples */
+
+typedef struct
+{
+  uint32_t Time;                  /* OPLL sample of this write    */
+  uint8_t Reg,Value;              /* Register and its new value   */
+} OPLLWrite;
+
+static OPLLWrite *Log;            /* Writes from the log file     */
+static int Writes;                /* Number of writes in Log[]    */
+static int Frames;                /* NTSC frames to play          */
+
+static YM2413_NukeYKT Nuke;
+static FastOPLL Fast;
+static Resampler Rsmp;
+static int Out[OUT_FRAME];
+
+/** LoadLog() ************************************************/
+/** Load register writes from a log file. Returns 0 on      **/
+/** failure.                                                **/
+/*************************************************************/
+static int LoadLog(const char *Name)
+{
+  char S[256];
+  unsigned int T,R,V;
+  int Max;
+  FILE *F;
+
+  if(!(F=fopen(Name,"r"))) return(0);
+
+  for(Writes=Max=0;fgets(S,sizeof(S),F);)
+  {
+    if((S[0]=='#')||(sscanf(S,"%u %x %x",&T,&R,&V)!=3)) continue;
+    if(Writes>=Max)
+    {
+      Max = Max? 2*Max:1024;
+      Log = realloc(Log,Max*sizeof(OPLLWrite));
+    }
+    Log[Writes].Time  = T;
+    Log[Writes].Reg   = R;
+    Log[Writes].Value = V;
+    ++Writes;
+  }
+
+  fclose(F);
+
+  /* Play one more second after the last write */
+  Frames = Writes? (int)((uint64_t)(Log[Writes-1].Time+NUKEYKT_RATE)*72/LINE_TICKS/FRAME_LINES):0;
+  return(Writes>0);
+}
+
+/** Play() ***************************************************/
+/** Feed the log to NukeYKT (Fst=0) or to FastOPLL, and     **/
+/** return CPU seconds spent. NukeYKT output goes to Buf at **/
+/** its native rate, with frame lengths stored to Counts[], **/
+/** and is resampled to OUT_RATE like Sound.c does. Fast-   **/
+/** OPLL renders either the same frame lengths into Buf, or **/
+/** OUT_FRAME samples per frame when Buf is 0.              **/
+/*************************************************************/
+static double Play(int Fst,int16_t *Buf,int *Counts)
+{
+  const int16_t *P;
+  clock_t T;
+  int J,K,L,N;
+
+  NukeYKT_Reset2413(&Nuke);
+  ResetOPLL(&Fast);
+  ResetResampler(&Rsmp);
+
+  T = clock();
+  for(J=K=0;J<Frames;++J)
+  {
+    for(L=0;L<FRAME_LINES;++L)
+    {
+      /* Writes made during this scanline */
+      N = ((J*FRAME_LINES+L+1)*LINE_TICKS)/72;
+      for(;(K<Writes)&&(Log[K].Time<(uint32_t)N);++K)
+        if(!Fst)
+        {
+          NukeYKT_WritePort2413(&Nuke,NUKEYKT_REGISTER_PORT,Log[K].Reg);
+          NukeYKT_WritePort2413(&Nuke,NUKEYKT_DATA_PORT,Log[K].Value);
+        }
+        else
+        {
+          WrCtrlOPLL(&Fast,Log[K].Reg);
+          WrDataOPLL(&Fast,Log[K].Value);
+        }
+
+      if(!Fst) NukeYKT_Sync2413(&Nuke,LINE_TICKS);
+      else SyncOPLL(&Fast,LINE_TICKS,LINE_TICKS*FRAME_LINES);
+    }
+
+    if(!Fst)
+    {
+      /* Keep native samples, resample the frame, start a new one */
+      N = Nuke.sample_write_index-1;
+      memcpy(Buf,Nuke.samples+1,N*sizeof(int16_t));
+      Buf      += N;
+      Counts[J] = N;
+      memset(Out,0,sizeof(Out));
+      Resample(&Rsmp,Out,OUT_FRAME,Nuke.samples+1,N,128);
+      Nuke.samples[0] = Nuke.samples[N];
+      Nuke.sample_write_index = 1;
+    }
+    else if(Buf)
+    {
+      P = FlushOPLL(&Fast,Counts[J]);
+      memcpy(Buf,P,Counts[J]*sizeof(int16_t));
+      Buf += Counts[J];
+    }
+    else
+      FlushOPLL(&Fast,OUT_FRAME);
+  }
+
+  return((double)(clock()-T)/CLOCKS_PER_SEC);
+}
+
+/** Error() **************************************************/
+/** Compute FastOPLL error energy relative to NukeYKT, in   **/
+/** dB, at the best alignment within MAX_LAG samples. Also  **/
+/** return RMS level ratio in Level.                        **/
+/*************************************************************/
+static double Error(const int16_t *Ref,const int16_t *Tst,int N,int *Lag,double *Level)
+{
+  double D,E,Best,R,S;
+  int J,L;
+
+  for(J=MAX_LAG,R=S=0.0;J<N-MAX_LAG;++J)
+  {
+    R+= (double)Ref[J]*Ref[J];
+    S+= (double)Tst[J]*Tst[J];
+  }
+
+  for(L=-MAX_LAG,Best=-1.0;L<=MAX_LAG;++L)
+  {
+    for(J=MAX_LAG,E=0.0;J<N-MAX_LAG;++J) { D=Tst[J+L]-Ref[J];E+=D*D; }
+    if((Best<0.0)||(E<Best)) { Best=E;*Lag=L; }
+  }
+
+  *Level = R>0.0? sqrt(S/R):0.0;
+  return(R>0.0? 10.0*log10(Best/R):0.0);
+}
+
+int main(int argc,char *argv[])
+{
+  double TNuke,TFast,Err,Level;
+  int16_t *Ref,*Tst;
+  int *Counts;
+  int J,K,N,Lag;
+
+  if(argc<2)
+  {
+    fprintf(stderr,"Usage: %s <log> [<log> ...]\n",argv[0]);
+    return(1);
+  }
+
+  InitResampler(&Rsmp,NUKEYKT_RATE,OUT_RATE);
+  printf("%-20s %7s %9s %9s %7s %9s %6s %4s\n","Log","Seconds","NukeYKT","Fast","Speedup","Error","Level","Lag");
+
+  for(J=1;J<argc;++J)
+  {
+    if(!LoadLog(argv[J])) { fprintf(stderr,"%s: no OPLL writes\n",argv[J]);return(1); }
+
+    N      = (Frames+1)*(LINE_TICKS*FRAME_LINES/72+2);
+    Ref    = calloc(N,sizeof(int16_t));
+    Tst    = calloc(N,sizeof(int16_t));
+    Counts = calloc(Frames,sizeof(int));
+    if(!Ref||!Tst||!Counts) { fprintf(stderr,"Out of memory\n");return(1); }
+
+    /* NukeYKT with resampling, as played by the emulator */
+    TNuke = Play(0,Ref,Counts);
+    for(K=N=0;K<Frames;++K) N+=Counts[K];
+
+    /* FastOPLL at the output rate, then at NukeYKT rate */
+    TFast = Play(1,0,Counts);
+    Play(1,Tst,Counts);
+    Err   = Error(Ref,Tst,N,&Lag,&Level);
+
+    printf("%-20s %7.1f %8.3fs %8.3fs %6.1fx %6.1fdB %6.2f %4d\n",
+      strrchr(argv[J],'/')? strrchr(argv[J],'/')+1:argv[J],
+      (double)N/NUKEYKT_RATE,TNuke,TFast,TFast>0.0? TNuke/TFast:0.0,Err,Level,Lag
+    );
+
+    free(Ref);
+    free(Tst);
+    free(Counts);
+  }
+
+  return(0);
+}
@@ -0,0 +1,449 @@
+/** Z80: portable Z80 emulator *******************************/
+/**                                                         **/
+/**                       Z80Lockstep.c                     **/
+/**                                                         **/
+/** This file contains a differential test for the Z80      **/
+/** engines. Plain, threaded, and translated interpreters   **/
+/** run the same random code side by side, each in its own  **/
+/** process, and registers, cycles, memory writes, and I/O  **/
+/** are compared after each LoopZ80() period. The code is   **/
+/** seeded with self-modifying stores, bank and MegaROM     **/
+/** page switches, and repeated block instructions. Classic **/
+/** engine moves blocks byte by byte, others in runs.       **/
+/**                                                         **/
+/*************************************************************/
+#include "Z80.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#ifndef Z80_THREADED
+#error Z80Lockstep needs Z80_THREADED and GCC computed goto
+#endif
+
+#define ENGINES  3                /* Plain, threaded, translated  */
+#define BANKS    16               /* 8kB banks per engine         */
+#define ROMBANK  12               /* Banks 12..15 are read-only   */
+#define HWREGS   0x3FF0           /* 3FF0h..3FFFh are registers   */
+#define LOG_MAX  4096             /* Max accesses per period      */
+#define SUM_EVERY 64              /* Periods between memory sums  */
+
+#define LOG_WR   0                /* Access types in Log[]        */
+#define LOG_IN   1
+#define LOG_OUT  2
+#define LOG_MAP  3
+#define LOG_PAT  4
+
+static const char *Names[ENGINES] = { "Classic","Threaded","Translated" };
+
+uint8_t *RAM[8];                  /* Current engine memory map    */
+
+static uint8_t Mem[ENGINES][BANKS][0x2000];
+static Z80 Start;                 /* Initial CPU state            */
+static Z80 CPU[ENGINES];          /* Registers of each engine     */
+static uint8_t Count[ENGINES];    /* Hardware register counters   */
+static uint32_t Log[ENGINES][LOG_MAX];
+static int Logged[ENGINES];
+static int Cur;                   /* Engine running now           */
+
+static uint32_t Seed;
+
+/** Rnd() ****************************************************/
+/** Deterministic pseudo-random numbers, same everywhere.   **/
+/*************************************************************/
+static unsigned int Rnd(unsigned int N)
+{
+  Seed = Seed*1103515245+12345;
+  return((Seed>>8)%N);
+}
+
+/** AddLog() *************************************************/
+/** Record an access made by the current engine.            **/
+/*************************************************************/
+static void AddLog(uint8_t Type,uint16_t A,uint8_t V)
+{
+  if(Logged[Cur]<LOG_MAX) Log[Cur][Logged[Cur]]=((uint32_t)Type<<24)|((uint32_t)A<<8)|V;
+  ++Logged[Cur];
+}
+
+/** IsROM() **************************************************/
+/** Check if an 8kB page is one of the read-only banks.     **/
+/*************************************************************/
+static int IsROM(const uint8_t *P)
+{
+  return(P>=Mem[Cur][ROMBANK]);
+}
+
+/** Machine Interface ****************************************/
+/** Memory has 16 banks of 8kB. Ports F8h..FFh map bank V   **/
+/** into page Port&7. Writing 6000h..7FFFh while page 3 is  **/
+/** ROM selects ROM bank, MegaROM style. Reading 3FF0h..    **/
+/** 3FFFh or any port returns an ever changing counter.     **/
+/** Plain RAM writes are not logged, as block runs skip     **/
+/** WrZ80(). Memory sums are compared instead.              **/
+/*************************************************************/
+uint8_t RdZ80(uint16_t A)
+{
+  if((A&0xFFF0)==HWREGS) { BusyZ80();return(Count[Cur]++); }
+  return(RAM[A>>13][A&0x1FFF]);
+}
+
+void WrZ80(uint16_t A,uint8_t V)
+{
+  uint8_t *P = RAM[A>>13];
+
+  if((A>>13==3)&&IsROM(P))
+  {
+    BusyZ80();
+    AddLog(LOG_WR,A,V);
+    RAM[3]=Mem[Cur][ROMBANK+(V&3)];
+    AddLog(LOG_MAP,3,ROMBANK+(V&3));
+    return;
+  }
+  if(IsROM(P)||((A&0xFFF0)==HWREGS)) { BusyZ80();AddLog(LOG_WR,A,V);return; }
+  if(P[A&0x1FFF]!=V)
+  {
+    ChangeZ80(A,P[A&0x1FFF]);
+    P[A&0x1FFF]=V;
+    TouchZ80(A);
+  }
+}
+
+uint8_t InZ80(uint16_t Port)
+{
+  BusyZ80();
+  AddLog(LOG_IN,Port,Count[Cur]);
+  return(Count[Cur]++);
+}
+
+void OutZ80(uint16_t Port,uint8_t Value)
+{
+  AddLog(LOG_OUT,Port,Value);
+  if((Port&0xF8)==0xF8)
+  {
+    RAM[Port&7]=Mem[Cur][Value%BANKS];
+    AddLog(LOG_MAP,Port&7,Value%BANKS);
+  }
+}
+
+uint8_t CodeZ80(uint16_t A) { return((A&0xFFF0)!=HWREGS); }
+
+uint8_t *PlainZ80(uint16_t A,uint8_t Write)
+{
+  uint8_t *P = RAM[A>>13];
+
+  if(!Cur||((A>>8)==(HWREGS>>8))||(Write&&IsROM(P))) return(0);
+  return(P+(A&0x1F00));
+}
+
+int OutsZ80(uint16_t Port,const uint8_t *Data,int N)
+{
+  int J;
+
+  if(!Cur||((Port&0xF8)==0xF8)) return(0);
+  for(J=0;J<N;++J) AddLog(LOG_OUT,Port-(J<<8),Data[J]);
+  return(N);
+}
+
+uint16_t LoopZ80(Z80 *R) { (void)R;return(INT_QUIT); }
+
+#ifdef PATCH_Z80
+void PatchZ80(Z80 *R) { AddLog(LOG_PAT,R->PC.W,R->AF.B.h);R->AF.B.h++; }
+#endif
+
+/** Emit() ***************************************************/
+/** Put bytes into bank B at offset Off, skipping the ones  **/
+/** that would not fit.                                     **/
+/*************************************************************/
+static void Emit(uint8_t B,unsigned int Off,const uint8_t *Code,unsigned int N)
+{
+  unsigned int J;
+  for(J=0;(J<N)&&(Off+J<0x2000);++J) Mem[0][B][Off+J]=Code[J];
+}
+
+/** MakeProgram() ********************************************/
+/** Fill all banks with random code, sprinkled with the     **/
+/** snippets the translated engine has to handle carefully. **/
+/** Bank B is meant to run from page B&7, so addresses of   **/
+/** self-modifying stores point a few bytes ahead in it.    **/
+/*************************************************************/
+static void MakeProgram(void)
+{
+  static const uint8_t Blk[] = { 0xB0,0xB8,0xB2,0xBA,0xB3,0xBB,0xB1,0xB9,0xA0,0xA8 };
+  uint8_t C[16];
+  unsigned int B,Off,J;
+  uint16_t A;
+
+  for(B=0;B<BANKS;++B)
+    for(J=0;J<0x2000;++J)
+    {
+      Mem[0][B][J]=Rnd(256);
+      /* Keep most HALTs out, or CPUs would mostly sleep */
+      if((Mem[0][B][J]==0x76)&&Rnd(4)) Mem[0][B][J]=0x00;
+    }
+
+  for(B=0;B<BANKS;++B)
+    for(Off=Rnd(64);Off<0x2000;Off+=16+Rnd(96))
+    {
+      A = ((B&7)<<13)+Off;
+      switch(Rnd(8))
+      {
+        case 0: /* LD A,n; LD (nn),A into the code ahead */
+          A+=5+Rnd(40);
+          C[0]=0x3E;C[1]=Rnd(256);C[2]=0x32;C[3]=A&0xFF;C[4]=A>>8;
+          Emit(B,Off,C,5);
+          break;
+        case 1: /* LD HL,nn; INC (HL) on an operand ahead */
+          A+=4+Rnd(24);
+          C[0]=0x21;C[1]=A&0xFF;C[2]=A>>8;C[3]=0x34;
+          Emit(B,Off,C,4);
+          break;
+        case 2: /* LD A,n; OUT (F8h+P),A switching a bank */
+          C[0]=0x3E;C[1]=Rnd(BANKS);C[2]=0xD3;C[3]=0xF8+Rnd(8);
+          Emit(B,Off,C,4);
+          break;
+        case 3: /* LD A,n; LD (6000h),A switching MegaROM page */
+          C[0]=0x3E;C[1]=Rnd(256);C[2]=0x32;C[3]=0x00;C[4]=0x60+Rnd(32);
+          Emit(B,Off,C,5);
+          break;
+        case 4: /* LD HL,nn; LD DE,nn; LD BC,n; repeated op */
+          J = Rnd(3)? A+Rnd(64):Rnd(0x10000);
+          C[0]=0x21;C[1]=J&0xFF;C[2]=J>>8;
+          J = Rnd(2)? A+8+Rnd(32):Rnd(0x10000);
+          C[3]=0x11;C[4]=J&0xFF;C[5]=J>>8;
+          C[6]=0x01;C[7]=1+Rnd(64);C[8]=Rnd(4)? 0:Rnd(4);
+          C[9]=0xED;C[10]=Blk[Rnd(sizeof(Blk))];
+          Emit(B,Off,C,11);
+          break;
+        case 5: /* LD A,(3FF0h+n) reading a hardware register */
+          C[0]=0x3A;C[1]=0xF0+Rnd(16);C[2]=0x3F;
+          Emit(B,Off,C,3);
+          break;
+        case 6: /* LD B,n; DJNZ $ delay loop */
+          C[0]=0x06;C[1]=Rnd(256);C[2]=0x10;C[3]=0xFE;
+          Emit(B,Off,C,4);
+          break;
+        case 7: /* JR back a bit, making loops */
+          C[0]=0x18;C[1]=0xF0+Rnd(12);
+          Emit(B,Off,C,2);
+          break;
+      }
+    }
+
+  /* All engines start with the same memory */
+  for(J=1;J<ENGINES;++J) memcpy(Mem[J],Mem[0],sizeof(Mem[0]));
+}
+
+/** Period *************************************************/
+/** What an engine reports after each LoopZ80() period.     **/
+/*************************************************************/
+typedef struct
+{
+  Z80 CPU;                        /* Registers and cycles         */
+  uint8_t Bank[8];                /* Banks mapped into pages      */
+  int Logged;                     /* Accesses, first LOG_MAX sent */
+  uint32_t Sum;                   /* Memory sum, every SUM_EVERY  */
+} Period;
+
+/** MemSum() *************************************************/
+/** Compute a position dependent sum of engine E memory.    **/
+/*************************************************************/
+static uint32_t MemSum(int E)
+{
+  const uint8_t *P = Mem[E][0];
+  uint32_t S,W;
+  size_t J;
+
+  for(J=S=0;J<sizeof(Mem[E]);J+=4) { memcpy(&W,P+J,4);S=S*31+W; }
+  return(S);
+}
+
+/** Send()/Receive() *****************************************/
+/** Move N bytes through a pipe. Return 0 on failure.       **/
+/*************************************************************/
+static int Send(int Fd,const void *Buf,size_t N)
+{
+  ssize_t J;
+  for(;N;N-=J,Buf=(const uint8_t *)Buf+J)
+    if((J=write(Fd,Buf,N))<=0) return(0);
+  return(1);
+}
+
+static int Receive(int Fd,void *Buf,size_t N)
+{
+  ssize_t J;
+  for(;N;N-=J,Buf=(uint8_t *)Buf+J)
+    if((J=read(Fd,Buf,N))<=0) return(0);
+  return(1);
+}
+
+/** RunEngine() **********************************************/
+/** Run a program on engine E for given number of periods,  **/
+/** sending a Period and the access log after each one, and **/
+/** then all memory. Runs in its own process, so that each  **/
+/** engine has its own decode cache and idle loop state.    **/
+/*************************************************************/
+static void RunEngine(int E,int Fd,unsigned int Periods)
+{
+  Period P;
+  unsigned int N;
+  uint16_t Vector;
+  int J;
+
+  Cur         = E;
+  ThreadedZ80 = E;
+  for(J=0;J<8;++J) RAM[J]=Mem[E][J];
+  ResetZ80(&CPU[E]);
+  CPU[E]=Start;
+
+  for(N=0;N<Periods;++N)
+  {
+    /* Now and then, interrupt the CPU */
+    Vector = !Rnd(16)? INT_IRQ:!Rnd(512)? INT_NMI:INT_NONE;
+    Logged[E] = 0;
+    RunZ80(&CPU[E]);
+    if(Vector!=INT_NONE) IntZ80(&CPU[E],Vector);
+
+    P.CPU    = CPU[E];
+    P.Logged = Logged[E];
+    P.Sum    = (N+1)%SUM_EVERY? 0:MemSum(E);
+    for(J=0;J<8;++J) P.Bank[J]=(RAM[J]-Mem[E][0])/0x2000;
+    if(!Send(Fd,&P,sizeof(P))) return;
+    if(!Send(Fd,Log[E],(P.Logged<LOG_MAX? P.Logged:LOG_MAX)*sizeof(Log[E][0]))) return;
+  }
+
+  Send(Fd,Mem[E],sizeof(Mem[E]));
+}
+
+/** Compare() ************************************************/
+/** Compare period P of engine E to that of engine 0, with  **/
+/** access logs L. Returns 0 and prints the difference if   **/
+/** they do not match.                                      **/
+/*************************************************************/
+#define CMP(Field,Fmt) \
+  if(P[E].CPU.Field!=P[0].CPU.Field) \
+  { \
+    printf("%s: " #Field "=" Fmt " but %s has " Fmt "\n",Names[E],P[E].CPU.Field,Names[0],P[0].CPU.Field); \
+    return(0); \
+  }
+
+static int Compare(const Period *P,uint32_t L[][LOG_MAX],int E)
+{
+  int J;
+
+  CMP(PC.W,"%04X");CMP(SP.W,"%04X");CMP(AF.W,"%04X");
+  CMP(BC.W,"%04X");CMP(DE.W,"%04X");CMP(HL.W,"%04X");
+  CMP(IX.W,"%04X");CMP(IY.W,"%04X");
+  CMP(AF1.W,"%04X");CMP(BC1.W,"%04X");CMP(DE1.W,"%04X");CMP(HL1.W,"%04X");
+  CMP(IFF,"%02X");CMP(I,"%02X");CMP(R,"%02X");
+  CMP(ICount,"%d");CMP(IBackup,"%d");
+
+  if(P[E].Logged!=P[0].Logged)
+  {
+    printf("%s: %d accesses but %s has %d\n",Names[E],P[E].Logged,Names[0],P[0].Logged);
+    return(0);
+  }
+  for(J=0;(J<P[0].Logged)&&(J<LOG_MAX);++J)
+    if(L[E][J]!=L[0][J])
+    {
+      printf("%s: access #%d is %08X but %s has %08X\n",Names[E],J,L[E][J],Names[0],L[0][J]);
+      return(0);
+    }
+  if(P[E].Sum!=P[0].Sum)
+  {
+    printf("%s: memory differs from %s\n",Names[E],Names[0]);
+    return(0);
+  }
+  if(memcmp(P[E].Bank,P[0].Bank,sizeof(P[0].Bank)))
+  {
+    printf("%s: pages map different banks\n",Names[E]);
+    return(0);
+  }
+
+  return(1);
+}
+
+/** RunProgram() *********************************************/
+/** Run a program for given number of periods on all three  **/
+/** engines side by side, comparing them after each period. **/
+/** Returns 0 on the first mismatch.                        **/
+/*************************************************************/
+static int RunProgram(unsigned int Prog,unsigned int Periods)
+{
+  static Period P[ENGINES];
+  static uint8_t Out[BANKS][0x2000];
+  pid_t Pid[ENGINES];
+  int Fd[ENGINES][2];
+  unsigned int N;
+  int E,J,Ok;
+
+  Seed = Prog*7919+1;
+  MakeProgram();
+
+  /* Random period, entry point, registers, interrupt mode */
+  memset(&Start,0,sizeof(Start));
+  Start.IPeriod  = 8+Rnd(Rnd(2)? 64:1024);
+  Start.ICount   = Start.IPeriod;
+  Start.IRequest = INT_NONE;
+  Start.PC.W     = Rnd(0x10000);
+  Start.SP.W     = Rnd(0x10000);
+  Start.HL.W     = Rnd(0x10000);
+  Start.IFF      = Rnd(2)? IFF_IM1:IFF_1|IFF_2|IFF_IM1;
+
+  for(E=0;E<ENGINES;++E)
+  {
+    if(pipe(Fd[E])<0) { perror("pipe");exit(2); }
+    if(!(Pid[E]=fork())) { close(Fd[E][0]);RunEngine(E,Fd[E][1],Periods);_exit(0); }
+    if(Pid[E]<0) { perror("fork");exit(2); }
+    close(Fd[E][1]);
+  }
+
+  /* Compare engines as they go */
+  for(N=0,Ok=1;Ok&&(N<Periods);++N)
+  {
+    for(E=0;Ok&&(E<ENGINES);++E)
+    {
+      Ok = Receive(Fd[E][0],&P[E],sizeof(P[E]));
+      J  = P[E].Logged<LOG_MAX? P[E].Logged:LOG_MAX;
+      Ok = Ok&&Receive(Fd[E][0],Log[E],J*sizeof(Log[E][0]));
+      if(!Ok) printf("%s: engine died\n",Names[E]);
+    }
+    for(E=1;Ok&&(E<ENGINES);++E) Ok=Compare(P,Log,E);
+    if(!Ok) printf("Program %u, period %u of %d cycles, PC=%04X\n",Prog,N,Start.IPeriod,P[0].CPU.PC.W);
+  }
+
+  /* All memory must be the same in the end */
+  if(Ok&&!Receive(Fd[0][0],Mem[0],sizeof(Mem[0]))) Ok=0;
+  for(E=1;Ok&&(E<ENGINES);++E)
+    if(!Receive(Fd[E][0],Out,sizeof(Out))||memcmp(Out,Mem[0],sizeof(Out)))
+    {
+      printf("%s: memory differs after program %u\n",Names[E],Prog);
+      Ok=0;
+    }
+
+  for(E=0;E<ENGINES;++E)
+  {
+    close(Fd[E][0]);
+    if(!Ok) kill(Pid[E],SIGKILL);
+    waitpid(Pid[E],0,0);
+  }
+
+  return(Ok);
+}
+
+int main(int argc,char *argv[])
+{
+  unsigned int Progs   = argc>1? atoi(argv[1]):200;
+  unsigned int Periods = argc>2? atoi(argv[2]):4000;
+  unsigned int J;
+
+  for(J=0;J<Progs;++J)
+    if(!RunProgram(J,Periods)) return(1);
+
+  printf("%u programs, %u periods each: all engines match\n",Progs,Periods);
+  return(0);
+}